@@ -0,0 +1,269 @@
+// The library of mesh operations declared in cgal_tools.h. Each
+// function calls the template of the same name with explicit template
+// arguments, as otherwise the call would resolve to the function itself.
+
+#include "cgal_tools.h"
+
+#include "fill_holes.h"
+#include "isotropic_remesh.h"
+#include "rm_connected_components.h"
+#include "simplify_mesh.h"
+#include "smoothe_mesh.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace cgal_tools {
+
+int fill_holes(Double_mesh & mesh, Fill_holes_params const& params,
+               Fill_holes_report * report) {
+  return fill_holes<Double_mesh>(mesh, params, report);
+}
+
+int fill_holes(Float_mesh & mesh, Fill_holes_params const& params,
+               Fill_holes_report * report) {
+  return fill_holes<Float_mesh>(mesh, params, report);
+}
+
+int fill_holes_serial(Double_mesh & mesh, Fill_holes_params const& params,
+                      Fill_holes_report * report) {
+  return fill_holes_serial<Double_mesh>(mesh, params, report);
+}
+
+int fill_holes_serial(Float_mesh & mesh, Fill_holes_params const& params,
+                      Fill_holes_report * report) {
+  return fill_holes_serial<Float_mesh>(mesh, params, report);
+}
+
+std::ptrdiff_t smoothe_mesh(Double_mesh & mesh, Smoothe_params const& params,
+                            std::vector<double> * iteration_times) {
+  return smoothe_mesh<Double_mesh>(mesh, params, iteration_times);
+}
+
+std::ptrdiff_t smoothe_mesh(Float_mesh & mesh, Smoothe_params const& params,
+                            std::vector<double> * iteration_times) {
+  return smoothe_mesh<Float_mesh>(mesh, params, iteration_times);
+}
+
+std::size_t rm_connected_components(Double_mesh & mesh,
+                                    Rm_connected_components_params const& params,
+                                    std::size_t * num_kept) {
+  return rm_connected_components<Double_mesh>(mesh, params, num_kept);
+}
+
+std::size_t rm_connected_components(Float_mesh & mesh,
+                                    Rm_connected_components_params const& params,
+                                    std::size_t * num_kept) {
+  return rm_connected_components<Float_mesh>(mesh, params, num_kept);
+}
+
+int simplify_mesh(Double_mesh & mesh, Simplify_params const& params,
+                  Simplify_status * status) {
+  return simplify_mesh<Double_mesh>(mesh, params, status);
+}
+
+int simplify_mesh(Float_mesh & mesh, Simplify_params const& params,
+                  Simplify_status * status) {
+  return simplify_mesh<Float_mesh>(mesh, params, status);
+}
+
+int simplify_mesh_serial(Double_mesh & mesh, Simplify_params const& params,
+                         Simplify_status * status) {
+  return simplify_mesh_serial<Double_mesh>(mesh, params, status);
+}
+
+int simplify_mesh_serial(Float_mesh & mesh, Simplify_params const& params,
+                         Simplify_status * status) {
+  return simplify_mesh_serial<Float_mesh>(mesh, params, status);
+}
+
+int simplify_mesh_partitioned(Double_mesh & mesh, Simplify_params const& params,
+                              Simplify_status * status) {
+  return simplify_mesh_partitioned<Double_mesh>(mesh, params, status);
+}
+
+int simplify_mesh_partitioned(Float_mesh & mesh, Simplify_params const& params,
+                              Simplify_status * status) {
+  return simplify_mesh_partitioned<Float_mesh>(mesh, params, status);
+}
+
+int simplify_mesh_within_deviation(Double_mesh & mesh, Simplify_params const& params,
+                                   Simplify_deviation_report * report) {
+  return simplify_mesh_within_deviation<Double_mesh>(mesh, params, report);
+}
+
+int simplify_mesh_within_deviation(Float_mesh & mesh, Simplify_params const& params,
+                                   Simplify_deviation_report * report) {
+  return simplify_mesh_within_deviation<Float_mesh>(mesh, params, report);
+}
+
+int simplify_mesh_lods(Double_mesh & mesh, std::vector<double> ratios,
+                       std::function<void(std::size_t, Double_mesh &)> snapshot) {
+  return simplify_mesh_lods<Double_mesh>(mesh, ratios, snapshot);
+}
+
+int simplify_mesh_lods(Float_mesh & mesh, std::vector<double> ratios,
+                       std::function<void(std::size_t, Float_mesh &)> snapshot) {
+  return simplify_mesh_lods<Float_mesh>(mesh, ratios, snapshot);
+}
+
+int simplify_mesh_progressive(Double_mesh & mesh, Simplify_params const& params,
+                              Progressive_mesh_base & base,
+                              std::vector<Vertex_split> & collapses,
+                              Simplify_status * status) {
+  return simplify_mesh_progressive<Double_mesh>(mesh, params, base, collapses, status);
+}
+
+int simplify_mesh_progressive(Float_mesh & mesh, Simplify_params const& params,
+                              Progressive_mesh_base & base,
+                              std::vector<Vertex_split> & collapses,
+                              Simplify_status * status) {
+  return simplify_mesh_progressive<Float_mesh>(mesh, params, base, collapses, status);
+}
+
+std::size_t isotropic_remesh(Double_mesh & mesh, Isotropic_remesh_params const& params,
+                             Isotropic_remesh_report * report) {
+  return isotropic_remesh<Double_mesh>(mesh, params, report);
+}
+
+std::size_t isotropic_remesh(Float_mesh & mesh, Isotropic_remesh_params const& params,
+                             Isotropic_remesh_report * report) {
+  return isotropic_remesh<Float_mesh>(mesh, params, report);
+}
+
+std::size_t isotropic_remesh_serial(Double_mesh & mesh, Isotropic_remesh_params const& params,
+                                    Isotropic_remesh_report * report) {
+  return isotropic_remesh_serial<Double_mesh>(mesh, params, report);
+}
+
+std::size_t isotropic_remesh_serial(Float_mesh & mesh, Isotropic_remesh_params const& params,
+                                    Isotropic_remesh_report * report) {
+  return isotropic_remesh_serial<Float_mesh>(mesh, params, report);
+}
+
+std::size_t isotropic_remesh_partitioned(Double_mesh & mesh,
+                                         Isotropic_remesh_params const& params,
+                                         Isotropic_remesh_report * report) {
+  return isotropic_remesh_partitioned<Double_mesh>(mesh, params, report);
+}
+
+std::size_t isotropic_remesh_partitioned(Float_mesh & mesh,
+                                         Isotropic_remesh_params const& params,
+                                         Isotropic_remesh_report * report) {
+  return isotropic_remesh_partitioned<Float_mesh>(mesh, params, report);
+}
+
+bool mesh_from_view(Mesh_view const& view, Double_mesh & mesh) {
+
+  typedef Double_mesh::Point        Point;
+  typedef Double_mesh::Vertex_index Vertex_index;
+
+  if (view.coords.size % 3 != 0 || view.triangles.size % 3 != 0)
+    return false;
+  const std::size_t num_vertices = view.coords.size / 3;
+  const std::size_t num_faces    = view.triangles.size / 3;
+
+  mesh.clear();
+  mesh.reserve(num_vertices, num_vertices + num_faces, num_faces);
+  for (std::size_t it = 0; it < num_vertices; it++)
+    mesh.add_vertex(Point(view.coords[3 * it], view.coords[3 * it + 1],
+                          view.coords[3 * it + 2]));
+
+  for (std::size_t it = 0; it < num_faces; it++) {
+    std::uint32_t const* t = view.triangles.data + 3 * it;
+    if (t[0] >= num_vertices || t[1] >= num_vertices || t[2] >= num_vertices)
+      return false;
+    if (mesh.add_face(Vertex_index(t[0]), Vertex_index(t[1]), Vertex_index(t[2])) ==
+        Double_mesh::null_face())
+      return false;
+  }
+  return true;
+}
+
+Mesh_status mesh_to_buffer(Double_mesh const& mesh, Mesh_buffer & buffer) {
+
+  typedef Double_mesh::Vertex_index Vertex_index;
+  typedef Double_mesh::Face_index   Face_index;
+
+  buffer.num_vertices = mesh.number_of_vertices();
+  buffer.num_faces    = mesh.number_of_faces();
+  if (buffer.coords.size < 3 * buffer.num_vertices ||
+      buffer.triangles.size < 3 * buffer.num_faces)
+    return MESH_BUFFER_TOO_SMALL;
+  for (Face_index f : mesh.faces()) {
+    if (mesh.degree(f) != 3)
+      return MESH_INVALID_INPUT;
+  }
+
+  // Vertex indices in the output skip removed vertices
+  std::vector<std::uint32_t> out_index(mesh.num_vertices(), 0);
+  std::size_t count = 0;
+  for (Vertex_index v : mesh.vertices()) {
+    Double_mesh::Point const& p = mesh.point(v);
+    for (int c = 0; c < 3; c++)
+      buffer.coords[3 * count + c] = p[c];
+    out_index[v] = count++;
+  }
+
+  count = 0;
+  for (Face_index f : mesh.faces()) {
+    for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh))
+      buffer.triangles[count++] = out_index[v];
+  }
+  return MESH_OK;
+}
+
+// Fill a mesh from the input, run the operation on it, and write the
+// result to the output
+template <class Operation>
+Mesh_status run_on_view(Mesh_view const& input, Mesh_buffer & output, Operation operation) {
+  Double_mesh mesh;
+  if (!mesh_from_view(input, mesh))
+    return MESH_INVALID_INPUT;
+  operation(mesh);
+  return mesh_to_buffer(mesh, output);
+}
+
+Mesh_status fill_holes(Mesh_view const& input, Fill_holes_params const& params,
+                       Mesh_buffer & output, Fill_holes_report * report) {
+  bool valid_region = true;
+  Mesh_status status = run_on_view(input, output, [&](Double_mesh & mesh) {
+      valid_region = fill_holes<Double_mesh>(mesh, params, report) >= 0;
+    });
+  return valid_region ? status : MESH_INVALID_REGION;
+}
+
+Mesh_status smoothe_mesh(Mesh_view const& input, Smoothe_params const& params,
+                         Mesh_buffer & output) {
+  bool valid_region = true;
+  Mesh_status status = run_on_view(input, output, [&](Double_mesh & mesh) {
+      valid_region = smoothe_mesh<Double_mesh>(mesh, params) >= 0;
+    });
+  return valid_region ? status : MESH_INVALID_REGION;
+}
+
+Mesh_status rm_connected_components(Mesh_view const& input,
+                                    Rm_connected_components_params const& params,
+                                    Mesh_buffer & output, std::size_t * num_components) {
+  return run_on_view(input, output, [&](Double_mesh & mesh) {
+      std::size_t num = rm_connected_components<Double_mesh>(mesh, params);
+      if (num_components != NULL)
+        *num_components = num;
+    });
+}
+
+Mesh_status simplify_mesh(Mesh_view const& input, Simplify_params const& params,
+                          Mesh_buffer & output, Simplify_status * status) {
+  return run_on_view(input, output, [&](Double_mesh & mesh) {
+      simplify_mesh<Double_mesh>(mesh, params, status);
+    });
+}
+
+Mesh_status isotropic_remesh(Mesh_view const& input, Isotropic_remesh_params const& params,
+                             Mesh_buffer & output, Isotropic_remesh_report * report) {
+  return run_on_view(input, output, [&](Double_mesh & mesh) {
+      isotropic_remesh<Double_mesh>(mesh, params, report);
+    });
+}
+
+} // end namespace cgal_tools
@@ -0,0 +1,166 @@
+// The mesh operations of the tools as a library, for calling them in
+// process instead of writing a mesh to disk and running a tool on it.
+// Link with the cgal_tools library target. The operations are compiled
+// into the library for meshes storing double and single precision
+// points, so this header pulls in only the Surface_mesh, not the CGAL
+// algorithms.
+//
+// A Surface_mesh is worked on in place, as by the tools. A triangle
+// mesh can also be passed in arrays owned by the caller, and the result
+// is written to other caller-owned arrays, which may be the input ones.
+// Nothing is read from or written to files.
+
+#ifndef CGAL_TOOLS_CGAL_TOOLS_H
+#define CGAL_TOOLS_CGAL_TOOLS_H
+
+#include "mesh_types.h"
+#include "progressive_mesh.h"
+#include "tool_params.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace cgal_tools {
+
+// Operations on a Surface_mesh, with the same meaning as the templates
+// of the same names in fill_holes.h, smoothe_mesh.h,
+// rm_connected_components.h, simplify_mesh.h and isotropic_remesh.h.
+// All but smoothing leave the mesh with garbage, to be collected before
+// indexing its vertices or faces.
+
+int fill_holes(Double_mesh & mesh, Fill_holes_params const& params,
+               Fill_holes_report * report = NULL);
+int fill_holes(Float_mesh & mesh, Fill_holes_params const& params,
+               Fill_holes_report * report = NULL);
+int fill_holes_serial(Double_mesh & mesh, Fill_holes_params const& params,
+                      Fill_holes_report * report = NULL);
+int fill_holes_serial(Float_mesh & mesh, Fill_holes_params const& params,
+                      Fill_holes_report * report = NULL);
+
+std::ptrdiff_t smoothe_mesh(Double_mesh & mesh, Smoothe_params const& params,
+                            std::vector<double> * iteration_times = NULL);
+std::ptrdiff_t smoothe_mesh(Float_mesh & mesh, Smoothe_params const& params,
+                            std::vector<double> * iteration_times = NULL);
+
+std::size_t rm_connected_components(Double_mesh & mesh,
+                                    Rm_connected_components_params const& params,
+                                    std::size_t * num_kept = NULL);
+std::size_t rm_connected_components(Float_mesh & mesh,
+                                    Rm_connected_components_params const& params,
+                                    std::size_t * num_kept = NULL);
+
+int simplify_mesh(Double_mesh & mesh, Simplify_params const& params,
+                  Simplify_status * status = NULL);
+int simplify_mesh(Float_mesh & mesh, Simplify_params const& params,
+                  Simplify_status * status = NULL);
+int simplify_mesh_serial(Double_mesh & mesh, Simplify_params const& params,
+                         Simplify_status * status = NULL);
+int simplify_mesh_serial(Float_mesh & mesh, Simplify_params const& params,
+                         Simplify_status * status = NULL);
+int simplify_mesh_partitioned(Double_mesh & mesh, Simplify_params const& params,
+                              Simplify_status * status = NULL);
+int simplify_mesh_partitioned(Float_mesh & mesh, Simplify_params const& params,
+                              Simplify_status * status = NULL);
+int simplify_mesh_within_deviation(Double_mesh & mesh, Simplify_params const& params,
+                                   Simplify_deviation_report * report = NULL);
+int simplify_mesh_within_deviation(Float_mesh & mesh, Simplify_params const& params,
+                                   Simplify_deviation_report * report = NULL);
+int simplify_mesh_lods(Double_mesh & mesh, std::vector<double> ratios,
+                       std::function<void(std::size_t, Double_mesh &)> snapshot);
+int simplify_mesh_lods(Float_mesh & mesh, std::vector<double> ratios,
+                       std::function<void(std::size_t, Float_mesh &)> snapshot);
+int simplify_mesh_progressive(Double_mesh & mesh, Simplify_params const& params,
+                              Progressive_mesh_base & base,
+                              std::vector<Vertex_split> & collapses,
+                              Simplify_status * status = NULL);
+int simplify_mesh_progressive(Float_mesh & mesh, Simplify_params const& params,
+                              Progressive_mesh_base & base,
+                              std::vector<Vertex_split> & collapses,
+                              Simplify_status * status = NULL);
+
+std::size_t isotropic_remesh(Double_mesh & mesh, Isotropic_remesh_params const& params,
+                             Isotropic_remesh_report * report = NULL);
+std::size_t isotropic_remesh(Float_mesh & mesh, Isotropic_remesh_params const& params,
+                             Isotropic_remesh_report * report = NULL);
+std::size_t isotropic_remesh_serial(Double_mesh & mesh, Isotropic_remesh_params const& params,
+                                    Isotropic_remesh_report * report = NULL);
+std::size_t isotropic_remesh_serial(Float_mesh & mesh, Isotropic_remesh_params const& params,
+                                    Isotropic_remesh_report * report = NULL);
+std::size_t isotropic_remesh_partitioned(Double_mesh & mesh,
+                                         Isotropic_remesh_params const& params,
+                                         Isotropic_remesh_report * report = NULL);
+std::size_t isotropic_remesh_partitioned(Float_mesh & mesh,
+                                         Isotropic_remesh_params const& params,
+                                         Isotropic_remesh_report * report = NULL);
+
+// An array owned by someone else
+template <class T>
+struct Span {
+  T*          data;
+  std::size_t size;
+  Span(): data(NULL), size(0) {}
+  Span(T* data, std::size_t size): data(data), size(size) {}
+  T & operator[](std::size_t it) const { return data[it]; }
+};
+
+// A triangle mesh in caller-owned arrays: x, y, z of each vertex one
+// after another, and the three vertex indices of each triangle
+struct Mesh_view {
+  Span<const double>        coords;
+  Span<const std::uint32_t> triangles;
+  Mesh_view() {}
+  Mesh_view(Span<const double> coords, Span<const std::uint32_t> triangles):
+    coords(coords), triangles(triangles) {}
+};
+
+// Caller-owned arrays to write a triangle mesh to, laid out as in
+// Mesh_view. The sizes written are set, or, if the arrays are too
+// small, the sizes needed, in which case nothing is written.
+struct Mesh_buffer {
+  Span<double>        coords;
+  Span<std::uint32_t> triangles;
+  std::size_t num_vertices, num_faces;
+  Mesh_buffer(): num_vertices(0), num_faces(0) {}
+  Mesh_buffer(Span<double> coords, Span<std::uint32_t> triangles):
+    coords(coords), triangles(triangles), num_vertices(0), num_faces(0) {}
+};
+
+enum Mesh_status { MESH_OK = 0, MESH_INVALID_INPUT, MESH_BUFFER_TOO_SMALL,
+                   MESH_INVALID_REGION };
+
+// Fill the mesh from the arrays. Return false if they do not hold a
+// valid triangle mesh.
+bool mesh_from_view(Mesh_view const& view, Double_mesh & mesh);
+
+// Write the mesh, which may have garbage, to the arrays. All its faces
+// must be triangles.
+Mesh_status mesh_to_buffer(Double_mesh const& mesh, Mesh_buffer & buffer);
+
+// Operations on a triangle mesh in arrays, done in double precision.
+// Smoothing, removing connected components and simplifying never grow
+// the mesh, so the input arrays are always large enough for the
+// result. Filling holes and remeshing can add vertices and faces, so on
+// MESH_BUFFER_TOO_SMALL, call again with the sizes asked for. The call
+// again does the whole operation over; to do it only once, fill a mesh
+// with mesh_from_view(), run the operation on the mesh, and call
+// mesh_to_buffer() until the arrays are large enough. Filling holes and
+// smoothing return MESH_INVALID_REGION if the region of interest has no
+// faces, or for smoothing is not a valid mesh on its own.
+
+Mesh_status fill_holes(Mesh_view const& input, Fill_holes_params const& params,
+                       Mesh_buffer & output, Fill_holes_report * report = NULL);
+Mesh_status smoothe_mesh(Mesh_view const& input, Smoothe_params const& params,
+                         Mesh_buffer & output);
+Mesh_status rm_connected_components(Mesh_view const& input,
+                                    Rm_connected_components_params const& params,
+                                    Mesh_buffer & output, std::size_t * num_components = NULL);
+Mesh_status simplify_mesh(Mesh_view const& input, Simplify_params const& params,
+                          Mesh_buffer & output, Simplify_status * status = NULL);
+Mesh_status isotropic_remesh(Mesh_view const& input, Isotropic_remesh_params const& params,
+                             Mesh_buffer & output, Isotropic_remesh_report * report = NULL);
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_CGAL_TOOLS_H
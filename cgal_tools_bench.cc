@@ -0,0 +1,537 @@
+// Time the core operation of each tool on synthetic meshes of several
+// sizes, and write the results as CSV. Comparing these files between
+// builds, for example before and after changing the CGAL version,
+// shows performance regressions. The meshes are generated the same
+// way each time, so timings of different builds are comparable.
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Simple_cartesian.h>
+#include <CGAL/Surface_mesh.h>
+#include <CGAL/boost/graph/copy_face_graph.h>
+#include <CGAL/Polygon_mesh_processing/distance.h>
+#include <CGAL/version.h>
+
+#include "compressed_mesh.h"
+#include "fill_holes.h"
+#include "isotropic_remesh.h"
+#include "mesh_generators.h"
+#include "mesh_io.h"
+#include "mesh_reorder.h"
+#include "mesh_types.h"
+#include "rm_connected_components.h"
+#include "simplify_mesh.h"
+#include "smoothe_mesh.h"
+#include "tool_options.h"
+#include "tool_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The kernels the tools use
+typedef CGAL::Exact_predicates_inexact_constructions_kernel   K;
+typedef CGAL::Surface_mesh<K::Point_3>                        Mesh;
+typedef CGAL::Simple_cartesian<double>                        Simplify_kernel;
+typedef CGAL::Surface_mesh<Simplify_kernel::Point_3>          Simplify_mesh;
+typedef cgal_tools::Float_mesh                                Float_mesh;
+
+struct Bench_options {
+  std::vector<std::size_t> sizes;
+  int repeats;
+  int num_threads;
+  std::string temp_dir;
+  Bench_options(): repeats(3), num_threads(0), temp_dir(".") {}
+};
+
+// Collects the rows of the output file
+class Bench_report {
+public:
+  explicit Bench_report(std::ostream & out): out_(out) {
+    out_ << "cgal_version,operation,variant,num_faces,num_threads,seconds,peak_rss_mb,"
+         << "deviation,bytes\n";
+  }
+
+  // The deviation, if not negative, is the distance of the result to
+  // that of the default variant. The bytes, if not zero, are the size
+  // of what was written.
+  void add(std::string const& operation, std::string const& variant, std::size_t num_faces,
+           int num_threads, double seconds, double peak_rss_mb, double deviation = -1,
+           std::size_t bytes = 0) {
+    out_ << CGAL_VERSION_STR << "," << operation << "," << variant << "," << num_faces << ","
+         << num_threads << "," << seconds << "," << peak_rss_mb << ",";
+    if (deviation >= 0)
+      out_ << deviation;
+    out_ << ",";
+    if (bytes > 0)
+      out_ << bytes;
+    out_ << "\n";
+    out_.flush();
+    printf("%-24s %-10s %10zu faces %3d threads %10.4f s %9.1f MB",
+           operation.c_str(), variant.c_str(), num_faces, num_threads, seconds, peak_rss_mb);
+    if (deviation >= 0)
+      printf("  deviation %g", deviation);
+    if (bytes > 0)
+      printf("  %.1f bytes/face", double(bytes) / std::max<std::size_t>(num_faces, 1));
+    printf("\n");
+  }
+
+private:
+  std::ostream & out_;
+};
+
+// Run prepare and then op the given number of times, and keep the
+// best time and the largest peak memory of op. If given, deviation and
+// bytes are called at the end to measure the result.
+void time_operation(Bench_report & report, std::string const& operation,
+                    std::string const& variant, std::size_t num_faces, int num_threads,
+                    int repeats, std::function<void()> prepare, std::function<void()> op,
+                    std::function<double()> deviation = std::function<double()>(),
+                    std::function<std::size_t()> bytes = std::function<std::size_t()>()) {
+  double best_time = -1, peak_rss = 0;
+  for (int it = 0; it < repeats; it++) {
+    prepare();
+    cgal_tools::reset_peak_rss();
+    double start = cgal_tools::wall_time();
+    op();
+    double elapsed = cgal_tools::wall_time() - start;
+    if (best_time < 0 || elapsed < best_time)
+      best_time = elapsed;
+    peak_rss = std::max(peak_rss, cgal_tools::peak_rss_mb());
+  }
+  report.add(operation, variant, num_faces, num_threads, best_time, peak_rss,
+             deviation ? deviation() : -1, bytes ? bytes() : 0);
+}
+
+// The size of a file, 0 if it cannot be read
+std::size_t file_size(std::string const& file) {
+  std::ifstream in(file.c_str(), std::ios::binary | std::ios::ate);
+  return in ? std::size_t(in.tellg()) : 0;
+}
+
+// The approximate Hausdorff distance between a single precision result
+// and the double precision one
+template <class Mesh>
+double float32_deviation(Float_mesh const& result, Mesh const& reference) {
+  namespace PMP = CGAL::Polygon_mesh_processing;
+  Mesh promoted, collected = reference;
+  CGAL::copy_face_graph(result, promoted);
+  collected.collect_garbage();
+  return PMP::approximate_symmetric_Hausdorff_distance<CGAL::Sequential_tag>(promoted, collected);
+}
+
+void bench_io(Bench_report & report, Bench_options const& opt, std::size_t size) {
+  cgal_tools::Soup soup;
+  cgal_tools::make_noisy_sphere(size, 1.0, 0.01, 1, soup);
+  Mesh mesh;
+  cgal_tools::soup_to_mesh(soup, mesh);
+  std::size_t num_faces = mesh.number_of_faces();
+
+  for (int binary = 1; binary >= 0; binary--) {
+    std::string variant = binary ? "binary" : "ascii";
+    std::string file = opt.temp_dir + "/cgal_tools_bench_" + variant + ".ply";
+
+    time_operation(report, "ply_write", variant, num_faces, 1, opt.repeats,
+                   []() {},
+                   [&]() {
+                     if (!cgal_tools::write_mesh(file, mesh, binary))
+                       std::cerr << "Failed writing: " << file << std::endl;
+                   },
+                   std::function<double()>(),
+                   [&]() { return file_size(file); });
+
+    Mesh input;
+    time_operation(report, "ply_read", variant, num_faces, 1, opt.repeats,
+                   [&]() { input.clear(); },
+                   [&]() {
+                     if (!cgal_tools::read_mesh(file, input))
+                       std::cerr << "Failed reading: " << file << std::endl;
+                   });
+
+    // The CGAL reader, which the parallel ASCII parser must match bit for bit
+    if (!binary) {
+      Mesh reference;
+      time_operation(report, "ply_read", "ascii_cgal", num_faces, 1, opt.repeats,
+                     [&]() { reference.clear(); },
+                     [&]() {
+                       if (!CGAL::Polygon_mesh_processing::IO::read_polygon_mesh(file, reference))
+                         std::cerr << "Failed reading: " << file << std::endl;
+                     });
+      bool identical = (reference.number_of_vertices() == input.number_of_vertices() &&
+                        reference.number_of_faces() == input.number_of_faces());
+      for (Mesh::Vertex_index v : input.vertices())
+        identical = identical && reference.point(v) == input.point(v);
+      if (!identical)
+        std::cerr << "The ASCII parser and the CGAL reader disagree." << std::endl;
+    }
+    std::remove(file.c_str());
+  }
+}
+
+// The largest coordinate error of a decoded mesh, whose vertex i is
+// point order[i] of the input. Faces must match up to rotation.
+double compressed_round_trip_error(cgal_tools::Flat_soup const& input,
+                                   cgal_tools::Flat_soup const& decoded,
+                                   std::vector<std::uint32_t> const& order) {
+  if (decoded.num_points() != input.num_points() ||
+      decoded.num_polygons() != input.num_polygons() || order.size() != input.num_points()) {
+    std::cerr << "The compressed mesh has the wrong size." << std::endl;
+    return -1;
+  }
+  double error = 0;
+  for (std::size_t v = 0; v < order.size(); v++)
+    for (int c = 0; c < 3; c++)
+      error = std::max(error, std::abs(decoded.coords[3 * v + c] -
+                                       input.coords[3 * order[v] + c]));
+
+  // Each face as its vertices in the input, starting with the smallest
+  auto faces = [](cgal_tools::Flat_soup const& soup, std::vector<std::uint32_t> const* map) {
+    std::vector<std::vector<std::uint32_t> > result(soup.num_polygons());
+    for (std::size_t p = 0; p < soup.num_polygons(); p++) {
+      for (std::size_t it = soup.offsets[p]; it < soup.offsets[p + 1]; it++)
+        result[p].push_back(map ? (*map)[soup.indices[it]] : soup.indices[it]);
+      std::rotate(result[p].begin(), std::min_element(result[p].begin(), result[p].end()),
+                  result[p].end());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  if (faces(input, NULL) != faces(decoded, &order))
+    std::cerr << "The compressed mesh has different faces." << std::endl;
+  return error;
+}
+
+// Time encoding and decoding the compressed format in memory, with
+// quantized and exact coordinates. The deviation is the largest
+// coordinate error after a round trip, and the bytes are the encoded
+// size, to compare with that of ply_write.
+void bench_compressed(Bench_report & report, Bench_options const& opt, std::size_t size) {
+  cgal_tools::Soup soup;
+  cgal_tools::make_noisy_sphere(size, 1.0, 0.01, 1, soup);
+  Mesh mesh;
+  cgal_tools::soup_to_mesh(soup, mesh);
+  std::size_t num_faces = mesh.number_of_faces();
+  int num_threads = cgal_tools::resolve_num_threads(opt.num_threads);
+  cgal_tools::Flat_soup input, decoded;
+  cgal_tools::mesh_to_flat_soup(mesh, input);
+
+  for (int bits : {16, 0}) {
+    std::string variant = bits > 0 ? "q" + std::to_string(bits) : "exact";
+    std::vector<char> data;
+    std::vector<std::uint32_t> order;
+    time_operation(report, "cmesh_encode", variant, num_faces, num_threads, opt.repeats,
+                   []() {},
+                   [&]() {
+                     if (!cgal_tools::encode_compressed_mesh(input, bits, opt.num_threads,
+                                                             data, &order))
+                       std::cerr << "Failed encoding." << std::endl;
+                   },
+                   std::function<double()>(),
+                   [&]() { return data.size(); });
+    time_operation(report, "cmesh_decode", variant, num_faces, num_threads, opt.repeats,
+                   [&]() { decoded = cgal_tools::Flat_soup(); },
+                   [&]() {
+                     if (!cgal_tools::decode_compressed_mesh(data.data(), data.size(),
+                                                             opt.num_threads, decoded))
+                       std::cerr << "Failed decoding." << std::endl;
+                   },
+                   [&]() { return compressed_round_trip_error(input, decoded, order); });
+  }
+}
+
+void bench_smoothe(Bench_report & report, Bench_options const& opt, std::size_t size) {
+  cgal_tools::Soup soup;
+  cgal_tools::make_noisy_sphere(size, 1.0, 0.01, 2, soup);
+  Mesh original, mesh;
+  cgal_tools::soup_to_mesh(soup, original);
+  std::size_t num_faces = original.number_of_faces();
+
+  cgal_tools::Smoothe_params params;
+  params.num_iterations = 1;
+  time_operation(report, "smoothe_mesh", "implicit", num_faces, 1, opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::smoothe_mesh(mesh, params); });
+
+  // A few percent of the sphere, around the point (1, 0, 0)
+  params.roi.has_box = true;
+  params.roi.box     = {{0.8, -0.3, -0.3, 1.1, 0.3, 0.3}};
+  time_operation(report, "smoothe_mesh", "implicit_roi", num_faces, 1, opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::smoothe_mesh(mesh, params); });
+  params.roi = cgal_tools::Mesh_roi();
+
+  params.method         = "taubin";
+  params.num_iterations = 10;
+  params.num_threads    = opt.num_threads;
+  time_operation(report, "smoothe_mesh", "taubin", num_faces,
+                 cgal_tools::resolve_num_threads(opt.num_threads), opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::smoothe_mesh(mesh, params); });
+
+  Float_mesh float_original, float_mesh;
+  cgal_tools::soup_to_mesh(soup, float_original);
+  time_operation(report, "smoothe_mesh", "taubin_f32", num_faces,
+                 cgal_tools::resolve_num_threads(opt.num_threads), opt.repeats,
+                 [&]() { float_mesh = float_original; },
+                 [&]() { cgal_tools::smoothe_mesh(float_mesh, params); },
+                 [&]() { return float32_deviation(float_mesh, mesh); });
+}
+
+void bench_fill_holes(Bench_report & report, Bench_options const& opt, std::size_t size) {
+  cgal_tools::Soup soup;
+  std::size_t hole_faces = std::max<std::size_t>(20, size / 1000);
+  cgal_tools::make_sphere_with_holes(size, 16, hole_faces, 0.01, 3, soup);
+  Mesh original, mesh;
+  cgal_tools::soup_to_mesh(soup, original);
+  std::size_t num_faces = original.number_of_faces();
+
+  cgal_tools::Fill_holes_params params;
+  params.max_hole_diam      = 10.0;
+  params.max_num_hole_edges = 1000000;
+  time_operation(report, "fill_holes", "serial", num_faces, 1, opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::fill_holes(mesh, params); });
+
+  Float_mesh float_original, float_mesh;
+  cgal_tools::soup_to_mesh(soup, float_original);
+  time_operation(report, "fill_holes", "serial_f32", num_faces, 1, opt.repeats,
+                 [&]() { float_mesh = float_original; },
+                 [&]() { cgal_tools::fill_holes(float_mesh, params); },
+                 [&]() { return float32_deviation(float_mesh, mesh); });
+
+  params.num_threads = cgal_tools::resolve_num_threads(opt.num_threads);
+  time_operation(report, "fill_holes", "parallel", num_faces, params.num_threads, opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::fill_holes(mesh, params); });
+
+  params.triangulate_max_edges = 8;
+  params.refine_max_edges      = 64;
+  time_operation(report, "fill_holes", "tiered", num_faces, params.num_threads, opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::fill_holes(mesh, params); });
+}
+
+void bench_rm_connected_components(Bench_report & report, Bench_options const& opt,
+                                   std::size_t size) {
+  cgal_tools::Soup soup;
+  std::size_t num_components = std::max<std::size_t>(10, size / 1000);
+  cgal_tools::make_floating_components(size, num_components, 32, 4, soup);
+  Mesh original, mesh;
+  cgal_tools::soup_to_mesh(soup, original);
+  std::size_t num_faces = original.number_of_faces();
+
+  cgal_tools::Rm_connected_components_params params;
+  params.num_min_faces_in_component = 100;
+  params.num_components_to_keep     = 1;
+  params.num_threads                = opt.num_threads;
+  time_operation(report, "rm_connected_components", "default", num_faces,
+                 cgal_tools::resolve_num_threads(opt.num_threads), opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::rm_connected_components(mesh, params); });
+
+  Float_mesh float_original, float_mesh;
+  cgal_tools::soup_to_mesh(soup, float_original);
+  time_operation(report, "rm_connected_components", "default_f32", num_faces,
+                 cgal_tools::resolve_num_threads(opt.num_threads), opt.repeats,
+                 [&]() { float_mesh = float_original; },
+                 [&]() { cgal_tools::rm_connected_components(float_mesh, params); },
+                 [&]() { return float32_deviation(float_mesh, mesh); });
+}
+
+void bench_simplify(Bench_report & report, Bench_options const& opt, std::size_t size) {
+  cgal_tools::Soup soup;
+  cgal_tools::make_noisy_torus(size, 1.0, 0.3, 0.01, 5, soup);
+  Simplify_mesh original, mesh;
+  cgal_tools::soup_to_mesh(soup, original);
+  std::size_t num_faces = original.number_of_faces();
+
+  cgal_tools::Simplify_params params;
+  params.edge_keep_ratio = 0.1;
+  time_operation(report, "simplify_mesh", "serial", num_faces, 1, opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::simplify_mesh(mesh, params); });
+
+  Float_mesh float_original, float_mesh;
+  cgal_tools::soup_to_mesh(soup, float_original);
+  time_operation(report, "simplify_mesh", "serial_f32", num_faces, 1, opt.repeats,
+                 [&]() { float_mesh = float_original; },
+                 [&]() { cgal_tools::simplify_mesh(float_mesh, params); },
+                 [&]() { return float32_deviation(float_mesh, mesh); });
+
+  params.num_threads = cgal_tools::resolve_num_threads(opt.num_threads);
+  time_operation(report, "simplify_mesh", "partitioned", num_faces, params.num_threads,
+                 opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::simplify_mesh(mesh, params); });
+
+  // Twice the noise, so the search goes well below the input resolution
+  cgal_tools::Simplify_params bounded;
+  bounded.edge_keep_ratio = 0.01;
+  bounded.max_deviation   = 0.02;
+  time_operation(report, "simplify_mesh", "max_deviation", num_faces,
+                 cgal_tools::resolve_num_threads(0), opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::simplify_mesh_within_deviation(mesh, bounded); });
+}
+
+void bench_isotropic_remesh(Bench_report & report, Bench_options const& opt,
+                            std::size_t size) {
+  namespace PMP = CGAL::Polygon_mesh_processing;
+  cgal_tools::Soup soup;
+  cgal_tools::make_noisy_sphere(size, 1.0, 0.01, 8, soup);
+  Mesh original, mesh, serial;
+  cgal_tools::soup_to_mesh(soup, original);
+  std::size_t num_faces = original.number_of_faces();
+
+  // Keep about the number of faces
+  double total_length = 0;
+  for (Mesh::Edge_index e : original.edges())
+    total_length += std::sqrt(CGAL::squared_distance(original.point(original.vertex(e, 0)),
+                                                     original.point(original.vertex(e, 1))));
+  cgal_tools::Isotropic_remesh_params params;
+  params.target_edge_length = total_length / std::max<std::size_t>(1, original.number_of_edges());
+  params.num_iterations     = 3;
+  time_operation(report, "isotropic_remesh", "serial", num_faces, 1, opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::isotropic_remesh(mesh, params); });
+  serial = mesh;
+  serial.collect_garbage();
+
+  params.num_threads = cgal_tools::resolve_num_threads(opt.num_threads);
+  time_operation(report, "isotropic_remesh", "partitioned", num_faces, params.num_threads,
+                 opt.repeats,
+                 [&]() { mesh = original; },
+                 [&]() { cgal_tools::isotropic_remesh(mesh, params); },
+                 [&]() {
+                   mesh.collect_garbage();
+                   return PMP::approximate_symmetric_Hausdorff_distance<CGAL::Sequential_tag>
+                     (mesh, serial);
+                 });
+}
+
+// Fisher-Yates, with the generator of the test meshes
+template <class T>
+void shuffle_vector(std::vector<T> & items, cgal_tools::Bench_random & rng) {
+  for (std::size_t it = items.size(); it > 1; it--)
+    std::swap(items[it - 1], items[std::min(it - 1, std::size_t(rng.uniform() * it))]);
+}
+
+// Put the vertices and faces of the mesh in random order, as they come
+// in meshes from photogrammetry
+template <class Mesh>
+bool shuffle_mesh(Mesh const& mesh, std::uint64_t seed, Mesh & result) {
+  std::vector<typename Mesh::Vertex_index> vertex_order(mesh.vertices().begin(),
+                                                        mesh.vertices().end());
+  std::vector<typename Mesh::Face_index> face_order(mesh.faces().begin(), mesh.faces().end());
+  cgal_tools::Bench_random rng(seed);
+  shuffle_vector(vertex_order, rng);
+  shuffle_vector(face_order, rng);
+  return cgal_tools::permute_mesh(mesh, vertex_order, face_order, result);
+}
+
+// Time the core of the tools on a mesh in random order, and on the same
+// mesh renumbered along a Hilbert curve, as with --reorder
+void bench_reorder(Bench_report & report, Bench_options const& opt, std::size_t size) {
+  cgal_tools::Soup soup;
+  cgal_tools::make_noisy_torus(size, 1.0, 0.3, 0.01, 6, soup);
+  Mesh generated, shuffled, reordered, mesh;
+  cgal_tools::soup_to_mesh(soup, generated);
+  if (!shuffle_mesh(generated, 7, shuffled)) {
+    std::cerr << "Could not shuffle the mesh." << std::endl;
+    return;
+  }
+  std::size_t num_faces = shuffled.number_of_faces();
+  int num_threads = cgal_tools::resolve_num_threads(opt.num_threads);
+
+  time_operation(report, "reorder", "hilbert", num_faces, 1, opt.repeats,
+                 [&]() { reordered = shuffled; },
+                 [&]() { cgal_tools::hilbert_reorder_mesh(reordered, false); });
+
+  cgal_tools::Smoothe_params implicit, taubin;
+  implicit.num_iterations = 1;
+  taubin.method           = "taubin";
+  taubin.num_iterations   = 10;
+  taubin.num_threads      = opt.num_threads;
+  cgal_tools::Rm_connected_components_params rm_cc;
+  rm_cc.num_min_faces_in_component = 100;
+  rm_cc.num_threads                = opt.num_threads;
+  cgal_tools::Simplify_params simplify;
+  simplify.edge_keep_ratio = 0.1;
+
+  for (int it = 0; it < 2; it++) {
+    Mesh const& input = (it == 0) ? shuffled : reordered;
+    std::string order = (it == 0) ? "shuffled" : "hilbert";
+    time_operation(report, "smoothe_mesh", "implicit_" + order, num_faces, 1, opt.repeats,
+                   [&]() { mesh = input; },
+                   [&]() { cgal_tools::smoothe_mesh(mesh, implicit); });
+    time_operation(report, "smoothe_mesh", "taubin_" + order, num_faces, num_threads,
+                   opt.repeats,
+                   [&]() { mesh = input; },
+                   [&]() { cgal_tools::smoothe_mesh(mesh, taubin); });
+    time_operation(report, "rm_connected_components", order, num_faces, num_threads,
+                   opt.repeats,
+                   [&]() { mesh = input; },
+                   [&]() { cgal_tools::rm_connected_components(mesh, rm_cc); });
+    time_operation(report, "simplify_mesh", "serial_" + order, num_faces, 1, opt.repeats,
+                   [&]() { mesh = input; },
+                   [&]() { cgal_tools::simplify_mesh(mesh, simplify); });
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  Bench_options opt;
+  std::string sizes = "10000,100000,1000000";
+  std::string output_file = "cgal_tools_bench.csv";
+  cgal_tools::extract_option(argc, argv, "sizes", sizes);
+  cgal_tools::extract_option(argc, argv, "repeats", opt.repeats);
+  cgal_tools::extract_option(argc, argv, "num_threads", opt.num_threads);
+  cgal_tools::extract_option(argc, argv, "temp_dir", opt.temp_dir);
+  cgal_tools::extract_option(argc, argv, "output", output_file);
+
+  std::istringstream is(sizes);
+  std::string size;
+  while (std::getline(is, size, ','))
+    if (atol(size.c_str()) > 0)
+      opt.sizes.push_back(atol(size.c_str()));
+
+  if (argc != 1 || opt.sizes.empty() || opt.repeats < 1 ||
+      !cgal_tools::check_no_unknown_options(argc, argv)) {
+    std::cout << "Usage: " << argv[0]
+              << " [--sizes n1,n2,...] [--repeats N] [--num_threads N]"
+              << " [--temp_dir dir] [--output file.csv]\n"
+              << "Time each tool on generated meshes with about the given numbers of\n"
+              << "faces (default 10000,100000,1000000). The best of the repeats is kept.\n";
+    return 1;
+  }
+
+  std::ofstream out(output_file.c_str());
+  if (!out) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
+  }
+
+  std::cout << "CGAL version:  " << CGAL_VERSION_STR << "\n";
+  std::cout << "Repeats:       " << opt.repeats << "\n";
+  std::cout << "Writing:       " << output_file << std::endl;
+
+  Bench_report report(out);
+  for (std::size_t size : opt.sizes) {
+    bench_io(report, opt, size);
+    bench_compressed(report, opt, size);
+    bench_smoothe(report, opt, size);
+    bench_fill_holes(report, opt, size);
+    bench_rm_connected_components(report, opt, size);
+    bench_simplify(report, opt, size);
+    bench_isotropic_remesh(report, opt, size);
+    bench_reorder(report, opt, size);
+  }
+
+  return 0;
+}
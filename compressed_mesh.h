@@ -0,0 +1,444 @@
+// A compact mesh file format, for shipping results rather than working
+// on them. Coordinates are quantized to a grid over the bounding box
+// with a chosen number of bits, or kept exactly, and stored as varint
+// deltas from the previous vertex. Faces are put in Z-order of their
+// vertices, vertices are numbered in the order faces first use them,
+// and each face index is stored as a varint of how far back it points,
+// zero for a vertex not seen before, which takes one byte for most
+// indices. Vertices and faces are split into blocks that do not depend
+// on each other, so both ends work on several threads. This has no
+// CGAL dependency.
+//
+// The layout, all little-endian:
+//   "CMSH", version            4 bytes each
+//   num_vertices, num_faces,   8 bytes each
+//   num_indices
+//   quantization_bits, flags   4 bytes each; bits 0 means exact
+//   origin x, y, z, step       doubles
+//   vertices_per_block,        4 bytes each
+//   faces_per_block
+//   per vertex block: size     8 bytes
+//   per face block: size, indices before it, vertices first used
+//                   before it  8 bytes each
+//   the vertex blocks, then the face blocks
+//
+// The order of vertices and faces is not kept, nor any property but
+// the points and the faces.
+
+#ifndef CGAL_TOOLS_COMPRESSED_MESH_H
+#define CGAL_TOOLS_COMPRESSED_MESH_H
+
+#include "parallel_for.h"
+#include "ply_io.h"
+#include "polygon_soup.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cgal_tools {
+
+const std::uint32_t CMESH_VERSION          = 1;
+const std::uint32_t CMESH_ALL_TRIANGLES    = 1;
+const std::size_t   CMESH_VERTICES_PER_BLOCK = 1 << 16;
+const std::size_t   CMESH_FACES_PER_BLOCK    = 1 << 16;
+
+// Whether the file name has the extension of this format
+inline bool has_compressed_mesh_extension(std::string const& file) {
+  const std::string extension = ".cmesh";
+  return file.size() >= extension.size() &&
+    file.compare(file.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+inline bool is_compressed_mesh(const char* data, std::size_t size) {
+  return size >= 4 && std::memcmp(data, "CMSH", 4) == 0;
+}
+
+inline void put_varint(std::uint64_t value, std::vector<char> & out) {
+  while (value >= 0x80) {
+    out.push_back(char(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(char(value));
+}
+
+// Read a varint at ptr and advance it. Return false if it runs past end.
+inline bool get_varint(const char* & ptr, const char* end, std::uint64_t & value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && ptr < end; shift += 7) {
+    std::uint8_t byte = *ptr++;
+    value |= std::uint64_t(byte & 0x7f) << shift;
+    if (byte < 0x80)
+      return true;
+  }
+  return false;
+}
+
+inline std::uint64_t zigzag(std::uint64_t delta) {
+  return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+inline std::uint64_t unzigzag(std::uint64_t value) {
+  return (value >> 1) ^ (0 - (value & 1));
+}
+
+template <class T>
+void put_raw(T value, std::vector<char> & out) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <class T>
+bool get_raw(const char* & ptr, const char* end, T & value) {
+  if (std::size_t(end - ptr) < sizeof(T))
+    return false;
+  std::memcpy(&value, ptr, sizeof(T));
+  ptr += sizeof(T);
+  return true;
+}
+
+// Spread the low 21 bits of x to every third bit
+inline std::uint64_t morton_spread(std::uint64_t x) {
+  x &= 0x1fffff;
+  x = (x | (x << 32)) & 0x1f00000000ffffull;
+  x = (x | (x << 16)) & 0x1f0000ff0000ffull;
+  x = (x | (x << 8))  & 0x100f00f00f00f00full;
+  x = (x | (x << 4))  & 0x10c30c30c30c30c3ull;
+  x = (x | (x << 2))  & 0x1249249249249249ull;
+  return x;
+}
+
+// The grid coordinates are round((x - origin) / step), in [0, 2^bits)
+struct Cmesh_grid {
+  int    bits;
+  double origin[3];
+  double step;
+
+  Cmesh_grid(Flat_soup const& soup, int bits): bits(bits), step(1) {
+    double max[3];
+    for (int c = 0; c < 3; c++) {
+      origin[c] = soup.num_points() > 0 ? soup.coords[c] : 0;
+      max[c] = origin[c];
+    }
+    for (std::size_t it = 0; it < soup.coords.size(); it++) {
+      origin[it % 3] = std::min(origin[it % 3], soup.coords[it]);
+      max[it % 3]    = std::max(max[it % 3], soup.coords[it]);
+    }
+    double extent = std::max(max[0] - origin[0], std::max(max[1] - origin[1],
+                                                          max[2] - origin[2]));
+    if (extent > 0)
+      step = extent / double((std::uint64_t(1) << (bits > 0 ? bits : 21)) - 1);
+  }
+
+  std::uint32_t quantize(double x, int c, int num_bits) const {
+    double q = std::floor((x - origin[c]) / step + 0.5);
+    double limit = double((std::uint64_t(1) << num_bits) - 1);
+    return std::uint32_t(std::max(0.0, std::min(q, limit)));
+  }
+};
+
+// Encode the soup. Bits from 1 to 31 quantize the coordinates, with an
+// error of at most half the grid step, bits 0 keeps them exactly. If
+// given, vertex_order is set to the input point of each vertex
+// written. Return false if the soup has out of range indices.
+inline bool encode_compressed_mesh(Flat_soup const& soup, int bits, int num_threads,
+                                   std::vector<char> & out,
+                                   std::vector<std::uint32_t> * vertex_order = NULL) {
+  const std::size_t num_points   = soup.num_points();
+  const std::size_t num_polygons = soup.num_polygons();
+  if (bits < 0 || bits > 31 || !host_is_little_endian() ||
+      num_points >= std::numeric_limits<std::uint32_t>::max() ||
+      num_polygons >= std::numeric_limits<std::uint32_t>::max())
+    return false;
+  for (std::uint32_t index : soup.indices)
+    if (index >= num_points)
+      return false;
+
+  Cmesh_grid grid(soup, bits);
+
+  // The Z-order position of each point on a 21 bit grid
+  std::vector<std::uint64_t> morton(num_points);
+  const int order_bits = (bits > 0) ? std::min(bits, 21) : 21;
+  parallel_for(0, num_points, num_threads, [&](std::size_t v) {
+      std::uint64_t code = 0;
+      for (int c = 0; c < 3; c++) {
+        std::uint64_t q = grid.quantize(soup.coords[3 * v + c], c, bits > 0 ? bits : 21);
+        code |= morton_spread(q >> (bits > 0 ? bits - order_bits : 0)) << c;
+      }
+      morton[v] = code;
+    }, 4096);
+
+  // Faces by their first vertex in Z-order
+  std::vector<std::pair<std::uint64_t, std::uint32_t> > keyed(num_polygons);
+  parallel_for(0, num_polygons, num_threads, [&](std::size_t p) {
+      std::uint64_t key = std::numeric_limits<std::uint64_t>::max();
+      for (std::size_t it = soup.offsets[p]; it < soup.offsets[p + 1]; it++)
+        key = std::min(key, morton[soup.indices[it]]);
+      keyed[p] = std::make_pair(key, std::uint32_t(p));
+    }, 4096);
+  std::sort(keyed.begin(), keyed.end());
+
+  // Vertices in the order the faces first use them, then unused ones
+  const std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+  std::vector<std::uint32_t> new_index(num_points, none);
+  std::vector<std::uint32_t> order;
+  order.reserve(num_points);
+  for (std::pair<std::uint64_t, std::uint32_t> const& k : keyed)
+    for (std::size_t it = soup.offsets[k.second]; it < soup.offsets[k.second + 1]; it++) {
+      std::uint32_t v = soup.indices[it];
+      if (new_index[v] == none) {
+        new_index[v] = order.size();
+        order.push_back(v);
+      }
+    }
+  std::vector<std::pair<std::uint64_t, std::uint32_t> > unused;
+  for (std::size_t v = 0; v < num_points; v++)
+    if (new_index[v] == none)
+      unused.push_back(std::make_pair(morton[v], std::uint32_t(v)));
+  std::sort(unused.begin(), unused.end());
+  for (std::pair<std::uint64_t, std::uint32_t> const& u : unused) {
+    new_index[u.second] = order.size();
+    order.push_back(u.second);
+  }
+  std::vector<std::uint64_t>().swap(morton);
+
+  // Where each face block starts in the indices, and how many
+  // vertices were first used before it
+  const std::size_t num_vertex_blocks =
+    (num_points + CMESH_VERTICES_PER_BLOCK - 1) / CMESH_VERTICES_PER_BLOCK;
+  const std::size_t num_face_blocks =
+    (num_polygons + CMESH_FACES_PER_BLOCK - 1) / CMESH_FACES_PER_BLOCK;
+  std::vector<std::uint64_t> first_index(num_face_blocks, 0), first_next(num_face_blocks, 0);
+  {
+    std::uint64_t num_indices = 0, next = 0;
+    for (std::size_t p = 0; p < num_polygons; p++) {
+      if (p % CMESH_FACES_PER_BLOCK == 0) {
+        first_index[p / CMESH_FACES_PER_BLOCK] = num_indices;
+        first_next[p / CMESH_FACES_PER_BLOCK]  = next;
+      }
+      std::uint32_t f = keyed[p].second;
+      for (std::size_t it = soup.offsets[f]; it < soup.offsets[f + 1]; it++)
+        next = std::max<std::uint64_t>(next, new_index[soup.indices[it]] + 1);
+      num_indices += soup.degree(f);
+    }
+  }
+
+  std::vector<std::vector<char> > blocks(num_vertex_blocks + num_face_blocks);
+  const bool all_triangles = soup.all_triangles();
+  parallel_for(0, blocks.size(), num_threads, [&](std::size_t b) {
+      std::vector<char> & block = blocks[b];
+      if (b < num_vertex_blocks) {
+        std::size_t begin = b * CMESH_VERTICES_PER_BLOCK;
+        std::size_t end   = std::min(begin + CMESH_VERTICES_PER_BLOCK, num_points);
+        block.reserve(6 * (end - begin));
+        std::uint64_t prev[3] = {0, 0, 0};
+        for (std::size_t v = begin; v < end; v++)
+          for (int c = 0; c < 3; c++) {
+            double x = soup.coords[3 * order[v] + c];
+            std::uint64_t value;
+            if (bits > 0)
+              value = grid.quantize(x, c, bits);
+            else
+              std::memcpy(&value, &x, sizeof(value));
+            put_varint(zigzag(value - prev[c]), block);
+            prev[c] = value;
+          }
+        return;
+      }
+      std::size_t fb    = b - num_vertex_blocks;
+      std::size_t begin = fb * CMESH_FACES_PER_BLOCK;
+      std::size_t end   = std::min(begin + CMESH_FACES_PER_BLOCK, num_polygons);
+      block.reserve(4 * (end - begin));
+      std::uint64_t next = first_next[fb];
+      for (std::size_t p = begin; p < end; p++) {
+        std::uint32_t f = keyed[p].second;
+        if (!all_triangles)
+          put_varint(soup.degree(f), block);
+        for (std::size_t it = soup.offsets[f]; it < soup.offsets[f + 1]; it++) {
+          std::uint64_t index = new_index[soup.indices[it]];
+          put_varint(next - index, block);
+          if (index == next)
+            next++;
+        }
+      }
+    });
+
+  out.clear();
+  out.insert(out.end(), "CMSH", "CMSH" + 4);
+  put_raw<std::uint32_t>(CMESH_VERSION, out);
+  put_raw<std::uint64_t>(num_points, out);
+  put_raw<std::uint64_t>(num_polygons, out);
+  put_raw<std::uint64_t>(soup.indices.size(), out);
+  put_raw<std::uint32_t>(bits, out);
+  put_raw<std::uint32_t>(all_triangles ? CMESH_ALL_TRIANGLES : 0, out);
+  for (int c = 0; c < 3; c++)
+    put_raw<double>(grid.origin[c], out);
+  put_raw<double>(grid.step, out);
+  put_raw<std::uint32_t>(CMESH_VERTICES_PER_BLOCK, out);
+  put_raw<std::uint32_t>(CMESH_FACES_PER_BLOCK, out);
+  for (std::size_t b = 0; b < num_vertex_blocks; b++)
+    put_raw<std::uint64_t>(blocks[b].size(), out);
+  for (std::size_t fb = 0; fb < num_face_blocks; fb++) {
+    put_raw<std::uint64_t>(blocks[num_vertex_blocks + fb].size(), out);
+    put_raw<std::uint64_t>(first_index[fb], out);
+    put_raw<std::uint64_t>(first_next[fb], out);
+  }
+
+  std::vector<std::size_t> block_start(blocks.size() + 1, out.size());
+  for (std::size_t b = 0; b < blocks.size(); b++)
+    block_start[b + 1] = block_start[b] + blocks[b].size();
+  out.resize(block_start.back());
+  parallel_for(0, blocks.size(), num_threads, [&](std::size_t b) {
+      std::copy(blocks[b].begin(), blocks[b].end(), out.begin() + block_start[b]);
+      std::vector<char>().swap(blocks[b]);
+    });
+
+  if (vertex_order != NULL)
+    vertex_order->swap(order);
+  return true;
+}
+
+// Decode a mesh encoded as above into the soup. Return false if the
+// data is not of this format or is damaged.
+inline bool decode_compressed_mesh(const char* data, std::size_t size, int num_threads,
+                                   Flat_soup & soup) {
+  const char* ptr = data;
+  const char* end = data + size;
+  std::uint32_t version = 0, bits = 0, flags = 0, vertices_per_block = 0, faces_per_block = 0;
+  std::uint64_t num_points = 0, num_polygons = 0, num_indices = 0;
+  double origin[3], step = 0;
+  if (!is_compressed_mesh(data, size) || !host_is_little_endian())
+    return false;
+  ptr += 4;
+  if (!get_raw(ptr, end, version) || version != CMESH_VERSION ||
+      !get_raw(ptr, end, num_points) || !get_raw(ptr, end, num_polygons) ||
+      !get_raw(ptr, end, num_indices) || !get_raw(ptr, end, bits) ||
+      !get_raw(ptr, end, flags) || !get_raw(ptr, end, origin[0]) ||
+      !get_raw(ptr, end, origin[1]) || !get_raw(ptr, end, origin[2]) ||
+      !get_raw(ptr, end, step) || !get_raw(ptr, end, vertices_per_block) ||
+      !get_raw(ptr, end, faces_per_block))
+    return false;
+  // Each coordinate and index takes at least a byte, which bounds what
+  // a damaged header can make us allocate
+  const bool all_triangles = (flags & CMESH_ALL_TRIANGLES) != 0;
+  if (bits > 31 || vertices_per_block == 0 || faces_per_block == 0 ||
+      num_points > size / 3 || num_indices > size || num_polygons > num_indices ||
+      num_points >= std::numeric_limits<std::uint32_t>::max() ||
+      (all_triangles && num_indices != 3 * num_polygons))
+    return false;
+
+  const std::size_t num_vertex_blocks =
+    (num_points + vertices_per_block - 1) / vertices_per_block;
+  const std::size_t num_face_blocks = (num_polygons + faces_per_block - 1) / faces_per_block;
+  if (num_vertex_blocks + num_face_blocks > size)
+    return false;
+  std::vector<std::uint64_t> block_size(num_vertex_blocks + num_face_blocks);
+  std::vector<std::uint64_t> first_index(num_face_blocks), first_next(num_face_blocks);
+  for (std::size_t b = 0; b < num_vertex_blocks; b++)
+    if (!get_raw(ptr, end, block_size[b]))
+      return false;
+  for (std::size_t fb = 0; fb < num_face_blocks; fb++)
+    if (!get_raw(ptr, end, block_size[num_vertex_blocks + fb]) ||
+        !get_raw(ptr, end, first_index[fb]) || !get_raw(ptr, end, first_next[fb]) ||
+        first_index[fb] > num_indices || first_next[fb] > num_points)
+      return false;
+
+  std::vector<const char*> block_start(block_size.size() + 1, ptr);
+  for (std::size_t b = 0; b < block_size.size(); b++) {
+    if (block_size[b] > std::uint64_t(end - block_start[b]))
+      return false;
+    block_start[b + 1] = block_start[b] + block_size[b];
+  }
+  if (block_start.back() != end)
+    return false;
+
+  soup = Flat_soup();
+  soup.coords.resize(3 * num_points);
+  soup.indices.resize(num_indices);
+  soup.offsets.resize(num_polygons + 1);
+  std::vector<char> ok(block_size.size(), 0);
+  parallel_for(0, block_size.size(), num_threads, [&](std::size_t b) {
+      const char* p = block_start[b];
+      const char* stop = block_start[b + 1];
+      std::uint64_t value;
+      if (b < num_vertex_blocks) {
+        std::size_t begin = b * vertices_per_block;
+        std::size_t last  = std::min<std::size_t>(begin + vertices_per_block, num_points);
+        std::uint64_t prev[3] = {0, 0, 0};
+        for (std::size_t v = begin; v < last; v++)
+          for (int c = 0; c < 3; c++) {
+            if (!get_varint(p, stop, value))
+              return;
+            prev[c] += unzigzag(value);
+            double x;
+            if (bits > 0)
+              x = origin[c] + double(prev[c]) * step;
+            else
+              std::memcpy(&x, &prev[c], sizeof(x));
+            soup.coords[3 * v + c] = x;
+          }
+        ok[b] = (p == stop);
+        return;
+      }
+      std::size_t fb    = b - num_vertex_blocks;
+      std::size_t begin = fb * faces_per_block;
+      std::size_t last  = std::min<std::size_t>(begin + faces_per_block, num_polygons);
+      std::uint64_t index_pos = first_index[fb];
+      std::uint64_t next = first_next[fb];
+      for (std::size_t f = begin; f < last; f++) {
+        std::uint64_t degree = 3;
+        if (!all_triangles && !get_varint(p, stop, degree))
+          return;
+        soup.offsets[f] = index_pos;
+        if (degree > num_indices - index_pos)
+          return;
+        for (std::uint64_t it = 0; it < degree; it++) {
+          if (!get_varint(p, stop, value) || value > next)
+            return;
+          std::uint64_t index = next - value;
+          if (value == 0 && ++next > num_points)
+            return;
+          soup.indices[index_pos++] = std::uint32_t(index);
+        }
+      }
+      // The next block must start where this one ends
+      std::uint64_t expected = (fb + 1 < num_face_blocks) ? first_index[fb + 1] : num_indices;
+      ok[b] = (p == stop && index_pos == expected &&
+               (fb + 1 == num_face_blocks || next == first_next[fb + 1]));
+    });
+
+  for (char block_ok : ok)
+    if (!block_ok)
+      return false;
+  soup.offsets[num_polygons] = num_indices;
+  return true;
+}
+
+// Read a compressed mesh file into the soup
+inline bool read_compressed_mesh_soup(std::string const& file, int num_threads,
+                                      Flat_soup & soup) {
+  Mapped_file mapped;
+  return mapped.open(file) &&
+    decode_compressed_mesh(mapped.data(), mapped.size(), num_threads, soup);
+}
+
+inline bool write_compressed_mesh_file(std::string const& file, Flat_soup const& soup,
+                                       int bits, int num_threads) {
+  std::vector<char> data;
+  if (!encode_compressed_mesh(soup, bits, num_threads, data))
+    return false;
+  std::ofstream out(file.c_str(), std::ios::binary);
+  out.write(data.data(), data.size());
+  out.close();
+  return !out.fail();
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_COMPRESSED_MESH_H
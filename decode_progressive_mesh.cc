@@ -0,0 +1,123 @@
+// Rebuild a mesh at a chosen resolution from a progressive mesh
+// written by simplify_mesh --progressive_mesh, and optionally time
+// moving between resolutions.
+
+#include "ply_io.h"
+#include "progressive_mesh.h"
+#include "tool_options.h"
+#include "tool_stats.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+bool write_ply(std::string const& output_file,
+               std::vector<std::array<double, 3> > const& points,
+               std::vector<std::array<std::uint32_t, 3> > const& faces) {
+  if (!cgal_tools::host_is_little_endian())
+    return false;
+  cgal_tools::Ply_binary_writer writer(output_file);
+  if (!writer.is_open())
+    return false;
+  writer.write_header(points.size(), faces.size(), "double");
+  for (std::array<double, 3> const& p : points)
+    for (int c = 0; c < 3; c++)
+      writer.put<double>(p[c]);
+  for (std::array<std::uint32_t, 3> const& f : faces) {
+    writer.put<std::uint8_t>(3);
+    for (int c = 0; c < 3; c++)
+      writer.put<std::int32_t>(f[c]);
+  }
+  return writer.close();
+}
+
+// Refine from the base mesh to the full one, coarsen back, and visit
+// a number of levels in between, printing the speed of each
+void run_benchmark(cgal_tools::Progressive_mesh & pm) {
+  std::size_t n = pm.num_splits();
+  double start = cgal_tools::wall_time();
+  pm.set_level(n);
+  double refine_time = cgal_tools::wall_time() - start;
+  start = cgal_tools::wall_time();
+  pm.set_level(0);
+  double coarsen_time = cgal_tools::wall_time() - start;
+
+  printf("%-20s %10.4f s %14.0f splits/s\n", "refine all", refine_time,
+         n / std::max(refine_time, 1e-9));
+  printf("%-20s %10.4f s %14.0f splits/s\n", "coarsen all", coarsen_time,
+         n / std::max(coarsen_time, 1e-9));
+
+  // Each step goes to the next tenth, then the mesh is extracted as a
+  // client would to display it
+  std::vector<std::array<double, 3> > points;
+  std::vector<std::array<std::uint32_t, 3> > faces;
+  for (int step = 1; step <= 10; step++) {
+    std::size_t level = n * step / 10;
+    start = cgal_tools::wall_time();
+    pm.set_level(level);
+    double split_time = cgal_tools::wall_time() - start;
+    start = cgal_tools::wall_time();
+    pm.extract(points, faces);
+    double extract_time = cgal_tools::wall_time() - start;
+    printf("level %10zu %10zu faces  splits %8.4f s  extract %8.4f s\n", level,
+           faces.size(), split_time, extract_time);
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  double fraction = 1.0;
+  int level = -1;
+  cgal_tools::extract_option(argc, argv, "fraction", fraction);
+  cgal_tools::extract_option(argc, argv, "level", level);
+  bool benchmark = cgal_tools::extract_flag(argc, argv, "benchmark");
+
+  if (argc < 2 || argc > 3 || (argc < 3 && !benchmark) ||
+      !cgal_tools::check_no_unknown_options(argc, argv)) {
+    std::cout << "Usage: " << argv[0]
+              << " [--level K | --fraction F] [--benchmark] input.pm [output.ply]\n"
+              << "Write the mesh with the first K vertex splits applied to the base\n"
+              << "mesh, or the given fraction of them, from 0 for the base mesh to 1\n"
+              << "(the default) for the full one. With --benchmark, time refining and\n"
+              << "coarsening through all levels.\n";
+    return 1;
+  }
+
+  const char* input_file = argv[1];
+  std::cout << "Reading: " << input_file << std::endl;
+  double start = cgal_tools::wall_time();
+  cgal_tools::Progressive_mesh pm;
+  if (!pm.read(input_file)) {
+    std::cerr << "Invalid input." << std::endl;
+    return 1;
+  }
+  std::cout << "Base mesh:      " << pm.num_faces() << " faces\n";
+  std::cout << "Vertex splits:  " << pm.num_splits() << "\n";
+  std::cout << "Read time:      " << cgal_tools::wall_time() - start << " s\n";
+
+  if (benchmark)
+    run_benchmark(pm);
+
+  if (argc < 3)
+    return 0;
+
+  std::size_t target = level >= 0 ? std::size_t(level) :
+    std::size_t(std::max(0.0, std::min(1.0, fraction)) * pm.num_splits() + 0.5);
+  pm.set_level(target);
+  std::vector<std::array<double, 3> > points;
+  std::vector<std::array<std::uint32_t, 3> > faces;
+  pm.extract(points, faces);
+
+  const char* output_file = argv[2];
+  std::cout << "Writing level " << pm.level() << " (" << faces.size() << " faces): "
+            << output_file << std::endl;
+  if (!write_ply(output_file, points, faces)) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,49 +1,114 @@
-#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
-#include <CGAL/Surface_mesh.h>
+#include "cgal_tools.h"
+#include "mesh_io.h"
+#include "mesh_reorder.h"
+#include "mesh_roi.h"
+#include "mesh_types.h"
+#include "parallel_for.h"
+#include "result_cache.h"
+#include "tool_options.h"
+#include "tool_stats.h"
+
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
 
-#include <CGAL/Polygon_mesh_processing/triangulate_hole.h>
-#include <CGAL/Polygon_mesh_processing/border.h>
-#include <CGAL/Polygon_mesh_processing/IO/polygon_mesh_io.h>
+typedef cgal_tools::Double_mesh Mesh;
 
-#include <CGAL/IO/PLY.h>
+// Read, fill and write the mesh, stored with the points of Mesh
+template <class Mesh>
+int process_mesh(cgal_tools::Fill_holes_params const& params, bool compare_serial,
+                 const char* input_file, const char* output_file, bool binary_output,
+                 int quantization_bits, bool reorder, bool keep_reorder,
+                 cgal_tools::Tool_stats & stats) {
 
-#include <boost/lexical_cast.hpp>
+  stats.start_phase("read");
+  Mesh mesh;
+  if(!cgal_tools::read_mesh(input_file, mesh)) {
+    std::cerr << "Invalid input." << std::endl;
+    return 1;
+  }
 
-#include <iostream>
-#include <fstream>
-#include <vector>
-#include <set>
-
-typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel;
-typedef Kernel::Point_3                                     Point;
-typedef CGAL::Surface_mesh<Point>                           Mesh;
-
-typedef boost::graph_traits<Mesh>::vertex_descriptor        vertex_descriptor;
-typedef boost::graph_traits<Mesh>::halfedge_descriptor      halfedge_descriptor;
-typedef boost::graph_traits<Mesh>::face_descriptor          face_descriptor;
-
-namespace PMP = CGAL::Polygon_mesh_processing;
-
-bool is_small_hole(halfedge_descriptor h, Mesh & mesh,
-                   double max_hole_diam, int max_num_hole_edges)
-{
-  int num_hole_edges = 0;
-  CGAL::Bbox_3 hole_bbox;
-  for (halfedge_descriptor hc : CGAL::halfedges_around_face(h, mesh))
-  {
-    const Point& p = mesh.point(target(hc, mesh));
-
-    hole_bbox += p.bbox();
-    ++num_hole_edges;
-
-    // Exit early, to avoid unnecessary traversal of large holes
-    if (num_hole_edges > max_num_hole_edges) return false;
-    if (hole_bbox.xmax() - hole_bbox.xmin() > max_hole_diam) return false;
-    if (hole_bbox.ymax() - hole_bbox.ymin() > max_hole_diam) return false;
-    if (hole_bbox.zmax() - hole_bbox.zmin() > max_hole_diam) return false;
+  if (!cgal_tools::roi_faces_in_mesh(mesh, params.roi)) {
+    std::cerr << "Some faces of the region of interest are not in the mesh." << std::endl;
+    return 1;
+  }
+
+  if (reorder) {
+    stats.start_phase("reorder");
+    if (!cgal_tools::hilbert_reorder_mesh(mesh, !keep_reorder))
+      std::cout << "Could not reorder the mesh, keeping its order.\n";
+  }
+
+  // Time the serial path on a copy, to see what the threads buy
+  stats.set_count("input_faces", mesh.number_of_faces());
+  double serial_time = -1;
+  if (compare_serial && params.num_threads > 0) {
+    Mesh copy = mesh;
+    stats.start_phase("fill_holes_serial");
+    cgal_tools::fill_holes_serial(copy, params);
+    stats.end_phase();
+    serial_time = stats.last_phase().wall_seconds;
+    std::cout << "Serial hole filling time:   " << serial_time << " s\n";
+  }
+
+  stats.start_phase("fill_holes");
+  cgal_tools::Fill_holes_report report;
+  int nb_holes = cgal_tools::fill_holes(mesh, params, &report);
+  stats.end_phase();
+  if (nb_holes < 0) {
+    std::cerr << "The region of interest has no faces." << std::endl;
+    return 1;
+  }
+  double fill_time = stats.last_phase().wall_seconds;
+  stats.set_count("holes_found", report.num_found);
+  stats.set_count("holes_filled", report.num_filled);
+  stats.set_count("out_of_time", report.out_of_time);
+  stats.set_count("output_faces", mesh.number_of_faces());
+  std::cout << "Filled " << nb_holes << " holes.\n";
+  if (report.num_filled < nb_holes)
+    std::cout << "Failed to fill " << nb_holes - report.num_filled << " of them.\n";
+  if (report.out_of_time)
+    std::cout << "The time budget ran out with " << report.num_found - nb_holes
+              << " of " << report.num_found << " holes left.\n";
+
+  printf("%-12s %8s %8s %10s\n", "tier", "holes", "filled", "time (s)");
+  for (int tier = 0; tier < cgal_tools::NUM_HOLE_TIERS; tier++) {
+    cgal_tools::Hole_tier_stats const& t = report.tiers[tier];
+    std::string name = cgal_tools::hole_tier_name(tier);
+    printf("%-12s %8d %8d %10.3f\n", name.c_str(), t.num_holes, t.num_filled, t.seconds);
+    stats.set_count(name + "_holes", t.num_holes);
+    stats.set_count(name + "_seconds", t.seconds);
+  }
+
+  if (serial_time >= 0) {
+    std::cout << "Parallel hole filling time: " << fill_time << " s on "
+              << cgal_tools::resolve_num_threads(params.num_threads) << " threads\n";
+    std::cout << "Speedup:                    " << serial_time / std::max(fill_time, 1e-9)
+              << "\n";
+  }
+
+  if (reorder && !keep_reorder) {
+    stats.start_phase("restore_order");
+    if (!cgal_tools::restore_mesh_order(mesh))
+      std::cout << "Could not restore the input order, writing the spatial order.\n";
+  }
+
+  std::cout << "Writing output mesh: " << output_file << std::endl;
+  stats.start_phase("write");
+  if (!cgal_tools::write_mesh(output_file, mesh, binary_output, quantization_bits)) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
   }
 
-  return true;
+  stats.end_phase();
+  std::cout << "Peak memory: " << stats.max_phase_rss_mb() << " MB\n";
+
+  stats.emit();
+  return 0;
 }
 
 // Incrementally fill the holes that are no larger than given diameter
@@ -51,59 +116,93 @@ bool is_small_hole(halfedge_descriptor h, Mesh & mesh,
 
 int main(int argc, char* argv[]) {
 
-  if (argc < 5) {
-    std::cout << "Usage: " << argv[0]
-              << " max_hole_diameter max_num_hole_edges input.ply output.ply\n";
+  cgal_tools::Fill_holes_params params;
+  cgal_tools::Tool_stats stats("fill_holes");
+  cgal_tools::extract_stats_options(argc, argv, stats);
+  cgal_tools::Result_cache cache;
+  cgal_tools::extract_cache_options(argc, argv, cache);
+  bool binary_output  = cgal_tools::extract_flag(argc, argv, "binary");
+  bool compare_serial = cgal_tools::extract_flag(argc, argv, "compare_serial");
+  bool float32        = cgal_tools::extract_flag(argc, argv, "float32");
+  bool keep_reorder   = cgal_tools::extract_flag(argc, argv, "keep_reorder");
+  bool reorder        = cgal_tools::extract_flag(argc, argv, "reorder") || keep_reorder;
+  cgal_tools::extract_option(argc, argv, "num_threads", params.num_threads);
+  int quantization_bits = 16;
+  cgal_tools::extract_option(argc, argv, "quantization_bits", quantization_bits);
+  if (!cgal_tools::extract_roi_options(argc, argv, params.roi))
+    return 1;
+  // The face indices are those of the input
+  if (reorder && !params.roi.faces.empty()) {
+    std::cerr << "--roi_faces cannot be used with --reorder or --keep_reorder." << std::endl;
     return 1;
   }
+  cgal_tools::extract_option(argc, argv, "max_seconds", params.max_seconds);
+  cgal_tools::extract_option(argc, argv, "triangulate_max_edges", params.triangulate_max_edges);
+  cgal_tools::extract_option(argc, argv, "triangulate_max_diam", params.triangulate_max_diam);
+  cgal_tools::extract_option(argc, argv, "refine_max_edges", params.refine_max_edges);
+  cgal_tools::extract_option(argc, argv, "refine_max_diam", params.refine_max_diam);
   
-  double max_hole_diam    = atof(argv[1]);
-  int max_num_hole_edges  = atoi(argv[2]);
-  const char* input_file  = argv[3];
-  const char* output_file = argv[4];
-
-  std::cout << "Reading mesh:       " << input_file << std::endl;
-  std::cout << "Max num hole edges: " << max_num_hole_edges << "\n";
-  std::cout << "Max hole diameter:  " << max_hole_diam << "\n";
-  
-  Mesh mesh;
-  if(!PMP::IO::read_polygon_mesh(input_file, mesh)) {
-    std::cerr << "Invalid input." << std::endl;
+  if (argc < 5 || !cgal_tools::check_no_unknown_options(argc, argv)) {
+    std::cout << "Usage: " << argv[0]
+              << " [--binary] [--quantization_bits B] [--float32]"
+              << " [--reorder | --keep_reorder]"
+              << " [--num_threads N [--compare_serial]] [--max_seconds T]"
+              << " [--triangulate_max_edges N [--triangulate_max_diam D]]"
+              << " [--refine_max_edges N [--refine_max_diam D]] "
+              << cgal_tools::roi_usage() << " " << cgal_tools::stats_usage() << " "
+              << cgal_tools::cache_usage()
+              << " max_hole_diameter max_num_hole_edges input.ply output.ply\n"
+              << "With --max_seconds, the smallest holes are filled first, and no new\n"
+              << "hole is started after that many seconds.\n"
+              << "By default all holes are triangulated, refined and faired. Holes with\n"
+              << "at most --triangulate_max_edges edges, and no wider than\n"
+              << "--triangulate_max_diam if given, are only triangulated, and those\n"
+              << "within the --refine_ limits are triangulated and refined, which is\n"
+              << "much faster. The holes and time of each tier are printed.\n"
+              << "With --roi_box or --roi_faces, only the holes along a region of interest\n"
+              << "are filled: the faces with a vertex in the box, and the faces listed by\n"
+              << "their index in the input in a file, with --roi_rings rings of faces around\n"
+              << "them (default 2). The time then depends on the size of the region.\n"
+              << "With --reorder, the vertices and faces are renumbered along a space-filling\n"
+              << "curve before processing, which makes memory access faster, and put back\n"
+              << "in the input order before writing. With --keep_reorder the new order is\n"
+              << "kept in the output.\n"
+              << "Output files named .cmesh are written in a compressed format, with\n"
+              << "coordinates quantized to --quantization_bits (default 16, 0 for exact).\n";
     return 1;
   }
 
-  unsigned int nb_holes = 0;
-  std::vector<halfedge_descriptor> border_cycles;
-
-  // collect one halfedge per boundary cycle
-  PMP::extract_boundary_cycles(mesh, std::back_inserter(border_cycles));
-
-  for(halfedge_descriptor h : border_cycles)
-  {
-    if(max_hole_diam > 0 && max_num_hole_edges > 0 &&
-       !is_small_hole(h, mesh, max_hole_diam, max_num_hole_edges))
-      continue;
-
-    std::vector<face_descriptor>  patch_facets;
-    std::vector<vertex_descriptor> patch_vertices;
-    bool success =
-      std::get<0>(PMP::triangulate_refine_and_fair_hole(mesh,
-                                                        h,
-                                                        std::back_inserter(patch_facets),
-                                                        std::back_inserter(patch_vertices)));
-    
-    //std::cout << "* Number of facets in constructed patch: " << patch_facets.size() << std::endl;
-    //std::cout << "  Number of vertices in constructed patch: " << patch_vertices.size() << std::endl;
-    //std::cout << "  Is fairing successful: " << success << std::endl;
-    ++nb_holes;
-  }
-
-  //std::cout << std::endl;
-  //std::cout << nb_holes << " holes have been filled" << std::endl;
+  params.max_hole_diam      = atof(argv[1]);
+  params.max_num_hole_edges = atoi(argv[2]);
+  const char* input_file    = argv[3];
+  const char* output_file   = argv[4];
 
-  std::cout << "Writing output mesh: " << output_file << std::endl;
-  CGAL::IO::write_PLY(output_file, mesh,
-                      CGAL::parameters::stream_precision(17).use_binary_mode(false));
-
-  return 0;
+  std::cout << "Reading mesh:       " << input_file << std::endl;
+  std::cout << "Max num hole edges: " << params.max_num_hole_edges << "\n";
+  std::cout << "Max hole diameter:  " << params.max_hole_diam << "\n";
+  
+  // A run with a time budget may not give the same result twice, and a
+  // comparison with the serial code is run for its timings
+  if (params.max_seconds > 0 || compare_serial)
+    cache.set_directory("");
+  std::ostringstream cache_params;
+  cache_params.precision(17);
+  cache_params << params.max_hole_diam << " " << params.max_num_hole_edges << " "
+               << params.triangulate_max_edges << " " << params.triangulate_max_diam << " "
+               << params.refine_max_edges << " " << params.refine_max_diam << " "
+               << (params.num_threads > 0) << " " << binary_output << " "
+               << quantization_bits << " " << float32 << " " << reorder << " "
+               << keep_reorder << " " << cgal_tools::roi_description(params.roi);
+
+  return cgal_tools::run_with_cache(cache, "fill_holes", cache_params.str(), input_file,
+                                    output_file, stats, [&]() {
+      if (float32)
+        return process_mesh<cgal_tools::Float_mesh>(params, compare_serial, input_file,
+                                                    output_file, binary_output,
+                                                    quantization_bits, reorder,
+                                                    keep_reorder, stats);
+      return process_mesh<Mesh>(params, compare_serial, input_file, output_file,
+                                binary_output, quantization_bits, reorder, keep_reorder,
+                                stats);
+    });
 }
@@ -0,0 +1,444 @@
+// Hole filling, shared by the fill_holes tool and the pipeline.
+
+#ifndef CGAL_TOOLS_FILL_HOLES_H
+#define CGAL_TOOLS_FILL_HOLES_H
+
+#include <CGAL/Polygon_mesh_processing/triangulate_hole.h>
+#include <CGAL/Polygon_mesh_processing/border.h>
+
+#include "mesh_roi.h"
+#include "mesh_types.h"
+#include "parallel_for.h"
+#include "submesh.h"
+#include "tool_params.h"
+#include "tool_stats.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <iterator>
+#include <tuple>
+#include <vector>
+
+namespace cgal_tools {
+
+template <class Mesh>
+bool is_small_hole(typename boost::graph_traits<Mesh>::halfedge_descriptor h, Mesh & mesh,
+                   double max_hole_diam, int max_num_hole_edges)
+{
+  typedef typename boost::graph_traits<Mesh>::halfedge_descriptor halfedge_descriptor;
+  typedef typename Mesh::Point                                    Point;
+  
+  int num_hole_edges = 0;
+  CGAL::Bbox_3 hole_bbox;
+  for (halfedge_descriptor hc : CGAL::halfedges_around_face(h, mesh))
+  {
+    const Point& p = mesh.point(target(hc, mesh));
+
+    hole_bbox += p.bbox();
+    ++num_hole_edges;
+
+    // Exit early, to avoid unnecessary traversal of large holes
+    if (num_hole_edges > max_num_hole_edges) return false;
+    if (hole_bbox.xmax() - hole_bbox.xmin() > max_hole_diam) return false;
+    if (hole_bbox.ymax() - hole_bbox.ymin() > max_hole_diam) return false;
+    if (hole_bbox.zmax() - hole_bbox.zmin() > max_hole_diam) return false;
+  }
+
+  return true;
+}
+
+// Pick the tier of a hole from its number of edges and the largest
+// side of its bounding box
+template <class Mesh>
+Hole_tier hole_tier(typename boost::graph_traits<Mesh>::halfedge_descriptor h,
+                    Mesh const& mesh, Fill_holes_params const& params) {
+  typedef typename boost::graph_traits<Mesh>::halfedge_descriptor halfedge_descriptor;
+
+  int num_hole_edges = 0;
+  CGAL::Bbox_3 hole_bbox;
+  for (halfedge_descriptor hc : CGAL::halfedges_around_face(h, mesh)) {
+    hole_bbox += mesh.point(target(hc, mesh)).bbox();
+    ++num_hole_edges;
+  }
+  double diam = std::max(hole_bbox.xmax() - hole_bbox.xmin(),
+                         std::max(hole_bbox.ymax() - hole_bbox.ymin(),
+                                  hole_bbox.zmax() - hole_bbox.zmin()));
+
+  if (num_hole_edges <= params.triangulate_max_edges &&
+      (params.triangulate_max_diam <= 0 || diam <= params.triangulate_max_diam))
+    return HOLE_TRIANGULATE;
+  if (num_hole_edges <= params.refine_max_edges &&
+      (params.refine_max_diam <= 0 || diam <= params.refine_max_diam))
+    return HOLE_REFINE;
+  return HOLE_FAIR;
+}
+
+// Fill one hole given by a border halfedge, appending the new faces
+// and vertices to the outputs. Return true if all went well.
+//
+// Small holes are triangulated searching all possible triangles, which
+// is cheap for few edges. Faired holes restrict the search to the
+// faces of the 3D Delaunay triangulation of the boundary, which scales
+// much better with the number of edges.
+template <class Mesh, class FaceOutputIterator, class VertexOutputIterator>
+bool fill_hole(Mesh & mesh, typename boost::graph_traits<Mesh>::halfedge_descriptor h,
+               FaceOutputIterator patch_facets, VertexOutputIterator patch_vertices,
+               Hole_tier tier = HOLE_FAIR) {
+  namespace PMP = CGAL::Polygon_mesh_processing;
+  typedef typename boost::graph_traits<Mesh>::face_descriptor face_descriptor;
+
+  // Only the fairing says whether it worked; the other tiers fail by
+  // producing no faces
+  std::vector<face_descriptor> faces;
+  switch (tier) {
+  case HOLE_TRIANGULATE:
+    PMP::triangulate_hole(mesh, h, std::back_inserter(faces),
+                          CGAL::parameters::use_delaunay_triangulation(false));
+    break;
+  case HOLE_REFINE:
+    PMP::triangulate_and_refine_hole(mesh, h, std::back_inserter(faces), patch_vertices,
+                                     CGAL::parameters::use_delaunay_triangulation(false));
+    break;
+  default:
+    return std::get<0>(PMP::triangulate_refine_and_fair_hole
+                       (mesh, h, patch_facets, patch_vertices,
+                        CGAL::parameters::use_delaunay_triangulation(true)));
+  }
+  std::copy(faces.begin(), faces.end(), patch_facets);
+  return !faces.empty();
+}
+
+// Collect one halfedge per hole to be filled, of those along the
+// region of interest if there is one. Return false, finding no holes,
+// if the region has no faces.
+template <class Mesh>
+bool find_holes(Mesh & mesh, Fill_holes_params const& params,
+                std::vector<typename boost::graph_traits<Mesh>::halfedge_descriptor> & holes) {
+  typedef typename boost::graph_traits<Mesh>::halfedge_descriptor halfedge_descriptor;
+  namespace PMP = CGAL::Polygon_mesh_processing;
+
+  // collect one halfedge per boundary cycle, or with a region of
+  // interest per cycle along its faces, without walking the whole mesh
+  holes.clear();
+  std::vector<halfedge_descriptor> border_cycles;
+  if (params.roi.empty()) {
+    PMP::extract_boundary_cycles(mesh, std::back_inserter(border_cycles));
+  } else {
+    std::vector<typename Mesh::Face_index> roi_faces;
+    select_roi_faces(mesh, params.roi, roi_faces);
+    if (roi_faces.empty())
+      return false;
+    roi_boundary_cycles(mesh, roi_faces, border_cycles);
+  }
+
+  for (halfedge_descriptor h : border_cycles) {
+    if(params.max_hole_diam > 0 && params.max_num_hole_edges > 0 &&
+       !is_small_hole(h, mesh, params.max_hole_diam, params.max_num_hole_edges))
+      continue;
+    holes.push_back(h);
+  }
+
+  // With a time budget, do first the holes with the fewest edges,
+  // which are the quickest to fill
+  if (params.max_seconds > 0) {
+    std::vector<std::pair<std::size_t, halfedge_descriptor> > sized;
+    for (halfedge_descriptor h : holes) {
+      std::size_t num_edges = 0;
+      for (halfedge_descriptor hc : CGAL::halfedges_around_face(h, mesh)) {
+        (void)hc;
+        num_edges++;
+      }
+      sized.push_back(std::make_pair(num_edges, h));
+    }
+    std::stable_sort(sized.begin(), sized.end(),
+                     [](std::pair<std::size_t, halfedge_descriptor> const& a,
+                        std::pair<std::size_t, halfedge_descriptor> const& b) {
+                       return a.first < b.first;
+                     });
+    for (std::size_t it = 0; it < holes.size(); it++)
+      holes[it] = sized[it].second;
+  }
+  return true;
+}
+
+// The faces and new vertices filling a hole, before they are added to
+// the mesh. A face corner that is not negative is an existing vertex
+// of the mesh, while corner -1-k is new vertex k of the patch.
+template <class Mesh>
+struct Hole_patch {
+  bool computed;
+  std::vector<typename Mesh::Point>     new_points;
+  std::vector<std::array<long long, 3>> faces;
+  double seconds;       // spent computing it
+  Hole_patch(): computed(false), seconds(0) {}
+};
+
+// How many rings of faces around a hole are copied with it. Fairing
+// looks at the neighbours of the hole boundary vertices, and the
+// cotangent weights at those need their incident faces too.
+const int HOLE_NEIGHBOURHOOD_RINGS = 3;
+
+// Compute the patch filling a hole on a copy of its neighbourhood,
+// leaving the mesh untouched. Safe to call from several threads. The
+// copy is in double precision, which fairing needs.
+template <class Mesh>
+void compute_hole_patch(Mesh const& mesh,
+                        typename boost::graph_traits<Mesh>::halfedge_descriptor h,
+                        Hole_tier tier, Hole_patch<Mesh> & patch) {
+
+  typedef typename Mesh::Vertex_index   Vertex_index;
+  typedef typename Mesh::Halfedge_index Halfedge_index;
+  typedef typename Mesh::Face_index     Face_index;
+
+  patch = Hole_patch<Mesh>();
+
+  std::vector<Vertex_index> hole_vertices;
+  for (Halfedge_index hc : CGAL::halfedges_around_face(h, mesh))
+    hole_vertices.push_back(mesh.target(hc));
+
+  std::vector<Face_index> faces;
+  collect_face_rings(mesh, hole_vertices, HOLE_NEIGHBOURHOOD_RINGS, faces);
+
+  typedef typename Promoted_mesh<Mesh>::type Local_mesh;
+  Local_mesh local;
+  std::vector<Vertex_index> local_to_global;
+  if (!extract_submesh(mesh, faces, local, local_to_global))
+    return;
+
+  // Find the hole in the copy
+  Vertex_index src = Mesh::null_vertex(), tgt = Mesh::null_vertex();
+  for (std::size_t it = 0; it < local_to_global.size(); it++) {
+    if (local_to_global[it] == mesh.source(h)) src = Vertex_index(it);
+    if (local_to_global[it] == mesh.target(h)) tgt = Vertex_index(it);
+  }
+  if (src == Mesh::null_vertex() || tgt == Mesh::null_vertex())
+    return;
+  Halfedge_index local_h = local.halfedge(src, tgt);
+  if (local_h == Mesh::null_halfedge() || !local.is_border(local_h))
+    return;
+
+  std::vector<Face_index>   patch_facets;
+  std::vector<Vertex_index> patch_vertices;
+  fill_hole(local, local_h, std::back_inserter(patch_facets), std::back_inserter(patch_vertices),
+            tier);
+
+  // The new vertices come after the copied ones, as nothing was removed
+  const std::size_t num_copied = local_to_global.size();
+  for (std::size_t it = 0; it < patch_vertices.size(); it++) {
+    if (std::size_t(patch_vertices[it]) != num_copied + it)
+      return;
+    patch.new_points.push_back(convert_point<typename Mesh::Point>
+                               (local.point(patch_vertices[it])));
+  }
+
+  for (Face_index f : patch_facets) {
+    std::array<long long, 3> face;
+    int corner = 0;
+    for (Vertex_index v : CGAL::vertices_around_face(local.halfedge(f), local)) {
+      if (corner >= 3)
+        return;
+      if (std::size_t(v) < num_copied)
+        face[corner] = std::size_t(local_to_global[v]);
+      else
+        face[corner] = -1 - (long long)(std::size_t(v) - num_copied);
+      corner++;
+    }
+    if (corner != 3)
+      return;
+    patch.faces.push_back(face);
+  }
+
+  patch.computed = true;
+}
+
+// Add a computed patch to the mesh. Return false if a face could not
+// be added.
+template <class Mesh>
+bool commit_hole_patch(Mesh & mesh, Hole_patch<Mesh> const& patch) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+
+  std::vector<Vertex_index> new_vertices;
+  for (std::size_t it = 0; it < patch.new_points.size(); it++)
+    new_vertices.push_back(mesh.add_vertex(patch.new_points[it]));
+
+  bool success = true;
+  for (std::size_t it = 0; it < patch.faces.size(); it++) {
+    Vertex_index v[3];
+    for (int c = 0; c < 3; c++) {
+      long long id = patch.faces[it][c];
+      v[c] = (id >= 0) ? Vertex_index(id) : new_vertices[-1 - id];
+    }
+    if (mesh.add_face(v[0], v[1], v[2]) == Mesh::null_face())
+      success = false;
+  }
+
+  return success;
+}
+
+// Incrementally fill the holes that are no larger than given diameter
+// and with no more than a given number of edges (if specified). Return
+// the number of holes that were filled, or -1 if the region of interest
+// has no faces. If asked, report how far it got.
+template <class Mesh>
+int fill_holes_serial(Mesh & mesh, Fill_holes_params const& params,
+                      Fill_holes_report * report = NULL) {
+
+  typedef typename boost::graph_traits<Mesh>::vertex_descriptor   vertex_descriptor;
+  typedef typename boost::graph_traits<Mesh>::halfedge_descriptor halfedge_descriptor;
+  typedef typename boost::graph_traits<Mesh>::face_descriptor     face_descriptor;
+
+  double deadline = deadline_after(params.max_seconds);
+  std::vector<halfedge_descriptor> holes;
+  if (!find_holes(mesh, params, holes))
+    return -1;
+
+  int nb_holes = 0, nb_filled = 0;
+  bool out_of_time = false;
+  std::array<Hole_tier_stats, NUM_HOLE_TIERS> tiers;
+  for(halfedge_descriptor h : holes)
+  {
+    if (past_deadline(deadline)) {
+      out_of_time = true;
+      break;
+    }
+    Hole_tier tier = hole_tier(h, mesh, params);
+    double start = wall_time();
+    bool success = false, filled = false;
+    if (Is_float_mesh<Mesh>::value) {
+      // Fill a double precision copy of the neighbourhood
+      Hole_patch<Mesh> patch;
+      compute_hole_patch(mesh, h, tier, patch);
+      if (patch.computed) {
+        success = commit_hole_patch(mesh, patch);
+        filled = true;
+      }
+    }
+    if (!filled) {
+      std::vector<face_descriptor>  patch_facets;
+      std::vector<vertex_descriptor> patch_vertices;
+      success = fill_hole(mesh, h, std::back_inserter(patch_facets),
+                          std::back_inserter(patch_vertices), tier);
+    }
+    tiers[tier].num_holes++;
+    tiers[tier].num_filled += success;
+    tiers[tier].seconds    += wall_time() - start;
+    if (success)
+      ++nb_filled;
+    ++nb_holes;
+  }
+
+  if (report != NULL) {
+    report->num_found     = holes.size();
+    report->num_attempted = nb_holes;
+    report->num_filled    = nb_filled;
+    report->out_of_time   = out_of_time;
+    report->tiers         = tiers;
+  }
+  return nb_holes;
+}
+
+// Fill the same holes as fill_holes_serial(), computing the patches of
+// holes that share no vertex with another hole in parallel. Each patch
+// is computed from the mesh as it was before any hole got filled, and
+// patches are added in the order of the holes, so the result does not
+// depend on the number of threads. Holes touching other holes are
+// filled in place, in the same order. Return -1 in the same case.
+template <class Mesh>
+int fill_holes_parallel(Mesh & mesh, Fill_holes_params const& params,
+                        Fill_holes_report * report = NULL) {
+
+  typedef typename boost::graph_traits<Mesh>::vertex_descriptor   vertex_descriptor;
+  typedef typename boost::graph_traits<Mesh>::halfedge_descriptor halfedge_descriptor;
+  typedef typename boost::graph_traits<Mesh>::face_descriptor     face_descriptor;
+
+  double deadline = deadline_after(params.max_seconds);
+  std::vector<halfedge_descriptor> holes;
+  if (!find_holes(mesh, params, holes))
+    return -1;
+
+  // Count how many holes each vertex is on
+  std::vector<unsigned char> num_holes_at(mesh.num_vertices(), 0);
+  for (halfedge_descriptor h : holes) {
+    for (halfedge_descriptor hc : CGAL::halfedges_around_face(h, mesh)) {
+      unsigned char & count = num_holes_at[mesh.target(hc)];
+      if (count < 2) count++;
+    }
+  }
+  std::vector<bool> independent(holes.size(), true);
+  for (std::size_t it = 0; it < holes.size(); it++) {
+    for (halfedge_descriptor hc : CGAL::halfedges_around_face(holes[it], mesh)) {
+      if (num_holes_at[mesh.target(hc)] > 1)
+        independent[it] = false;
+    }
+  }
+
+  // Pick the tiers before the mesh changes
+  std::vector<Hole_tier> hole_tiers(holes.size());
+  for (std::size_t it = 0; it < holes.size(); it++)
+    hole_tiers[it] = hole_tier(holes[it], mesh, params);
+
+  std::vector<Hole_patch<Mesh> > patches(holes.size());
+  Mesh const& const_mesh = mesh;
+  parallel_for(0, holes.size(), params.num_threads, [&](std::size_t it) {
+      if (independent[it] && !past_deadline(deadline)) {
+        double start = wall_time();
+        compute_hole_patch(const_mesh, holes[it], hole_tiers[it], patches[it]);
+        patches[it].seconds = wall_time() - start;
+      }
+    });
+
+  int nb_holes = 0, nb_filled = 0;
+  bool out_of_time = false;
+  std::array<Hole_tier_stats, NUM_HOLE_TIERS> tiers;
+  for (std::size_t it = 0; it < holes.size(); it++) {
+    if (past_deadline(deadline)) {
+      out_of_time = true;
+      break;
+    }
+    Hole_tier_stats & tier = tiers[hole_tiers[it]];
+    double start = wall_time() - patches[it].seconds;
+    bool success = false;
+    if (patches[it].computed) {
+      success = commit_hole_patch(mesh, patches[it]);
+      if (!success)
+        std::cerr << "Could not add the patch for hole " << it << "." << std::endl;
+    } else {
+      // Holes that are not independent or whose neighbourhood could not
+      // be copied on its own
+      std::vector<face_descriptor>   patch_facets;
+      std::vector<vertex_descriptor> patch_vertices;
+      success = fill_hole(mesh, holes[it], std::back_inserter(patch_facets),
+                          std::back_inserter(patch_vertices), hole_tiers[it]);
+    }
+    patches[it] = Hole_patch<Mesh>(); // free the memory early
+    tier.num_holes++;
+    tier.num_filled += success;
+    tier.seconds    += wall_time() - start;
+    if (success)
+      ++nb_filled;
+    ++nb_holes;
+  }
+
+  if (report != NULL) {
+    report->num_found     = holes.size();
+    report->num_attempted = nb_holes;
+    report->num_filled    = nb_filled;
+    report->out_of_time   = out_of_time;
+    report->tiers         = tiers;
+  }
+  return nb_holes;
+}
+
+template <class Mesh>
+int fill_holes(Mesh & mesh, Fill_holes_params const& params,
+               Fill_holes_report * report = NULL) {
+  if (params.num_threads > 0)
+    return fill_holes_parallel<Mesh>(mesh, params, report);
+  return fill_holes_serial<Mesh>(mesh, params, report);
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_FILL_HOLES_H
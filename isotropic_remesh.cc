@@ -0,0 +1,184 @@
+#include <CGAL/boost/graph/helpers.h>
+
+#include "cgal_tools.h"
+#include "mesh_io.h"
+#include "mesh_types.h"
+#include "parallel_for.h"
+#include "result_cache.h"
+#include "tool_options.h"
+#include "tool_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Make the edges of a triangle mesh close to a target length, so its
+// triangles are close to equilateral
+
+typedef cgal_tools::Double_mesh Mesh;
+
+// Remesh copies of the mesh serially and by patches with 1, 2, 4, ...
+// threads, and compare timings and throughput in input faces per second
+template <class Mesh>
+void scaling_test(Mesh const& input, cgal_tools::Isotropic_remesh_params params,
+                  int max_threads) {
+
+  const double num_faces = input.number_of_faces();
+  Mesh serial = input;
+  double start = cgal_tools::wall_time();
+  std::size_t serial_faces = cgal_tools::isotropic_remesh_serial(serial, params);
+  double serial_time = cgal_tools::wall_time() - start;
+
+  printf("%8s %10s %8s %12s %10s %10s\n", "threads", "time (s)", "speedup", "faces/s",
+         "faces", "seam faces");
+  printf("%8s %10.3f %8.2f %12.0f %10zu %10d\n", "serial", serial_time, 1.0,
+         num_faces / std::max(serial_time, 1e-9), serial_faces, 0);
+
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    Mesh mesh = input;
+    params.num_threads = num_threads;
+    cgal_tools::Isotropic_remesh_report report;
+    start = cgal_tools::wall_time();
+    std::size_t faces = cgal_tools::isotropic_remesh_partitioned(mesh, params, &report);
+    double elapsed = cgal_tools::wall_time() - start;
+    printf("%8d %10.3f %8.2f %12.0f %10zu %10zu\n", num_threads, elapsed,
+           serial_time / std::max(elapsed, 1e-9), num_faces / std::max(elapsed, 1e-9),
+           faces, report.num_seam_faces);
+  }
+}
+
+// Read, remesh and write the mesh, stored with the points of Mesh
+template <class Mesh>
+int process_mesh(cgal_tools::Isotropic_remesh_params const& params, bool run_scaling_test,
+                 const char* input_file, const char* output_file, bool binary_output,
+                 int quantization_bits, cgal_tools::Tool_stats & stats) {
+
+  std::cout << "Reading mesh:       " << input_file << "\n";
+  stats.start_phase("read");
+  Mesh mesh;
+  if(!cgal_tools::read_mesh(input_file, mesh)) {
+    std::cerr << "Invalid input." << std::endl;
+    return 1;
+  }
+
+  if (!CGAL::is_triangle_mesh(mesh)){
+    std::cerr << "Input geometry is not triangulated." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::size_t input_faces = mesh.number_of_faces();
+  stats.set_count("input_faces", input_faces);
+  if (run_scaling_test) {
+    int max_threads = params.num_threads > 0 ? params.num_threads :
+      std::min(64, cgal_tools::resolve_num_threads(0));
+    stats.start_phase("scaling_test");
+    scaling_test(mesh, params, max_threads);
+  }
+
+  stats.start_phase("remesh");
+  cgal_tools::Isotropic_remesh_report report;
+  std::size_t faces = cgal_tools::isotropic_remesh(mesh, params, &report);
+  stats.end_phase();
+  double remesh_time = stats.last_phase().wall_seconds;
+  double throughput = input_faces / std::max(remesh_time, 1e-9);
+  stats.set_count("faces_per_second", throughput);
+  stats.set_count("parts", report.num_parts);
+  stats.set_count("seam_faces", report.num_seam_faces);
+
+  std::cout << "Faces: " << input_faces << " in, " << faces << " out.\n"
+            << "Time elapsed: " << remesh_time << " s, " << throughput
+            << " input faces per second.\n";
+  if (report.num_parts > 0)
+    std::cout << "Splitting long edges: " << report.split_seconds << " s, "
+              << report.num_parts << " patches: " << report.parts_seconds << " s, "
+              << report.num_seam_faces << " faces along the seams: " << report.seam_seconds
+              << " s.\n";
+
+  // Without this the mesh will be invalid
+  stats.start_phase("collect_garbage");
+  mesh.collect_garbage();
+  stats.end_phase();
+  stats.set_count("output_faces", mesh.number_of_faces());
+
+  std::cout << "Writing output mesh: " << output_file << std::endl;
+  stats.start_phase("write");
+  if (!cgal_tools::write_mesh(output_file, mesh, binary_output, quantization_bits)) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
+  }
+
+  stats.end_phase();
+  std::cout << "Peak memory: " << stats.max_phase_rss_mb() << " MB\n";
+
+  stats.emit();
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+
+  cgal_tools::Isotropic_remesh_params params;
+  cgal_tools::Tool_stats stats("isotropic_remesh");
+  cgal_tools::extract_stats_options(argc, argv, stats);
+  cgal_tools::Result_cache cache;
+  cgal_tools::extract_cache_options(argc, argv, cache);
+  bool binary_output = cgal_tools::extract_flag(argc, argv, "binary");
+  bool run_scaling_test = cgal_tools::extract_flag(argc, argv, "scaling_test");
+  bool float32 = cgal_tools::extract_flag(argc, argv, "float32");
+  cgal_tools::extract_option(argc, argv, "num_threads", params.num_threads);
+  cgal_tools::extract_option(argc, argv, "num_parts", params.num_parts);
+  int quantization_bits = 16;
+  cgal_tools::extract_option(argc, argv, "quantization_bits", quantization_bits);
+
+  if (argc < 5 || !cgal_tools::check_no_unknown_options(argc, argv)) {
+    std::cout << "Usage: " << argv[0]
+              << " [--binary] [--quantization_bits B] [--float32] [--num_threads N]"
+              << " [--num_parts P] [--scaling_test] "
+              << cgal_tools::stats_usage() << " " << cgal_tools::cache_usage()
+              << " target_edge_length num_iterations input.ply output.ply\n"
+              << "Split, collapse and flip edges and move vertices along the surface until\n"
+              << "the edges are close to the target length. Vertices on the border of the\n"
+              << "mesh stay on it. With --num_threads, the mesh is split into P patches\n"
+              << "(default 64), remeshed in parallel with their borders kept as they are,\n"
+              << "then the faces near the patch borders are remeshed. The result depends on\n"
+              << "P but not on the number of threads. With --scaling_test, the remeshing is\n"
+              << "first timed serially and with 1, 2, 4, ... threads up to N.\n"
+              << "Output files named .cmesh are written in a compressed format, with\n"
+              << "coordinates quantized to --quantization_bits (default 16, 0 for exact).\n";
+    return 1;
+  }
+
+  params.target_edge_length = atof(argv[1]);
+  params.num_iterations     = atoi(argv[2]);
+  const char* input_file    = argv[3];
+  const char* output_file   = argv[4];
+
+  if (params.target_edge_length <= 0 || params.num_iterations < 1) {
+    std::cerr << "The target edge length and the number of iterations must be positive."
+              << std::endl;
+    return 1;
+  }
+
+  std::cout << "Target edge length: " << params.target_edge_length << "\n"
+            << "Iterations:         " << params.num_iterations << "\n";
+
+  // The scaling test is run for its timings
+  if (run_scaling_test)
+    cache.set_directory("");
+  std::ostringstream cache_params;
+  cache_params.precision(17);
+  cache_params << params.target_edge_length << " " << params.num_iterations << " "
+               << (params.num_threads > 0) << " " << params.num_parts << " "
+               << binary_output << " " << quantization_bits << " " << float32;
+
+  return cgal_tools::run_with_cache(cache, "isotropic_remesh", cache_params.str(),
+                                    input_file, output_file, stats, [&]() {
+      if (float32)
+        return process_mesh<cgal_tools::Float_mesh>(params, run_scaling_test, input_file,
+                                                    output_file, binary_output,
+                                                    quantization_bits, stats);
+      return process_mesh<Mesh>(params, run_scaling_test, input_file, output_file,
+                                binary_output, quantization_bits, stats);
+    });
+}
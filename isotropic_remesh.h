@@ -0,0 +1,235 @@
+// Isotropic remeshing, shared by the isotropic_remesh tool and the
+// pipeline. Long edges are split, short ones collapsed, edges flipped
+// towards valence six and vertices moved along the surface, until the
+// edges are close to a target length. This evens out the badly shaped
+// triangles that make smoothing and simplification slow and unstable.
+
+#ifndef CGAL_TOOLS_ISOTROPIC_REMESH_H
+#define CGAL_TOOLS_ISOTROPIC_REMESH_H
+
+#include <CGAL/Polygon_mesh_processing/remesh.h>
+#include <CGAL/boost/graph/copy_face_graph.h>
+#include <CGAL/boost/graph/iterator.h>
+
+#include "mesh_types.h"
+#include "parallel_for.h"
+#include "submesh.h"
+#include "tool_params.h"
+#include "tool_stats.h"
+
+#include <algorithm>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+namespace cgal_tools {
+
+// The rings of faces around the patch borders that are remeshed again
+// once the patches are put back together
+const int REMESH_SEAM_RINGS = 3;
+
+// Remesh all faces on one thread. Return the number of faces. The mesh
+// has garbage afterwards.
+template <class Mesh>
+std::size_t isotropic_remesh_all(Mesh & mesh, Isotropic_remesh_params const& params) {
+  namespace PMP = CGAL::Polygon_mesh_processing;
+  PMP::isotropic_remeshing(mesh.faces(), params.target_edge_length, mesh,
+                           PMP::parameters::number_of_iterations(params.num_iterations));
+  return mesh.number_of_faces();
+}
+
+// Split the mesh into spatial patches and remesh them in parallel,
+// keeping the patch borders as they are. Then put the patches back
+// together and remesh the faces near the borders. Long edges are split
+// first, as a border edge much longer than the target would be left
+// long. Return the number of faces. The mesh has garbage afterwards.
+template <class Mesh>
+std::size_t isotropic_remesh_patches(Mesh & mesh, Isotropic_remesh_params const& params,
+                                     Isotropic_remesh_report & report) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Edge_index   Edge_index;
+  typedef typename Mesh::Face_index   Face_index;
+  namespace PMP = CGAL::Polygon_mesh_processing;
+
+  // The remeshing splits edges longer than this
+  double start = wall_time();
+  const double max_length = 4.0 / 3.0 * params.target_edge_length;
+  std::vector<Edge_index> long_edges;
+  for (Edge_index e : mesh.edges()) {
+    double length2 = CGAL::to_double(CGAL::squared_distance
+                                     (mesh.point(mesh.vertex(e, 0)), mesh.point(mesh.vertex(e, 1))));
+    if (length2 > max_length * max_length)
+      long_edges.push_back(e);
+  }
+  if (!long_edges.empty())
+    PMP::split_long_edges(long_edges, max_length, mesh);
+  std::vector<Edge_index>().swap(long_edges);
+  report.split_seconds = wall_time() - start;
+
+  start = wall_time();
+  const std::size_t num_vertices = mesh.num_vertices();
+  std::vector<std::vector<Face_index> > parts;
+  partition_faces(mesh, params.num_parts, parts);
+
+  std::vector<Mesh> submeshes(parts.size());
+  std::vector<std::vector<Vertex_index> > local_to_global(parts.size());
+  std::vector<std::vector<Vertex_index> > border_vertices(parts.size());
+  std::vector<unsigned char> extracted(parts.size(), 0);
+  Mesh const& const_mesh = mesh;
+  parallel_for(0, parts.size(), params.num_threads, [&](std::size_t it) {
+      Mesh & part = submeshes[it];
+      std::vector<Vertex_index> & l2g = local_to_global[it];
+      extracted[it] = extract_submesh(const_mesh, parts[it], part, l2g);
+      std::vector<Face_index>().swap(parts[it]);
+      if (!extracted[it])
+        return;
+
+      // Keep the border of the patch as it is, so it still matches the
+      // neighbouring patches
+      typename Mesh::template Property_map<Edge_index, bool> constrained =
+        part.template add_property_map<Edge_index, bool>("e:locked", false).first;
+      for (Edge_index e : part.edges())
+        constrained[e] = part.is_border(e);
+      for (Vertex_index v : part.vertices()) {
+        if (part.is_border(v))
+          border_vertices[it].push_back(l2g[v]);
+      }
+
+      // Follow the vertices of the original mesh through the remeshing,
+      // which adds and removes vertices. Those it adds are not in there.
+      typename Mesh::template Property_map<Vertex_index, Vertex_index> global =
+        part.template add_property_map<Vertex_index, Vertex_index>
+        ("v:global", Mesh::null_vertex()).first;
+      for (Vertex_index v : part.vertices())
+        global[v] = l2g[v];
+
+      PMP::isotropic_remeshing(part.faces(), params.target_edge_length, part,
+                               PMP::parameters::number_of_iterations(params.num_iterations)
+                               .edge_is_constrained_map(constrained)
+                               .protect_constraints(true));
+
+      l2g.assign(part.num_vertices(), Mesh::null_vertex());
+      for (Vertex_index v : part.vertices())
+        l2g[v] = global[v];
+      part.remove_property_map(constrained);
+      part.remove_property_map(global);
+    });
+
+  for (std::size_t it = 0; it < extracted.size(); it++) {
+    if (!extracted[it]) {
+      // Some patch is not a valid mesh on its own
+      std::vector<Mesh>().swap(submeshes);
+      report.parts_seconds = wall_time() - start;
+      return isotropic_remesh_all(mesh, params);
+    }
+  }
+
+  std::vector<Vertex_index> global_to_out;
+  if (!merge_submeshes(submeshes, local_to_global, num_vertices, mesh, &global_to_out))
+    std::cerr << "Some faces were lost when merging the remeshed patches." << std::endl;
+  std::vector<Mesh>().swap(submeshes);
+  report.num_parts = parts.size();
+  report.parts_seconds = wall_time() - start;
+
+  // Finish around the patch borders
+  start = wall_time();
+  std::vector<Vertex_index> seeds;
+  for (std::vector<Vertex_index> const& border : border_vertices) {
+    for (Vertex_index g : border) {
+      if (global_to_out[g] != Mesh::null_vertex())
+        seeds.push_back(global_to_out[g]);
+    }
+  }
+  std::sort(seeds.begin(), seeds.end());
+  seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+  std::vector<Face_index> seam_faces;
+  collect_face_rings(mesh, seeds, REMESH_SEAM_RINGS, seam_faces);
+  if (!seam_faces.empty())
+    PMP::isotropic_remeshing(seam_faces, params.target_edge_length, mesh,
+                             PMP::parameters::number_of_iterations(params.num_iterations));
+  report.num_seam_faces = seam_faces.size();
+  report.seam_seconds = wall_time() - start;
+
+  return mesh.number_of_faces();
+}
+
+template <class Mesh>
+std::size_t isotropic_remesh_in_precision(Mesh & mesh, Isotropic_remesh_params const& params,
+                                          Isotropic_remesh_report & report, bool patches,
+                                          std::false_type) {
+  if (patches)
+    return isotropic_remesh_patches(mesh, params, report);
+  return isotropic_remesh_all(mesh, params);
+}
+
+// The same, on a double precision copy of a mesh storing single
+// precision points, as projecting onto the input surface needs the
+// precision. The mesh is rebuilt from the copy, without garbage. Faces
+// that cannot be added back are reported and left out.
+template <class Mesh>
+std::size_t isotropic_remesh_in_precision(Mesh & mesh, Isotropic_remesh_params const& params,
+                                          Isotropic_remesh_report & report, bool patches,
+                                          std::true_type) {
+  typedef typename Mesh::Vertex_index         Vertex_index;
+  typedef typename Mesh::Face_index           Face_index;
+  typedef typename Promoted_mesh<Mesh>::type  Local_mesh;
+
+  Local_mesh copy;
+  CGAL::copy_face_graph(mesh, copy);
+  isotropic_remesh_in_precision(copy, params, report, patches, std::false_type());
+
+  mesh.clear();
+  mesh.reserve(copy.number_of_vertices(), copy.number_of_edges(), copy.number_of_faces());
+  std::vector<Vertex_index> to_mesh(copy.num_vertices(), Mesh::null_vertex());
+  for (Vertex_index v : copy.vertices())
+    to_mesh[v] = mesh.add_vertex(convert_point<typename Mesh::Point>(copy.point(v)));
+  std::vector<Vertex_index> face_vertices;
+  std::size_t num_lost = 0;
+  for (Face_index f : copy.faces()) {
+    face_vertices.clear();
+    for (Vertex_index v : CGAL::vertices_around_face(copy.halfedge(f), copy))
+      face_vertices.push_back(to_mesh[v]);
+    if (mesh.add_face(face_vertices) == Mesh::null_face())
+      num_lost++;
+  }
+  if (num_lost > 0)
+    std::cerr << num_lost << " faces were lost when copying the remeshed mesh back to single"
+              << " precision." << std::endl;
+  return mesh.number_of_faces();
+}
+
+// Remesh the whole mesh on one thread. Return the number of faces.
+template <class Mesh>
+std::size_t isotropic_remesh_serial(Mesh & mesh, Isotropic_remesh_params const& params,
+                                    Isotropic_remesh_report * report = NULL) {
+  Isotropic_remesh_report local_report;
+  return isotropic_remesh_in_precision
+    (mesh, params, report != NULL ? *report : local_report, false,
+     std::integral_constant<bool, Is_float_mesh<Mesh>::value>());
+}
+
+// Remesh patches of the mesh on the given number of threads, then the
+// seams between them. Return the number of faces.
+template <class Mesh>
+std::size_t isotropic_remesh_partitioned(Mesh & mesh, Isotropic_remesh_params const& params,
+                                         Isotropic_remesh_report * report = NULL) {
+  Isotropic_remesh_report local_report;
+  return isotropic_remesh_in_precision
+    (mesh, params, report != NULL ? *report : local_report, true,
+     std::integral_constant<bool, Is_float_mesh<Mesh>::value>());
+}
+
+// Make the edges of the triangle mesh close to the target length.
+// Return the number of faces. The mesh may have garbage afterwards.
+template <class Mesh>
+std::size_t isotropic_remesh(Mesh & mesh, Isotropic_remesh_params const& params,
+                             Isotropic_remesh_report * report = NULL) {
+  if (params.num_threads > 0)
+    return isotropic_remesh_partitioned<Mesh>(mesh, params, report);
+  return isotropic_remesh_serial<Mesh>(mesh, params, report);
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_ISOTROPIC_REMESH_H
@@ -0,0 +1,165 @@
+// The distance of meshes to a reference mesh, such as the input of a
+// simplification, measured on samples of both on several threads. The
+// AABB tree of the reference is built once, so measuring many results
+// against the same input, as when searching for the smallest mesh
+// within a bound, only pays for the samples of each result and the
+// tree of its triangles, which are few.
+
+#ifndef CGAL_TOOLS_MESH_DEVIATION_H
+#define CGAL_TOOLS_MESH_DEVIATION_H
+
+#include <CGAL/AABB_traits.h>
+#include <CGAL/AABB_tree.h>
+#include <CGAL/AABB_triangle_primitive.h>
+
+#include "mesh_types.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace cgal_tools {
+
+// The samples on a face are spaced no more than the mean edge length of
+// the reference, and at most this many to an edge
+const int DEVIATION_MAX_FACE_SUBDIVISIONS = 32;
+
+// The items a thread takes at a time
+const std::size_t DEVIATION_BLOCK_SIZE = 1024;
+
+class Deviation_meter {
+public:
+  typedef Double_kernel::Point_3                                        Point;
+  typedef Double_kernel::Triangle_3                                     Triangle;
+  typedef std::vector<Triangle>::const_iterator                         Iterator;
+  typedef CGAL::AABB_triangle_primitive<Double_kernel, Iterator>        Primitive;
+  typedef CGAL::AABB_tree<CGAL::AABB_traits<Double_kernel, Primitive> > Tree;
+
+  // Measure against the given triangle mesh, with queries on the given
+  // number of threads, zero meaning all cores
+  template <class Mesh>
+  Deviation_meter(Mesh const& reference, int num_threads): m_spacing(0),
+                                                           m_num_threads(num_threads) {
+    get_triangles(reference, m_triangles);
+    build_tree(m_triangles, m_tree);
+    for (typename Mesh::Vertex_index v : reference.vertices())
+      m_points.push_back(convert_point<Point>(reference.point(v)));
+
+    double total = 0;
+    std::size_t num_edges = 0;
+    for (typename Mesh::Edge_index e : reference.edges()) {
+      total += std::sqrt(CGAL::to_double(CGAL::squared_distance
+                                         (reference.point(reference.vertex(e, 0)),
+                                          reference.point(reference.vertex(e, 1)))));
+      num_edges++;
+    }
+    m_spacing = total / std::max<std::size_t>(num_edges, 1);
+  }
+
+  // The largest distance from samples of the mesh to the reference
+  template <class Mesh>
+  double distance_to_reference(Mesh const& mesh) const {
+    if (m_triangles.empty())
+      return 0;
+    std::vector<Triangle> triangles;
+    get_triangles(mesh, triangles);
+    std::vector<double> block_max(num_blocks(triangles.size()), 0.0);
+    parallel_for(0, block_max.size(), m_num_threads, [&](std::size_t block) {
+        double & result = block_max[block];
+        std::size_t end = std::min(triangles.size(), (block + 1) * DEVIATION_BLOCK_SIZE);
+        for (std::size_t it = block * DEVIATION_BLOCK_SIZE; it < end; it++) {
+          Triangle const& t = triangles[it];
+          double longest = 0;
+          for (int k = 0; k < 3; k++)
+            longest = std::max(longest, CGAL::squared_distance(t[k], t[(k + 1) % 3]));
+          int n = 1;
+          if (m_spacing > 0)
+            n = std::max(1, std::min(DEVIATION_MAX_FACE_SUBDIVISIONS,
+                                     int(std::ceil(std::sqrt(longest) / m_spacing))));
+          for (int i = 0; i <= n; i++) {
+            for (int j = 0; i + j <= n; j++) {
+              double a = double(i) / n, b = double(j) / n;
+              Point p(t[0].x() + a * (t[1].x() - t[0].x()) + b * (t[2].x() - t[0].x()),
+                      t[0].y() + a * (t[1].y() - t[0].y()) + b * (t[2].y() - t[0].y()),
+                      t[0].z() + a * (t[1].z() - t[0].z()) + b * (t[2].z() - t[0].z()));
+              result = std::max(result, m_tree.squared_distance(p));
+            }
+          }
+        }
+      });
+    return std::sqrt(max_of(block_max));
+  }
+
+  // The largest distance from the vertices of the reference to the
+  // mesh, which are as dense a sample as the reference has
+  template <class Mesh>
+  double distance_from_reference(Mesh const& mesh) const {
+    std::vector<Triangle> triangles;
+    get_triangles(mesh, triangles);
+    if (triangles.empty())
+      return 0;
+    Tree tree;
+    build_tree(triangles, tree);
+    std::vector<double> block_max(num_blocks(m_points.size()), 0.0);
+    parallel_for(0, block_max.size(), m_num_threads, [&](std::size_t block) {
+        std::size_t end = std::min(m_points.size(), (block + 1) * DEVIATION_BLOCK_SIZE);
+        for (std::size_t it = block * DEVIATION_BLOCK_SIZE; it < end; it++)
+          block_max[block] = std::max(block_max[block], tree.squared_distance(m_points[it]));
+      });
+    return std::sqrt(max_of(block_max));
+  }
+
+  // The Hausdorff distance between the mesh and the reference, as far
+  // as the samples tell, which is never more than the true one
+  template <class Mesh>
+  double distance(Mesh const& mesh) const {
+    return std::max(distance_to_reference(mesh), distance_from_reference(mesh));
+  }
+
+private:
+  Deviation_meter(Deviation_meter const&);
+  Deviation_meter & operator=(Deviation_meter const&);
+
+  // The triangles of the faces, which must all be triangles
+  template <class Mesh>
+  static void get_triangles(Mesh const& mesh, std::vector<Triangle> & triangles) {
+    triangles.clear();
+    triangles.reserve(mesh.number_of_faces());
+    for (typename Mesh::Face_index f : mesh.faces()) {
+      typename Mesh::Halfedge_index h = mesh.halfedge(f);
+      triangles.push_back(Triangle(convert_point<Point>(mesh.point(mesh.source(h))),
+                                   convert_point<Point>(mesh.point(mesh.target(h))),
+                                   convert_point<Point>(mesh.point(mesh.target
+                                                                   (mesh.next(h))))));
+    }
+  }
+
+  // Build the tree and the structure for distance queries now, rather
+  // than lazily on the first query, which may come from any thread
+  static void build_tree(std::vector<Triangle> const& triangles, Tree & tree) {
+    tree.rebuild(triangles.begin(), triangles.end());
+    if (triangles.empty())
+      return;
+    tree.accelerate_distance_queries();
+    tree.squared_distance(triangles[0][0]);
+  }
+
+  static std::size_t num_blocks(std::size_t size) {
+    return (size + DEVIATION_BLOCK_SIZE - 1) / DEVIATION_BLOCK_SIZE;
+  }
+
+  static double max_of(std::vector<double> const& values) {
+    return values.empty() ? 0.0 : *std::max_element(values.begin(), values.end());
+  }
+
+  std::vector<Triangle> m_triangles;
+  Tree                  m_tree;
+  std::vector<Point>    m_points;
+  double                m_spacing;
+  int                   m_num_threads;
+};
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_MESH_DEVIATION_H
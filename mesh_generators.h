@@ -0,0 +1,212 @@
+// Synthetic meshes for benchmarking the tools. Each generator is
+// deterministic given its seed, on any platform, so timings of
+// different builds are measured on identical input.
+
+#ifndef CGAL_TOOLS_MESH_GENERATORS_H
+#define CGAL_TOOLS_MESH_GENERATORS_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace cgal_tools {
+
+// A small generator with a fixed algorithm. The standard random
+// distributions differ between library implementations, so they are
+// not used.
+class Bench_random {
+public:
+  explicit Bench_random(std::uint64_t seed): state_(seed * 2654435761u + 1) {}
+
+  // Uniform in [0, 1)
+  double uniform() {
+    // splitmix64
+    std::uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z = z ^ (z >> 31);
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  // Uniform in [-1, 1)
+  double symmetric() { return 2.0 * uniform() - 1.0; }
+
+private:
+  std::uint64_t state_;
+};
+
+// A triangle soup, with vertices given as x, y, z triples
+struct Soup {
+  std::vector<std::array<double, 3>>      points;
+  std::vector<std::array<std::size_t, 3>> triangles;
+};
+
+// A latitude-longitude sphere with about the given number of faces,
+// with each vertex moved along the radius by up to noise * radius.
+inline void make_noisy_sphere(std::size_t num_faces, double radius, double noise,
+                              std::uint64_t seed, Soup & soup,
+                              double cx = 0, double cy = 0, double cz = 0) {
+  // With r rings and 2r segments there are 4r(r - 1) faces
+  std::size_t rings = std::max<std::size_t>(3, std::size_t(std::sqrt(num_faces / 4.0)) + 1);
+  std::size_t segments = 2 * rings;
+  Bench_random rng(seed);
+
+  const double pi = 3.14159265358979323846;
+  std::size_t base = soup.points.size();
+  auto add_point = [&](double theta, double phi) {
+    double r = radius * (1.0 + noise * rng.symmetric());
+    soup.points.push_back({{cx + r * std::sin(theta) * std::cos(phi),
+                            cy + r * std::sin(theta) * std::sin(phi),
+                            cz + r * std::cos(theta)}});
+  };
+
+  add_point(0, 0);                                 // north pole
+  for (std::size_t i = 1; i < rings; i++)
+    for (std::size_t j = 0; j < segments; j++)
+      add_point(pi * i / rings, 2 * pi * j / segments);
+  add_point(pi, 0);                                // south pole
+
+  std::size_t south = soup.points.size() - 1;
+  auto ring_vertex = [&](std::size_t i, std::size_t j) {
+    return base + 1 + (i - 1) * segments + (j % segments);
+  };
+  for (std::size_t j = 0; j < segments; j++) {
+    soup.triangles.push_back({{base, ring_vertex(1, j), ring_vertex(1, j + 1)}});
+    soup.triangles.push_back({{south, ring_vertex(rings - 1, j + 1), ring_vertex(rings - 1, j)}});
+  }
+  for (std::size_t i = 1; i + 1 < rings; i++) {
+    for (std::size_t j = 0; j < segments; j++) {
+      std::size_t a = ring_vertex(i, j), b = ring_vertex(i, j + 1);
+      std::size_t c = ring_vertex(i + 1, j), d = ring_vertex(i + 1, j + 1);
+      soup.triangles.push_back({{a, c, d}});
+      soup.triangles.push_back({{a, d, b}});
+    }
+  }
+}
+
+// A torus with about the given number of faces, with each vertex
+// moved randomly by up to noise * minor_radius in each coordinate.
+inline void make_noisy_torus(std::size_t num_faces, double major_radius, double minor_radius,
+                             double noise, std::uint64_t seed, Soup & soup) {
+  // With u segments around the axis and v = u / 2 around the tube
+  // there are u * u faces
+  std::size_t u = std::max<std::size_t>(6, std::size_t(std::sqrt(double(num_faces))));
+  std::size_t v = std::max<std::size_t>(3, u / 2);
+  Bench_random rng(seed);
+
+  const double pi = 3.14159265358979323846;
+  std::size_t base = soup.points.size();
+  for (std::size_t i = 0; i < u; i++) {
+    double a = 2 * pi * i / u;
+    for (std::size_t j = 0; j < v; j++) {
+      double b = 2 * pi * j / v;
+      double r = major_radius + minor_radius * std::cos(b);
+      double e = noise * minor_radius;
+      soup.points.push_back({{r * std::cos(a) + e * rng.symmetric(),
+                              r * std::sin(a) + e * rng.symmetric(),
+                              minor_radius * std::sin(b) + e * rng.symmetric()}});
+    }
+  }
+
+  for (std::size_t i = 0; i < u; i++) {
+    for (std::size_t j = 0; j < v; j++) {
+      std::size_t a = base + i * v + j,             b = base + i * v + (j + 1) % v;
+      std::size_t c = base + ((i + 1) % u) * v + j, d = base + ((i + 1) % u) * v + (j + 1) % v;
+      soup.triangles.push_back({{a, c, d}});
+      soup.triangles.push_back({{a, d, b}});
+    }
+  }
+}
+
+// A noisy unit sphere from which num_holes round patches of about
+// hole_faces faces each are removed. The hole centers are spread
+// evenly over the sphere, away from the poles.
+inline void make_sphere_with_holes(std::size_t num_faces, std::size_t num_holes,
+                                   std::size_t hole_faces, double noise, std::uint64_t seed,
+                                   Soup & soup) {
+  Soup sphere;
+  make_noisy_sphere(num_faces, 1.0, noise, seed, sphere);
+
+  // A cap with this angular radius covers the wanted share of the area
+  double share = double(hole_faces) / double(sphere.triangles.size());
+  double cos_radius = 1.0 - 2.0 * share;
+
+  const double golden_angle = 2.39996322972865332;
+  std::vector<std::array<double, 3>> centers;
+  for (std::size_t it = 0; it < num_holes; it++) {
+    double z = 0.8 * (1.0 - 2.0 * (it + 0.5) / num_holes);
+    double r = std::sqrt(1.0 - z * z);
+    centers.push_back({{r * std::cos(golden_angle * it), r * std::sin(golden_angle * it), z}});
+  }
+
+  soup.points = sphere.points;
+  for (auto const& tri : sphere.triangles) {
+    double c[3] = {0, 0, 0};
+    for (int k = 0; k < 3; k++)
+      for (int d = 0; d < 3; d++)
+        c[d] += sphere.points[tri[k]][d];
+    double norm = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+    bool in_hole = false;
+    for (auto const& p : centers) {
+      if ((c[0] * p[0] + c[1] * p[1] + c[2] * p[2]) / norm > cos_radius) {
+        in_hole = true;
+        break;
+      }
+    }
+    if (!in_hole)
+      soup.triangles.push_back(tri);
+  }
+}
+
+// A noisy torus surrounded by num_components small spheres of about
+// component_faces faces each, placed at random in a box around it.
+inline void make_floating_components(std::size_t num_faces, std::size_t num_components,
+                                     std::size_t component_faces, std::uint64_t seed,
+                                     Soup & soup) {
+  make_noisy_torus(num_faces, 1.0, 0.3, 0.01, seed, soup);
+
+  Bench_random rng(seed + 1);
+  for (std::size_t it = 0; it < num_components; it++) {
+    double x = 2.0 * rng.symmetric(), y = 2.0 * rng.symmetric(), z = 2.0 * rng.symmetric();
+    make_noisy_sphere(component_faces, 0.01, 0.05, seed + 2 + it, soup, x, y, z);
+  }
+}
+
+// Turn the soup into a mesh. Triangles that cannot be added without
+// breaking the mesh are skipped, as are vertices no triangle uses.
+// Return the number of skipped triangles.
+template <class Mesh>
+std::size_t soup_to_mesh(Soup const& soup, Mesh & mesh) {
+
+  typedef typename Mesh::Point        Point;
+  typedef typename Mesh::Vertex_index Vertex_index;
+
+  std::vector<bool> used(soup.points.size(), false);
+  for (auto const& tri : soup.triangles)
+    for (int k = 0; k < 3; k++)
+      used[tri[k]] = true;
+
+  mesh.clear();
+  mesh.reserve(soup.points.size(), 3 * soup.triangles.size() / 2, soup.triangles.size());
+  std::vector<Vertex_index> index(soup.points.size());
+  for (std::size_t it = 0; it < soup.points.size(); it++) {
+    if (used[it]) {
+      auto const& p = soup.points[it];
+      index[it] = mesh.add_vertex(Point(p[0], p[1], p[2]));
+    }
+  }
+
+  std::size_t num_skipped = 0;
+  for (auto const& tri : soup.triangles) {
+    if (mesh.add_face(index[tri[0]], index[tri[1]], index[tri[2]]) == Mesh::null_face())
+      num_skipped++;
+  }
+
+  return num_skipped;
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_MESH_GENERATORS_H
@@ -0,0 +1,263 @@
+// Reading and writing of Surface_mesh objects shared by all tools.
+// Binary little-endian PLY files are memory-mapped and the mesh is
+// filled directly, pre-sized from the header counts. ASCII PLY files
+// are memory-mapped too and parsed on several threads. Anything else,
+// including PLY files with colours, normals or other properties, goes
+// through the CGAL reader, which keeps them. Binary output is written
+// in large blocks, while ASCII output is written by CGAL at full
+// precision.
+// Files named .cmesh are written and read in the compressed format of
+// compressed_mesh.h.
+
+#ifndef CGAL_TOOLS_MESH_IO_H
+#define CGAL_TOOLS_MESH_IO_H
+
+#include "compressed_mesh.h"
+#include "ply_ascii.h"
+#include "ply_io.h"
+
+#include <CGAL/Kernel_traits.h>
+#include <CGAL/Surface_mesh.h>
+#include <CGAL/Polygon_mesh_processing/IO/polygon_mesh_io.h>
+#include <CGAL/IO/PLY.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace cgal_tools {
+
+// Fill the mesh from a memory-mapped binary PLY file. Return false if
+// the file is not of that kind, has properties other than the points
+// and faces, or the faces do not form a valid surface mesh, in which
+// case the caller should use the CGAL reader, which keeps the other
+// properties and repairs the polygon soup.
+template <class Mesh>
+bool read_binary_ply_mesh(Mapped_file const& mapped, Ply_header const& header, Mesh & mesh) {
+
+  typedef typename Mesh::Point        Point;
+  typedef typename Mesh::Vertex_index Vertex_index;
+
+  if (header.format != Ply_header::BINARY_LITTLE_ENDIAN || !host_is_little_endian() ||
+      !ply_has_only_geometry(header))
+    return false;
+
+  int vertex_id = header.element_index("vertex");
+  int face_id   = header.element_index("face");
+  if (vertex_id < 0 || face_id < 0)
+    return false;
+
+  std::size_t num_vertices = header.elements[vertex_id].count;
+  std::size_t num_faces    = header.elements[face_id].count;
+  mesh.clear();
+  mesh.reserve(num_vertices, num_vertices + num_faces, num_faces);
+
+  std::vector<Vertex_index> face_vertices;
+  bool success = walk_binary_ply
+    (mapped.data(), mapped.size(), header,
+     [&](double x, double y, double z) {
+       mesh.add_vertex(Point(x, y, z));
+       return true;
+     },
+     [&](const std::uint32_t* indices, std::size_t n) {
+       face_vertices.resize(n);
+       for (std::size_t it = 0; it < n; it++) {
+         if (indices[it] >= mesh.number_of_vertices()) return false;
+         face_vertices[it] = Vertex_index(indices[it]);
+       }
+       return mesh.add_face(face_vertices) != Mesh::null_face();
+     });
+
+  return success && mesh.number_of_vertices() == num_vertices &&
+    mesh.number_of_faces() == num_faces;
+}
+
+// Fill the mesh from the soup, releasing the coordinates of the soup
+// on the way. Return false if the polygons do not form a valid surface
+// mesh.
+template <class Mesh>
+bool flat_soup_to_mesh(Flat_soup & soup, Mesh & mesh) {
+
+  typedef typename Mesh::Point        Point;
+  typedef typename Mesh::Vertex_index Vertex_index;
+
+  mesh.clear();
+  mesh.reserve(soup.num_points(), soup.num_points() + soup.num_polygons(),
+               soup.num_polygons());
+  for (std::size_t it = 0; it < soup.num_points(); it++)
+    mesh.add_vertex(Point(soup.coords[3 * it], soup.coords[3 * it + 1],
+                          soup.coords[3 * it + 2]));
+  std::vector<double>().swap(soup.coords);
+
+  std::vector<Vertex_index> face_vertices;
+  for (std::size_t p = 0; p < soup.num_polygons(); p++) {
+    face_vertices.clear();
+    for (std::size_t it = soup.offsets[p]; it < soup.offsets[p + 1]; it++)
+      face_vertices.push_back(Vertex_index(soup.indices[it]));
+    if (mesh.add_face(face_vertices) == Mesh::null_face())
+      return false;
+  }
+  return true;
+}
+
+// Fill the mesh from a memory-mapped ASCII PLY file, parsed in
+// parallel. Return false as read_binary_ply_mesh() does.
+template <class Mesh>
+bool read_ascii_ply_mesh(Mapped_file const& mapped, Ply_header const& header, Mesh & mesh) {
+  if (!ply_has_only_geometry(header))
+    return false;
+  Flat_soup soup;
+  return read_ascii_ply_soup(mapped.data(), mapped.size(), header, 0, soup) &&
+    flat_soup_to_mesh(soup, mesh);
+}
+
+// Fill the mesh from a memory-mapped compressed mesh file, decoded in
+// parallel
+template <class Mesh>
+bool read_compressed_mesh(Mapped_file const& mapped, Mesh & mesh) {
+  Flat_soup soup;
+  return decode_compressed_mesh(mapped.data(), mapped.size(), 0, soup) &&
+    flat_soup_to_mesh(soup, mesh);
+}
+
+template <class Mesh>
+bool read_mesh(std::string const& input_file, Mesh & mesh) {
+  {
+    Mapped_file mapped;
+    Ply_header header;
+    bool opened = mapped.open(input_file);
+    if (opened && is_compressed_mesh(mapped.data(), mapped.size()))
+      return read_compressed_mesh(mapped, mesh);
+    if (opened && parse_ply_header(mapped.data(), mapped.size(), header) &&
+        (read_binary_ply_mesh(mapped, header, mesh) ||
+         read_ascii_ply_mesh(mapped, header, mesh)))
+      return true;
+  }
+
+  mesh.clear();
+  return CGAL::Polygon_mesh_processing::IO::read_polygon_mesh(input_file, mesh);
+}
+
+// Write the mesh as binary little-endian PLY. The mesh may have
+// garbage, that is skipped.
+template <class Mesh>
+bool write_binary_ply_mesh(std::string const& output_file, Mesh const& mesh) {
+
+  typedef typename Mesh::Point                               Point;
+  typedef typename CGAL::Kernel_traits<Point>::Kernel::FT    FT;
+  typedef typename Mesh::Vertex_index                        Vertex_index;
+  typedef typename Mesh::Face_index                          Face_index;
+
+  if (!host_is_little_endian())
+    return false;
+
+  Ply_binary_writer writer(output_file);
+  if (!writer.is_open())
+    return false;
+
+  // Coordinates are written with the precision they are stored with
+  const bool use_float = (sizeof(FT) == sizeof(float));
+  writer.write_header(mesh.number_of_vertices(), mesh.number_of_faces(),
+                      use_float ? "float" : "double");
+
+  // Vertex indices in the output skip removed vertices
+  std::vector<std::int32_t> out_index;
+  if (mesh.has_garbage())
+    out_index.resize(mesh.num_vertices(), -1);
+
+  std::int32_t count = 0;
+  for (Vertex_index v : mesh.vertices()) {
+    Point const& p = mesh.point(v);
+    for (int c = 0; c < 3; c++) {
+      if (use_float) writer.put<float>(CGAL::to_double(p[c]));
+      else           writer.put<double>(CGAL::to_double(p[c]));
+    }
+    if (!out_index.empty())
+      out_index[v] = count;
+    count++;
+  }
+
+  for (Face_index f : mesh.faces()) {
+    std::size_t degree = mesh.degree(f);
+    if (degree > 255) {
+      std::cerr << "Cannot write faces with more than 255 vertices." << std::endl;
+      return false;
+    }
+    writer.put<std::uint8_t>(degree);
+    for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh))
+      writer.put<std::int32_t>(out_index.empty() ? std::int32_t(v) : out_index[v]);
+  }
+
+  return writer.close();
+}
+
+// Copy the points and faces of the mesh, which may have garbage, to
+// the soup
+template <class Mesh>
+void mesh_to_flat_soup(Mesh const& mesh, Flat_soup & soup) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+
+  soup = Flat_soup();
+  soup.coords.reserve(3 * mesh.number_of_vertices());
+  soup.offsets.reserve(mesh.number_of_faces() + 1);
+  soup.indices.reserve(3 * mesh.number_of_faces());
+  std::vector<std::uint32_t> out_index(mesh.num_vertices(), 0);
+  for (Vertex_index v : mesh.vertices()) {
+    out_index[v] = soup.num_points();
+    for (int c = 0; c < 3; c++)
+      soup.coords.push_back(CGAL::to_double(mesh.point(v)[c]));
+  }
+  for (Face_index f : mesh.faces()) {
+    for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh))
+      soup.indices.push_back(out_index[v]);
+    soup.offsets.push_back(soup.indices.size());
+  }
+}
+
+// Write the mesh in the compressed format, with coordinates quantized
+// to the given number of bits, or exact for 0
+template <class Mesh>
+bool write_compressed_mesh(std::string const& output_file, Mesh const& mesh,
+                           int quantization_bits) {
+  Flat_soup soup;
+  mesh_to_flat_soup(mesh, soup);
+  return write_compressed_mesh_file(output_file, soup, quantization_bits, 0);
+}
+
+// Whether the mesh has vertex or face properties besides its points and
+// connectivity, such as the colours or normals the CGAL reader keeps
+template <class Mesh>
+bool has_extra_properties(Mesh const& mesh) {
+  for (std::string const& name : mesh.template properties<typename Mesh::Vertex_index>()) {
+    if (name != "v:connectivity" && name != "v:point" && name != "v:removed")
+      return true;
+  }
+  for (std::string const& name : mesh.template properties<typename Mesh::Face_index>()) {
+    if (name != "f:connectivity" && name != "f:removed")
+      return true;
+  }
+  return false;
+}
+
+// Write the mesh in the format its name asks for: compressed for
+// .cmesh, with the given quantization, and else PLY. The fast binary
+// writer only writes points and faces, so meshes with other properties
+// go through the CGAL writer. The compressed format has no room for
+// them.
+template <class Mesh>
+bool write_mesh(std::string const& output_file, Mesh const& mesh, bool binary,
+                int quantization_bits = 16) {
+  if (has_compressed_mesh_extension(output_file))
+    return write_compressed_mesh(output_file, mesh, quantization_bits);
+  if (binary && !has_extra_properties(mesh) && write_binary_ply_mesh(output_file, mesh))
+    return true;
+
+  return CGAL::IO::write_PLY(output_file, mesh,
+                             CGAL::parameters::stream_precision(17).use_binary_mode(binary));
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_MESH_IO_H
@@ -0,0 +1,517 @@
+// Run several of the tools in this repository one after another on
+// the same mesh, without writing and reading it back in between, or
+// on each of the meshes listed in a manifest, several at a time.
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Surface_mesh.h>
+
+#include "fill_holes.h"
+#include "isotropic_remesh.h"
+#include "parallel_for.h"
+#include "rm_connected_components.h"
+#include "simplify_mesh.h"
+#include "smoothe_mesh.h"
+#include "mesh_io.h"
+#include "mesh_reorder.h"
+#include "mesh_types.h"
+#include "result_cache.h"
+#include "tool_options.h"
+#include "tool_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel;
+typedef Kernel::Point_3                                     Point;
+typedef CGAL::Surface_mesh<Point>                           Mesh;
+
+// A stage is named after the tool doing the same work, and takes the
+// same parameters as that tool, in the same order.
+struct Stage {
+  std::string name;
+  cgal_tools::Rm_connected_components_params rm_cc;
+  cgal_tools::Fill_holes_params              fill;
+  cgal_tools::Smoothe_params                 smoothe;
+  cgal_tools::Simplify_params                simplify;
+  cgal_tools::Isotropic_remesh_params        remesh;
+};
+
+// Parse the stages starting at argv[pos]. Return false on failure.
+bool parse_stages(int argc, char** argv, int pos, std::vector<Stage> & stages) {
+  while (pos < argc) {
+    Stage stage;
+    stage.name = argv[pos];
+    int num_params = 0;
+    if      (stage.name == "rm_connected_components") num_params = 2;
+    else if (stage.name == "fill_holes")              num_params = 2;
+    else if (stage.name == "smoothe_mesh")            num_params = 3;
+    else if (stage.name == "simplify_mesh")           num_params = 1;
+    else if (stage.name == "isotropic_remesh")        num_params = 2;
+    else {
+      std::cerr << "Unknown stage: " << stage.name << std::endl;
+      return false;
+    }
+    if (pos + num_params >= argc) {
+      std::cerr << "Stage " << stage.name << " needs " << num_params
+                << " parameters." << std::endl;
+      return false;
+    }
+
+    char** p = argv + pos + 1;
+    if (stage.name == "rm_connected_components") {
+      stage.rm_cc.num_min_faces_in_component = atoi(p[0]);
+      stage.rm_cc.num_components_to_keep     = atoi(p[1]);
+    } else if (stage.name == "fill_holes") {
+      stage.fill.max_hole_diam      = atof(p[0]);
+      stage.fill.max_num_hole_edges = atoi(p[1]);
+    } else if (stage.name == "smoothe_mesh") {
+      stage.smoothe.num_iterations   = atoi(p[0]);
+      stage.smoothe.smoothing_time   = atof(p[1]);
+      stage.smoothe.smoothe_boundary = atoi(p[2]);
+    } else if (stage.name == "simplify_mesh") {
+      stage.simplify.edge_keep_ratio = atof(p[0]);
+    } else if (stage.name == "isotropic_remesh") {
+      stage.remesh.target_edge_length = atof(p[0]);
+      stage.remesh.num_iterations     = atoi(p[1]);
+      if (stage.remesh.target_edge_length <= 0 || stage.remesh.num_iterations < 1) {
+        std::cerr << "The target edge length and the number of iterations must be positive."
+                  << std::endl;
+        return false;
+      }
+    }
+
+    stages.push_back(stage);
+    pos += num_params + 1;
+  }
+
+  return !stages.empty();
+}
+
+// Print the time and memory of the phase that just ended
+template <class Mesh>
+void print_phase(cgal_tools::Tool_stats const& stats, Mesh const& mesh) {
+  cgal_tools::Phase_stats const& phase = stats.last_phase();
+  printf("%-24s %9.3f s %9.1f MB %12zu faces\n", phase.name.c_str(),
+         phase.wall_seconds, phase.peak_rss_mb, std::size_t(mesh.number_of_faces()));
+}
+
+struct Pipeline_options {
+  bool binary_output;
+  int  quantization_bits; // of .cmesh output
+  int  num_threads;  // for the stages of each mesh
+  bool verbose;      // print each phase
+  bool float32;      // store points in single precision
+  bool reorder;      // renumber along a space-filling curve for locality
+  bool keep_reorder; // and keep that order in the output
+  Pipeline_options(): binary_output(false), quantization_bits(16), num_threads(0),
+                      verbose(true), float32(false), reorder(false), keep_reorder(false) {}
+};
+
+// Read a mesh, run the stages on it, and write it. Return an empty
+// string on success, or else what went wrong.
+template <class Mesh>
+std::string run_pipeline(std::string const& input_file, std::string const& output_file,
+                         std::vector<Stage> const& stages, Pipeline_options const& opt,
+                         cgal_tools::Tool_stats & stats) {
+
+  if (opt.verbose)
+    std::cout << "Reading mesh: " << input_file << std::endl;
+  stats.start_phase("read");
+  Mesh mesh;
+  if(!cgal_tools::read_mesh(input_file, mesh)) {
+    stats.end_phase();
+    return "Invalid input.";
+  }
+  stats.end_phase();
+  if (opt.verbose)
+    print_phase(stats, mesh);
+  stats.set_count("input_faces", mesh.number_of_faces());
+
+  if (opt.reorder) {
+    stats.start_phase("reorder");
+    bool reordered = cgal_tools::hilbert_reorder_mesh(mesh, !opt.keep_reorder);
+    stats.end_phase();
+    if (opt.verbose) {
+      if (!reordered)
+        std::cout << "Could not reorder the mesh, keeping its order.\n";
+      print_phase(stats, mesh);
+    }
+  }
+
+  int holes_found = 0, holes_filled = 0;
+  std::size_t components_removed = 0, edges_collapsed = 0;
+  for (std::size_t it = 0; it < stages.size(); it++) {
+    Stage const& stage = stages[it];
+
+    // All stages index into arrays by vertex, edge, or face index, so
+    // the elements removed by an earlier stage must be purged first
+    if (mesh.has_garbage()) {
+      stats.start_phase("collect_garbage");
+      mesh.collect_garbage();
+      stats.end_phase();
+      if (opt.verbose)
+        print_phase(stats, mesh);
+    }
+
+    stats.start_phase(stage.name);
+    if (stage.name == "rm_connected_components") {
+      cgal_tools::Rm_connected_components_params params = stage.rm_cc;
+      params.num_threads = opt.num_threads;
+      std::size_t num_kept = 0;
+      std::size_t num = cgal_tools::rm_connected_components(mesh, params, &num_kept);
+      components_removed += num - num_kept;
+      if (opt.verbose)
+        std::cout << "The mesh has " << num << " connected components.\n";
+    } else if (stage.name == "fill_holes") {
+      cgal_tools::Fill_holes_params params = stage.fill;
+      params.num_threads = opt.num_threads;
+      cgal_tools::Fill_holes_report report;
+      cgal_tools::fill_holes(mesh, params, &report);
+      holes_found  += report.num_found;
+      holes_filled += report.num_filled;
+    } else if (stage.name == "smoothe_mesh") {
+      cgal_tools::Smoothe_params params = stage.smoothe;
+      params.num_threads = opt.num_threads;
+      cgal_tools::smoothe_mesh(mesh, params);
+    } else if (stage.name == "simplify_mesh") {
+      if (!CGAL::is_triangle_mesh(mesh)) {
+        stats.end_phase();
+        return "Input geometry is not triangulated.";
+      }
+      edges_collapsed += cgal_tools::simplify_mesh(mesh, stage.simplify);
+    } else if (stage.name == "isotropic_remesh") {
+      if (!CGAL::is_triangle_mesh(mesh)) {
+        stats.end_phase();
+        return "Input geometry is not triangulated.";
+      }
+      // On one thread, remeshing the whole mesh is faster than by patches
+      cgal_tools::Isotropic_remesh_params params = stage.remesh;
+      int num_threads = cgal_tools::resolve_num_threads(opt.num_threads);
+      params.num_threads = num_threads > 1 ? num_threads : 0;
+      cgal_tools::isotropic_remesh(mesh, params);
+    }
+    stats.end_phase();
+    if (opt.verbose)
+      print_phase(stats, mesh);
+  }
+
+  stats.set_count("holes_found", holes_found);
+  stats.set_count("holes_filled", holes_filled);
+  stats.set_count("components_removed", components_removed);
+  stats.set_count("edges_collapsed", edges_collapsed);
+
+  if (opt.reorder && !opt.keep_reorder) {
+    stats.start_phase("restore_order");
+    bool restored = cgal_tools::restore_mesh_order(mesh);
+    stats.end_phase();
+    if (!restored)
+      std::cout << "Could not restore the input order, writing the spatial order.\n";
+    if (opt.verbose)
+      print_phase(stats, mesh);
+  }
+
+  // The binary writer skips removed elements, but the ASCII one does not
+  if (!opt.binary_output && mesh.has_garbage()) {
+    stats.start_phase("collect_garbage");
+    mesh.collect_garbage();
+    stats.end_phase();
+    if (opt.verbose)
+      print_phase(stats, mesh);
+  }
+  stats.set_count("output_faces", mesh.number_of_faces());
+
+  if (opt.verbose)
+    std::cout << "Writing output mesh: " << output_file << std::endl;
+  stats.start_phase("write");
+  if (!cgal_tools::write_mesh(output_file, mesh, opt.binary_output, opt.quantization_bits)) {
+    stats.end_phase();
+    return "Failed writing: " + output_file;
+  }
+  stats.end_phase();
+  if (opt.verbose)
+    print_phase(stats, mesh);
+
+  return "";
+}
+
+// Run the pipeline with the point precision of the options
+std::string run_pipeline(std::string const& input_file, std::string const& output_file,
+                         std::vector<Stage> const& stages, Pipeline_options const& opt,
+                         cgal_tools::Tool_stats & stats) {
+  if (opt.float32)
+    return run_pipeline<cgal_tools::Float_mesh>(input_file, output_file, stages, opt, stats);
+  return run_pipeline<Mesh>(input_file, output_file, stages, opt, stats);
+}
+
+// All that affects the output of the pipeline, for the cache key
+std::string pipeline_cache_params(std::vector<Stage> const& stages,
+                                  Pipeline_options const& opt) {
+  std::ostringstream params;
+  params.precision(17);
+  params << opt.binary_output << " " << opt.quantization_bits << " " << opt.num_threads
+         << " " << opt.float32 << " " << opt.reorder << " " << opt.keep_reorder;
+  for (Stage const& stage : stages) {
+    params << " " << stage.name;
+    if (stage.name == "rm_connected_components")
+      params << " " << stage.rm_cc.num_min_faces_in_component << " "
+             << stage.rm_cc.num_components_to_keep;
+    else if (stage.name == "fill_holes")
+      params << " " << stage.fill.max_hole_diam << " " << stage.fill.max_num_hole_edges;
+    else if (stage.name == "smoothe_mesh")
+      params << " " << stage.smoothe.num_iterations << " " << stage.smoothe.smoothing_time
+             << " " << stage.smoothe.smoothe_boundary;
+    else if (stage.name == "simplify_mesh")
+      params << " " << stage.simplify.edge_keep_ratio;
+    else if (stage.name == "isotropic_remesh")
+      params << " " << stage.remesh.target_edge_length << " " << stage.remesh.num_iterations;
+  }
+  return params.str();
+}
+
+// One line of a manifest, and how its processing went
+struct Batch_item {
+  std::string input_file, output_file;
+  std::string error;
+  double seconds;
+  bool   cached;        // copied from the cache
+  double seconds_saved; // by that, about
+  Batch_item(): seconds(0), cached(false), seconds_saved(0) {}
+};
+
+// Read the input and output file of each line. Empty lines and lines
+// starting with # are skipped. Return false on failure.
+bool read_manifest(std::string const& manifest_file, std::vector<Batch_item> & items) {
+  std::ifstream in(manifest_file.c_str());
+  if (!in)
+    return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream is(line);
+    Batch_item item;
+    if (!(is >> item.input_file) || item.input_file[0] == '#')
+      continue;
+    if (!(is >> item.output_file)) {
+      std::cerr << "No output file for: " << item.input_file << std::endl;
+      return false;
+    }
+    items.push_back(item);
+  }
+  return true;
+}
+
+// Run the stages on the meshes of the manifest, num_jobs at a time,
+// each on its own thread, which bounds the number of meshes in memory.
+// A mesh that fails, even with an exception, does not stop the others.
+// Meshes whose result is in the cache are copied from it instead.
+// Return the number of failures.
+int run_batch(std::vector<Batch_item> & items, std::vector<Stage> const& stages,
+              Pipeline_options const& opt, int num_jobs, cgal_tools::Result_cache & cache) {
+
+  const std::string cache_params = pipeline_cache_params(stages, opt);
+  std::mutex print_mutex;
+  std::size_t num_done = 0;
+  cgal_tools::parallel_for(0, items.size(), num_jobs, [&](std::size_t it) {
+      Batch_item & item = items[it];
+      // Meshes run side by side, so only the batch measures memory
+      cgal_tools::Tool_stats stats("mesh_pipeline");
+      stats.set_measure_memory(false);
+      double start = cgal_tools::wall_time();
+      try {
+        std::string key;
+        if (cache.enabled())
+          key = cache.key("mesh_pipeline", cache_params, item.input_file,
+                          item.output_file);
+        double cached_seconds = 0;
+        if (!key.empty() && cache.fetch(key, item.output_file, cached_seconds)) {
+          item.cached = true;
+          item.seconds_saved = std::max(0.0, cached_seconds -
+                                        (cgal_tools::wall_time() - start));
+        } else {
+          double run_start = cgal_tools::wall_time();
+          item.error = run_pipeline(item.input_file, item.output_file, stages, opt, stats);
+          if (item.error.empty() && !key.empty())
+            cache.store(key, item.output_file, cgal_tools::wall_time() - run_start);
+        }
+      } catch (std::exception const& e) {
+        item.error = std::string("Exception: ") + e.what();
+      } catch (...) {
+        item.error = "Unknown exception.";
+      }
+      item.seconds = cgal_tools::wall_time() - start;
+
+      std::lock_guard<std::mutex> lock(print_mutex);
+      num_done++;
+      printf("[%zu/%zu] %-6s %9.3f s  %s\n", num_done, items.size(),
+             !item.error.empty() ? "failed" : item.cached ? "cached" : "ok", item.seconds,
+             item.input_file.c_str());
+      fflush(stdout);
+    });
+
+  int num_failed = 0;
+  for (Batch_item const& item : items)
+    num_failed += !item.error.empty();
+  return num_failed;
+}
+
+// Print aggregate timings and the failures, and if asked, write the
+// timing of each file as CSV
+bool print_batch_summary(std::vector<Batch_item> const& items, double wall_seconds,
+                         std::string const& summary_file) {
+  std::vector<double> times;
+  for (Batch_item const& item : items)
+    times.push_back(item.seconds);
+  std::sort(times.begin(), times.end());
+  double total = 0;
+  for (double t : times)
+    total += t;
+  std::size_t num_cached = 0;
+  double seconds_saved = 0;
+  for (Batch_item const& item : items) {
+    num_cached += item.cached;
+    seconds_saved += item.seconds_saved;
+  }
+
+  std::cout << "Meshes:          " << items.size() << "\n";
+  if (!times.empty()) {
+    std::cout << "Wall time:       " << wall_seconds << " s\n"
+              << "Time per mesh:   min " << times.front() << " s, median "
+              << times[times.size() / 2] << " s, max " << times.back() << " s\n"
+              << "Throughput:      " << items.size() / std::max(wall_seconds, 1e-9)
+              << " meshes/s, " << total / std::max(wall_seconds, 1e-9) << "x concurrency\n";
+  }
+  if (num_cached > 0)
+    std::cout << "From the cache:  " << num_cached << " meshes, saving about "
+              << seconds_saved << " s\n";
+  for (Batch_item const& item : items)
+    if (!item.error.empty())
+      std::cout << "Failed: " << item.input_file << ": " << item.error << "\n";
+
+  if (summary_file.empty())
+    return true;
+  std::ofstream out(summary_file.c_str());
+  out << "input,output,status,seconds,cached,error\n";
+  for (Batch_item const& item : items) {
+    std::string error = item.error;
+    std::replace(error.begin(), error.end(), '"', '\'');
+    out << item.input_file << "," << item.output_file << ","
+        << (item.error.empty() ? "ok" : "failed") << "," << item.seconds << ","
+        << item.cached << ",\"" << error << "\"\n";
+  }
+  if (!out) {
+    std::cerr << "Failed writing: " << summary_file << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+
+  cgal_tools::Tool_stats stats("mesh_pipeline");
+  cgal_tools::extract_stats_options(argc, argv, stats);
+  cgal_tools::Result_cache cache;
+  cgal_tools::extract_cache_options(argc, argv, cache);
+  Pipeline_options opt;
+  opt.binary_output = cgal_tools::extract_flag(argc, argv, "binary");
+  opt.float32 = cgal_tools::extract_flag(argc, argv, "float32");
+  cgal_tools::extract_option(argc, argv, "quantization_bits", opt.quantization_bits);
+  opt.keep_reorder = cgal_tools::extract_flag(argc, argv, "keep_reorder");
+  opt.reorder = cgal_tools::extract_flag(argc, argv, "reorder") || opt.keep_reorder;
+  bool threads_given = cgal_tools::extract_option(argc, argv, "num_threads", opt.num_threads);
+  std::string manifest_file, summary_file;
+  int num_jobs = 0;
+  cgal_tools::extract_option(argc, argv, "manifest", manifest_file);
+  cgal_tools::extract_option(argc, argv, "jobs", num_jobs);
+  cgal_tools::extract_option(argc, argv, "summary", summary_file);
+
+  // With a manifest the stages come first
+  bool batch = !manifest_file.empty();
+  int first_stage = batch ? 1 : 3;
+  std::vector<Stage> stages;
+  if (argc < first_stage + 1 || !cgal_tools::check_no_unknown_options(argc, argv) ||
+      !parse_stages(argc, argv, first_stage, stages)) {
+    std::cout << "Usage: " << argv[0] << " [--binary] [--quantization_bits B] [--float32]"
+              << " [--reorder | --keep_reorder]"
+              << " [--num_threads N] "
+              << cgal_tools::stats_usage() << " " << cgal_tools::cache_usage()
+              << " input.ply output.ply "
+              << "stage [params] [stage [params] ...]\n"
+              << "   or: " << argv[0] << " [--binary] [--quantization_bits B] [--float32]"
+              << " [--reorder | --keep_reorder]"
+              << " [--num_threads N]"
+              << " --manifest file"
+              << " [--jobs J] [--summary file.csv] " << cgal_tools::stats_usage() << " "
+              << cgal_tools::cache_usage()
+              << " stage [params] [stage [params] ...]\n"
+              << "Stages, with the same parameters as the tools of the same name:\n"
+              << "  rm_connected_components num_min_faces_in_component num_components_to_keep\n"
+              << "  fill_holes max_hole_diameter max_num_hole_edges\n"
+              << "  smoothe_mesh num_iterations smoothing_time smoothe_boundary\n"
+              << "  simplify_mesh edge_keep_ratio\n"
+              << "  isotropic_remesh target_edge_length num_iterations\n"
+              << "A manifest has an input and an output file on each line. Its meshes\n"
+              << "are processed J at a time (all cores by default), each on one thread\n"
+              << "unless --num_threads is given. A mesh that fails does not stop the\n"
+              << "others. The time of each mesh is written to the --summary file.\n"
+              << "With --reorder, each mesh is renumbered along a space-filling curve\n"
+              << "before the stages and put back in the input order before writing, as far\n"
+              << "as the stages allow. With --keep_reorder the new order is kept.\n"
+              << "Output files named .cmesh are written in a compressed format, with\n"
+              << "coordinates quantized to --quantization_bits (default 16, 0 for exact).\n";
+    return 1;
+  }
+
+  if (!batch) {
+    return cgal_tools::run_with_cache(cache, "mesh_pipeline",
+                                      pipeline_cache_params(stages, opt), argv[1], argv[2],
+                                      stats, [&]() {
+        std::string error = run_pipeline(argv[1], argv[2], stages, opt, stats);
+        if (!error.empty()) {
+          std::cerr << error << std::endl;
+          return 1;
+        }
+        stats.emit();
+        return 0;
+      });
+  }
+
+  std::vector<Batch_item> items;
+  if (!read_manifest(manifest_file, items)) {
+    std::cerr << "Invalid manifest: " << manifest_file << std::endl;
+    return 1;
+  }
+  num_jobs = cgal_tools::resolve_num_threads(num_jobs);
+  if (!threads_given)
+    opt.num_threads = 1;
+  opt.verbose = false;
+  std::cout << "Processing " << items.size() << " meshes, " << num_jobs
+            << " at a time." << std::endl;
+
+  stats.start_phase("batch");
+  int num_failed = run_batch(items, stages, opt, num_jobs, cache);
+  stats.end_phase();
+  stats.set_count("meshes", items.size());
+  stats.set_count("failed", num_failed);
+  stats.set_count("jobs", num_jobs);
+  if (cache.enabled()) {
+    std::size_t num_hits = 0;
+    double seconds_saved = 0;
+    for (Batch_item const& item : items) {
+      num_hits += item.cached;
+      seconds_saved += item.seconds_saved;
+    }
+    stats.set_count("cache_hits", num_hits);
+    stats.set_count("cache_misses", items.size() - num_hits);
+    stats.set_count("cache_seconds_saved", seconds_saved);
+  }
+
+  bool success = print_batch_summary(items, stats.last_phase().wall_seconds, summary_file);
+  stats.emit();
+  return (success && num_failed == 0) ? 0 : 1;
+}
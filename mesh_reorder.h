@@ -0,0 +1,180 @@
+// Renumbering of the vertices and faces of a mesh for locality.
+// Meshes from photogrammetry come with vertices and faces in no
+// particular order, so walking the mesh jumps all over memory. Sorting
+// the vertices along a Hilbert curve, and the faces by their first
+// vertex in that order, puts neighbours close in memory, which makes
+// smoothing, component labeling and simplification faster. The
+// original order can be restored afterwards, for the vertices and
+// faces that are left.
+
+#ifndef CGAL_TOOLS_MESH_REORDER_H
+#define CGAL_TOOLS_MESH_REORDER_H
+
+#include <CGAL/Kernel_traits.h>
+#include <CGAL/Spatial_sort_traits_adapter_3.h>
+#include <CGAL/Surface_mesh.h>
+#include <CGAL/boost/graph/iterator.h>
+#include <CGAL/hilbert_sort.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace cgal_tools {
+
+// Build in result the mesh with its vertices and faces in the given
+// orders, which need not cover all of them. Return false if some face
+// could not be added. This can happen even for a valid manifold mesh
+// with all faces given: adding faces one at a time in an arbitrary
+// order, such as the Hilbert order, can join separate fans of faces at
+// a shared vertex in a way Surface_mesh::add_face() rejects.
+template <class Mesh>
+bool permute_mesh(Mesh const& mesh, std::vector<typename Mesh::Vertex_index> const& vertex_order,
+                  std::vector<typename Mesh::Face_index> const& face_order, Mesh & result) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+
+  result.clear();
+  result.reserve(vertex_order.size(), vertex_order.size() + face_order.size(),
+                 face_order.size());
+  std::vector<Vertex_index> new_index(mesh.num_vertices(), Mesh::null_vertex());
+  for (Vertex_index v : vertex_order)
+    new_index[v] = result.add_vertex(mesh.point(v));
+
+  std::vector<Vertex_index> face_vertices;
+  for (Face_index f : face_order) {
+    face_vertices.clear();
+    for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh))
+      face_vertices.push_back(new_index[v]);
+    if (result.add_face(face_vertices) == Mesh::null_face())
+      return false;
+  }
+  return true;
+}
+
+// Sort the faces by the smallest new index of their vertices, ties
+// going to the earlier face
+template <class Mesh>
+void order_faces_by_vertices(Mesh const& mesh, std::vector<std::uint32_t> const& vertex_rank,
+                             std::vector<typename Mesh::Face_index> & face_order) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+
+  std::vector<std::pair<std::uint32_t, Face_index> > keyed;
+  keyed.reserve(mesh.number_of_faces());
+  for (Face_index f : mesh.faces()) {
+    std::uint32_t key = std::numeric_limits<std::uint32_t>::max();
+    for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh))
+      key = std::min(key, vertex_rank[v]);
+    keyed.push_back(std::make_pair(key, f));
+  }
+  std::sort(keyed.begin(), keyed.end());
+
+  face_order.clear();
+  face_order.reserve(keyed.size());
+  for (std::pair<std::uint32_t, Face_index> const& k : keyed)
+    face_order.push_back(k.second);
+}
+
+// Renumber the vertices of the mesh along a Hilbert curve through
+// their points, and the faces to match. If asked, record the index
+// each vertex and face had, so restore_mesh_order() can put them back.
+// Any garbage is dropped. Return false, leaving the mesh as it was, if
+// the mesh could not be rebuilt.
+template <class Mesh>
+bool hilbert_reorder_mesh(Mesh & mesh, bool record_original) {
+
+  typedef typename Mesh::Vertex_index                               Vertex_index;
+  typedef typename Mesh::Face_index                                 Face_index;
+  typedef typename CGAL::Kernel_traits<typename Mesh::Point>::Kernel Kernel;
+  typedef typename Mesh::template Property_map<Vertex_index, typename Mesh::Point> Point_map;
+  typedef CGAL::Spatial_sort_traits_adapter_3<Kernel, Point_map>    Sort_traits;
+
+  // The median policy splits at medians, so the order depends only on
+  // the points and not on any random choice
+  std::vector<Vertex_index> vertex_order(mesh.vertices().begin(), mesh.vertices().end());
+  CGAL::hilbert_sort(vertex_order.begin(), vertex_order.end(), Sort_traits(mesh.points()),
+                     CGAL::Hilbert_sort_median_policy());
+
+  std::vector<std::uint32_t> vertex_rank(mesh.num_vertices(), 0);
+  for (std::size_t it = 0; it < vertex_order.size(); it++)
+    vertex_rank[vertex_order[it]] = it;
+  std::vector<Face_index> face_order;
+  order_faces_by_vertices(mesh, vertex_rank, face_order);
+
+  Mesh result;
+  if (!permute_mesh(mesh, vertex_order, face_order, result))
+    return false;
+
+  if (record_original) {
+    const std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+    typename Mesh::template Property_map<Vertex_index, std::uint32_t> vmap =
+      result.template add_property_map<Vertex_index, std::uint32_t>
+      ("v:original_index", none).first;
+    typename Mesh::template Property_map<Face_index, std::uint32_t> fmap =
+      result.template add_property_map<Face_index, std::uint32_t>
+      ("f:original_index", none).first;
+    for (std::size_t it = 0; it < vertex_order.size(); it++)
+      vmap[Vertex_index(it)] = vertex_order[it];
+    for (std::size_t it = 0; it < face_order.size(); it++)
+      fmap[Face_index(it)] = face_order[it];
+  }
+
+  mesh = std::move(result);
+  return true;
+}
+
+// Put the vertices and faces left in the mesh back in the order
+// recorded by hilbert_reorder_mesh(), and drop the record. Those added
+// since go last, in their current order. Any garbage is dropped.
+// Return false if no order was recorded, as when an operation rebuilt
+// the mesh, or if the mesh could not be rebuilt in the input order
+// (see permute_mesh()). The mesh then keeps the spatial order it has,
+// with nothing lost, and is written out in that order.
+template <class Mesh>
+bool restore_mesh_order(Mesh & mesh) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+  typedef typename Mesh::template Property_map<Vertex_index, std::uint32_t> Vertex_map;
+  typedef typename Mesh::template Property_map<Face_index, std::uint32_t>   Face_map;
+
+  std::pair<Vertex_map, bool> vmap =
+    mesh.template property_map<Vertex_index, std::uint32_t>("v:original_index");
+  std::pair<Face_map, bool> fmap =
+    mesh.template property_map<Face_index, std::uint32_t>("f:original_index");
+  if (!vmap.second || !fmap.second)
+    return false;
+
+  std::vector<std::pair<std::uint32_t, Vertex_index> > vertices;
+  for (Vertex_index v : mesh.vertices())
+    vertices.push_back(std::make_pair(vmap.first[v], v));
+  std::sort(vertices.begin(), vertices.end());
+  std::vector<Vertex_index> vertex_order;
+  for (std::pair<std::uint32_t, Vertex_index> const& v : vertices)
+    vertex_order.push_back(v.second);
+
+  std::vector<std::pair<std::uint32_t, Face_index> > faces;
+  for (Face_index f : mesh.faces())
+    faces.push_back(std::make_pair(fmap.first[f], f));
+  std::sort(faces.begin(), faces.end());
+  std::vector<Face_index> face_order;
+  for (std::pair<std::uint32_t, Face_index> const& f : faces)
+    face_order.push_back(f.second);
+
+  mesh.remove_property_map(vmap.first);
+  mesh.remove_property_map(fmap.first);
+  Mesh result;
+  if (!permute_mesh(mesh, vertex_order, face_order, result))
+    return false;
+  mesh = std::move(result);
+  return true;
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_MESH_REORDER_H
@@ -0,0 +1,170 @@
+// Regions of interest, so that a tool can fix a small damaged area of
+// a large mesh that is otherwise fine. The region is given by a box or
+// a list of faces, and grown by a few rings of faces, so the operation
+// has some room around the damage. Everything outside is held fixed,
+// and past picking the region, which is one pass over the points for
+// a box, the work depends only on the size of the region.
+
+#ifndef CGAL_TOOLS_MESH_ROI_H
+#define CGAL_TOOLS_MESH_ROI_H
+
+#include <CGAL/boost/graph/iterator.h>
+
+#include "mesh_types.h"
+#include "submesh.h"
+#include "tool_options.h"
+#include "tool_params.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace cgal_tools {
+
+// Return false if some face index of the region is not a face of the
+// mesh
+template <class Mesh>
+bool roi_faces_in_mesh(Mesh const& mesh, Mesh_roi const& roi) {
+  typedef typename Mesh::Face_index Face_index;
+  for (std::size_t index : roi.faces) {
+    if (index >= mesh.num_faces() || mesh.is_removed(Face_index(index)))
+      return false;
+  }
+  return true;
+}
+
+// Set faces to the faces of the region, sorted. Face indices that are
+// not faces of the mesh are skipped.
+template <class Mesh>
+void select_roi_faces(Mesh const& mesh, Mesh_roi const& roi,
+                      std::vector<typename Mesh::Face_index> & faces) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+
+  faces.clear();
+  std::vector<Vertex_index> seeds;
+  if (roi.has_box) {
+    for (Vertex_index v : mesh.vertices()) {
+      typename Mesh::Point const& p = mesh.point(v);
+      double x = CGAL::to_double(p.x()), y = CGAL::to_double(p.y()),
+        z = CGAL::to_double(p.z());
+      if (x >= roi.box[0] && y >= roi.box[1] && z >= roi.box[2] &&
+          x <= roi.box[3] && y <= roi.box[4] && z <= roi.box[5])
+        seeds.push_back(v);
+    }
+    // The first ring is the faces with a vertex in the box
+    collect_face_rings(mesh, seeds, roi.num_rings + 1, faces);
+  }
+
+  seeds.clear();
+  for (std::size_t index : roi.faces) {
+    Face_index f(index);
+    if (index >= mesh.num_faces() || mesh.is_removed(f))
+      continue;
+    faces.push_back(f);
+    for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh))
+      seeds.push_back(v);
+  }
+  std::sort(seeds.begin(), seeds.end());
+  seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+  collect_face_rings(mesh, seeds, roi.num_rings, faces);
+
+  std::sort(faces.begin(), faces.end());
+  faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+}
+
+// Append one border halfedge for each hole or outer border that runs
+// along the given faces
+template <class Mesh>
+void roi_boundary_cycles(Mesh const& mesh, std::vector<typename Mesh::Face_index> const& faces,
+                         std::vector<typename Mesh::Halfedge_index> & cycles) {
+
+  typedef typename Mesh::Halfedge_index Halfedge_index;
+  typedef typename Mesh::Face_index     Face_index;
+
+  std::unordered_set<Halfedge_index> seen;
+  for (Face_index f : faces) {
+    for (Halfedge_index h : CGAL::halfedges_around_face(mesh.halfedge(f), mesh)) {
+      Halfedge_index b = mesh.opposite(h);
+      if (!mesh.is_border(b) || seen.count(b))
+        continue;
+      cycles.push_back(b);
+      for (Halfedge_index hc : CGAL::halfedges_around_face(b, mesh))
+        seen.insert(hc);
+    }
+  }
+}
+
+// Read whitespace separated face indices. Return false if the file
+// cannot be read, or holds something else.
+inline bool read_face_list(std::string const& file_name, std::vector<std::size_t> & faces) {
+  std::ifstream in(file_name.c_str());
+  if (!in)
+    return false;
+  faces.clear();
+  std::size_t index;
+  while (in >> index)
+    faces.push_back(index);
+  return in.eof();
+}
+
+// Remove --roi_box x0,y0,z0,x1,y1,z1, --roi_faces file and
+// --roi_rings K from the arguments and set the region. Return false,
+// saying why, if they are not valid.
+inline bool extract_roi_options(int & argc, char** argv, Mesh_roi & roi) {
+  std::string box, faces_file;
+  if (extract_option(argc, argv, "roi_box", box)) {
+    char rest;
+    roi.has_box = true;
+    if (sscanf(box.c_str(), "%lf,%lf,%lf,%lf,%lf,%lf%c", &roi.box[0], &roi.box[1],
+               &roi.box[2], &roi.box[3], &roi.box[4], &roi.box[5], &rest) != 6 ||
+        roi.box[0] > roi.box[3] || roi.box[1] > roi.box[4] || roi.box[2] > roi.box[5]) {
+      std::cerr << "Invalid box: " << box << std::endl;
+      return false;
+    }
+  }
+  if (extract_option(argc, argv, "roi_faces", faces_file)) {
+    if (!read_face_list(faces_file, roi.faces) || roi.faces.empty()) {
+      std::cerr << "Invalid face list: " << faces_file << std::endl;
+      return false;
+    }
+  }
+  extract_option(argc, argv, "roi_rings", roi.num_rings);
+  if (roi.num_rings < 0) {
+    std::cerr << "The number of rings must not be negative." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+inline const char* roi_usage() {
+  return "[--roi_box x0,y0,z0,x1,y1,z1] [--roi_faces file] [--roi_rings K]";
+}
+
+// The region as text, for the cache key
+inline std::string roi_description(Mesh_roi const& roi) {
+  if (roi.empty())
+    return "all";
+  std::ostringstream text;
+  text.precision(17);
+  text << roi.num_rings;
+  if (roi.has_box)
+    text << " box " << roi.box[0] << " " << roi.box[1] << " " << roi.box[2] << " "
+         << roi.box[3] << " " << roi.box[4] << " " << roi.box[5];
+  if (!roi.faces.empty()) {
+    text << " faces";
+    for (std::size_t index : roi.faces)
+      text << " " << index;
+  }
+  return text.str();
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_MESH_ROI_H
@@ -0,0 +1,50 @@
+// The point precision of the meshes. The tools store points in double
+// precision by default, and in single precision with --float32, which
+// halves the point storage, 12 of the roughly 130 bytes a vertex of a
+// Surface_mesh takes with its connectivity, and shrinks binary output
+// by about a quarter. Steps that are sensitive to precision copy what they
+// work on to double precision.
+
+#ifndef CGAL_TOOLS_MESH_TYPES_H
+#define CGAL_TOOLS_MESH_TYPES_H
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Kernel_traits.h>
+#include <CGAL/Simple_cartesian.h>
+#include <CGAL/Surface_mesh.h>
+
+namespace cgal_tools {
+
+typedef CGAL::Exact_predicates_inexact_constructions_kernel  Double_kernel;
+typedef CGAL::Surface_mesh<Double_kernel::Point_3>            Double_mesh;
+typedef CGAL::Simple_cartesian<float>                         Float_kernel;
+typedef CGAL::Surface_mesh<Float_kernel::Point_3>             Float_mesh;
+
+// Whether the mesh stores its points in single precision
+template <class Mesh>
+struct Is_float_mesh {
+  typedef typename CGAL::Kernel_traits<typename Mesh::Point>::Kernel::FT FT;
+  static const bool value = (sizeof(FT) == sizeof(float));
+};
+
+// The mesh type to copy to for precision-sensitive steps, which is
+// the mesh type itself unless it stores single precision points
+template <class Mesh, bool = Is_float_mesh<Mesh>::value>
+struct Promoted_mesh {
+  typedef Mesh type;
+};
+
+template <class Mesh>
+struct Promoted_mesh<Mesh, true> {
+  typedef Double_mesh type;
+};
+
+// A point of one kernel as a point of another, through doubles
+template <class Point, class Other_point>
+Point convert_point(Other_point const& p) {
+  return Point(CGAL::to_double(p.x()), CGAL::to_double(p.y()), CGAL::to_double(p.z()));
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_MESH_TYPES_H
@@ -0,0 +1,79 @@
+// A minimal parallel loop over std::thread, so the tools need no
+// threading library beyond the standard one.
+
+#ifndef CGAL_TOOLS_PARALLEL_FOR_H
+#define CGAL_TOOLS_PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cgal_tools {
+
+// The number of threads to use when zero or less was asked for
+inline int resolve_num_threads(int num_threads) {
+  if (num_threads > 0)
+    return num_threads;
+  int num_cores = std::thread::hardware_concurrency();
+  return std::max(num_cores, 1);
+}
+
+// Call fn(i) for each i in [begin, end) on the given number of
+// threads. Work is handed out dynamically in blocks of grain_size
+// indices, so items of uneven cost are balanced. The first exception
+// thrown by fn is rethrown on the calling thread.
+template <class Fn>
+void parallel_for(std::size_t begin, std::size_t end, int num_threads, Fn fn,
+                  std::size_t grain_size = 1) {
+  if (begin >= end)
+    return;
+
+  num_threads = resolve_num_threads(num_threads);
+  grain_size = std::max(grain_size, std::size_t(1));
+  std::size_t num_blocks = (end - begin + grain_size - 1) / grain_size;
+  num_threads = int(std::min(std::size_t(num_threads), num_blocks));
+
+  if (num_threads <= 1) {
+    for (std::size_t it = begin; it < end; it++)
+      fn(it);
+    return;
+  }
+
+  std::atomic<std::size_t> next(begin);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&]() {
+    try {
+      while (true) {
+        std::size_t block_begin = next.fetch_add(grain_size);
+        if (block_begin >= end)
+          break;
+        std::size_t block_end = std::min(block_begin + grain_size, end);
+        for (std::size_t it = block_begin; it < block_end; it++)
+          fn(it);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error)
+        error = std::current_exception();
+      next = end; // stop the other threads early
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int it = 1; it < num_threads; it++)
+    threads.push_back(std::thread(worker));
+  worker();
+  for (std::size_t it = 0; it < threads.size(); it++)
+    threads[it].join();
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_PARALLEL_FOR_H
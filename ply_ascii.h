@@ -0,0 +1,299 @@
+// Parallel parsing of ASCII PLY files. The body is split into pieces
+// at line ends, the pieces are parsed on several threads with
+// std::from_chars, and the results are joined into a flat polygon
+// soup in file order. Values are converted as the C++ streams convert
+// them, float properties being read as float and then widened, so the
+// result is bit-identical to what the CGAL reader gives. This has no
+// CGAL dependency.
+//
+// Each record must be on a line of its own, which is how PLY writers
+// lay out ASCII files. Anything else, such as blank lines in the body
+// or a record spread over several lines, makes the parser give up, so
+// the caller can fall back to a slower, more lenient reader.
+
+#ifndef CGAL_TOOLS_PLY_ASCII_H
+#define CGAL_TOOLS_PLY_ASCII_H
+
+#include "parallel_for.h"
+#include "ply_io.h"
+#include "polygon_soup.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace cgal_tools {
+
+// Parse one value of the given type starting at ptr, after any blanks.
+// Return the end of the value, or NULL if there is no valid value
+// followed by a blank or the end of the line.
+inline const char* parse_ascii_ply_value(const char* ptr, const char* line_end, Ply_type type,
+                                         double & value) {
+  while (ptr < line_end && (*ptr == ' ' || *ptr == '\t'))
+    ptr++;
+  std::from_chars_result result;
+  if (type == PLY_FLOAT32) {
+    float v = 0;
+    result = std::from_chars(ptr, line_end, v);
+    value = v;
+  } else if (type == PLY_FLOAT64) {
+    double v = 0;
+    result = std::from_chars(ptr, line_end, v);
+    value = v;
+  } else {
+    long long v = 0;
+    result = std::from_chars(ptr, line_end, v);
+    value = double(v);
+  }
+  if (result.ec != std::errc())
+    return NULL;
+  ptr = result.ptr;
+  if (ptr < line_end && *ptr != ' ' && *ptr != '\t' && *ptr != '\r')
+    return NULL;
+  return ptr;
+}
+
+// The records of an element parsed from one piece of the body
+struct Ascii_ply_piece {
+  std::vector<double>        coords;   // x y z of each vertex
+  std::vector<std::size_t>   degrees;  // of each face
+  std::vector<std::uint32_t> indices;  // of the faces, one after another
+  std::size_t num_records;
+  bool ok;
+  Ascii_ply_piece(): num_records(0), ok(true) {}
+};
+
+// Parse the records of an element in [begin, end), one per line
+inline void parse_ascii_ply_records(const char* begin, const char* end,
+                                    Ply_element const& element, Ascii_ply_piece & piece) {
+  const bool is_vertex = (element.name == "vertex");
+  int ix = -1, iy = -1, iz = -1, list_index = -1;
+  if (is_vertex) {
+    ix = element.property_index("x");
+    iy = element.property_index("y");
+    iz = element.property_index("z");
+  } else {
+    list_index = element.property_index("vertex_indices");
+    if (list_index < 0)
+      list_index = element.property_index("vertex_index");
+  }
+  std::vector<Ply_property> const& props = element.properties;
+
+  const char* ptr = begin;
+  while (ptr < end) {
+    const char* line_end = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+    if (line_end == NULL)
+      line_end = end;
+
+    double xyz[3] = {0, 0, 0};
+    for (int p = 0; p < int(props.size()) && ptr != NULL; p++) {
+      Ply_property const& prop = props[p];
+      double value = 0;
+      if (!prop.is_list()) {
+        ptr = parse_ascii_ply_value(ptr, line_end, prop.type, value);
+        if (p == ix) xyz[0] = value;
+        if (p == iy) xyz[1] = value;
+        if (p == iz) xyz[2] = value;
+        continue;
+      }
+      ptr = parse_ascii_ply_value(ptr, line_end, prop.count_type, value);
+      if (ptr == NULL || value < 0) {
+        ptr = NULL;
+        break;
+      }
+      std::size_t count = std::size_t(value);
+      for (std::size_t it = 0; it < count && ptr != NULL; it++) {
+        ptr = parse_ascii_ply_value(ptr, line_end, prop.type, value);
+        if (p != list_index)
+          continue;
+        if (value < 0 || value > double(std::uint32_t(-1))) {
+          ptr = NULL;
+          break;
+        }
+        piece.indices.push_back(std::uint32_t(value));
+      }
+      if (p == list_index)
+        piece.degrees.push_back(count);
+    }
+
+    // Only trailing blanks may remain on the line
+    while (ptr != NULL && ptr < line_end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r'))
+      ptr++;
+    if (ptr != line_end) {
+      piece.ok = false;
+      return;
+    }
+    if (is_vertex)
+      piece.coords.insert(piece.coords.end(), xyz, xyz + 3);
+    piece.num_records++;
+    ptr = line_end + 1;
+  }
+}
+
+// Where each line of the body starts is not stored. Instead the
+// newlines of fixed pieces of the body are counted in parallel, and
+// the start of a given line is found from these counts.
+class Ascii_ply_lines {
+public:
+  Ascii_ply_lines(const char* begin, const char* end, int num_threads):
+    m_begin(begin), m_end(end) {
+    const std::size_t size = end - begin;
+    m_piece_size = std::max<std::size_t>(1 << 20,
+                                         size / (8 * resolve_num_threads(num_threads)) + 1);
+    std::size_t num_pieces = (size + m_piece_size - 1) / m_piece_size;
+    m_counts.assign(num_pieces + 1, 0);
+    parallel_for(0, num_pieces, num_threads, [&](std::size_t it) {
+        const char* ptr = begin + it * m_piece_size;
+        m_counts[it + 1] = std::count(ptr, std::min(ptr + m_piece_size, end), '\n');
+      });
+    for (std::size_t it = 0; it < num_pieces; it++)
+      m_counts[it + 1] += m_counts[it];
+  }
+
+  // The start of the given line, the end of the body if there are
+  // not that many lines
+  const char* line_start(std::size_t line) const {
+    if (line == 0)
+      return m_begin;
+    // The piece holding the newline ending the previous line
+    std::size_t piece = std::lower_bound(m_counts.begin(), m_counts.end(), line)
+      - m_counts.begin();
+    if (piece >= m_counts.size())
+      return m_end;
+    std::size_t to_skip = line - m_counts[piece - 1];
+    const char* ptr = m_begin + (piece - 1) * m_piece_size;
+    while (true) {
+      ptr = static_cast<const char*>(std::memchr(ptr, '\n', m_end - ptr));
+      if (--to_skip == 0)
+        return ptr + 1;
+      ptr++;
+    }
+  }
+
+private:
+  const char* m_begin;
+  const char* m_end;
+  std::size_t m_piece_size;
+  std::vector<std::size_t> m_counts; // newlines before each piece
+};
+
+// Parse the vertices and faces of an ASCII PLY file into the soup,
+// using the given number of threads. Return false if the file is not
+// laid out as this parser expects, or face indices are out of range.
+inline bool read_ascii_ply_soup(const char* data, std::size_t size, Ply_header const& header,
+                                int num_threads, Flat_soup & soup) {
+  if (header.format != Ply_header::ASCII)
+    return false;
+  int vertex_id = header.element_index("vertex");
+  int face_id   = header.element_index("face");
+  if (vertex_id < 0 || face_id < 0)
+    return false;
+  Ply_element const& vertex_element = header.elements[vertex_id];
+  Ply_element const& face_element   = header.elements[face_id];
+  if (vertex_element.property_index("x") < 0 || vertex_element.property_index("y") < 0 ||
+      vertex_element.property_index("z") < 0)
+    return false;
+  int list_index = face_element.property_index("vertex_indices");
+  if (list_index < 0)
+    list_index = face_element.property_index("vertex_index");
+  if (list_index < 0 || !face_element.properties[list_index].is_list())
+    return false;
+
+  const char* body = data + header.body_offset;
+  const char* end  = data + size;
+  Ascii_ply_lines lines(body, end, num_threads);
+
+  soup = Flat_soup();
+  std::size_t first_line = 0;
+  for (std::size_t e = 0; e < header.elements.size(); e++) {
+    Ply_element const& element = header.elements[e];
+    const std::size_t last_line = first_line + element.count;
+    if (int(e) != vertex_id && int(e) != face_id) {
+      first_line = last_line;
+      continue;
+    }
+
+    // Split the lines of the element into pieces at line ends
+    const char* begin = lines.line_start(first_line);
+    const char* stop  = lines.line_start(last_line);
+    first_line = last_line;
+    std::size_t num_pieces = std::max<std::size_t>
+      (1, std::min<std::size_t>(8 * resolve_num_threads(num_threads), (stop - begin) >> 16));
+    std::vector<const char*> bounds(num_pieces + 1, stop);
+    bounds[0] = begin;
+    for (std::size_t it = 1; it < num_pieces; it++) {
+      const char* ptr = std::max(bounds[it - 1], begin + (stop - begin) * it / num_pieces);
+      const char* line_end = static_cast<const char*>(std::memchr(ptr, '\n', stop - ptr));
+      bounds[it] = line_end == NULL ? stop : line_end + 1;
+    }
+
+    std::vector<Ascii_ply_piece> pieces(num_pieces);
+    parallel_for(0, num_pieces, num_threads, [&](std::size_t it) {
+        parse_ascii_ply_records(bounds[it], bounds[it + 1], element, pieces[it]);
+      });
+
+    // Join the pieces in order
+    std::size_t num_records = 0, num_values = 0;
+    for (Ascii_ply_piece const& piece : pieces) {
+      if (!piece.ok)
+        return false;
+      num_records += piece.num_records;
+      num_values  += (int(e) == vertex_id) ? piece.coords.size() : piece.indices.size();
+    }
+    if (num_records != element.count)
+      return false;
+
+    std::vector<std::size_t> value_start(num_pieces + 1, 0), record_start(num_pieces + 1, 0);
+    for (std::size_t it = 0; it < num_pieces; it++) {
+      value_start[it + 1]  = value_start[it] + ((int(e) == vertex_id) ?
+                                                pieces[it].coords.size() :
+                                                pieces[it].indices.size());
+      record_start[it + 1] = record_start[it] + pieces[it].num_records;
+    }
+
+    if (int(e) == vertex_id) {
+      soup.coords.resize(num_values);
+      parallel_for(0, num_pieces, num_threads, [&](std::size_t it) {
+          std::copy(pieces[it].coords.begin(), pieces[it].coords.end(),
+                    soup.coords.begin() + value_start[it]);
+          std::vector<double>().swap(pieces[it].coords);
+        });
+    } else {
+      soup.indices.resize(num_values);
+      soup.offsets.resize(num_records + 1);
+      parallel_for(0, num_pieces, num_threads, [&](std::size_t it) {
+          Ascii_ply_piece & piece = pieces[it];
+          std::copy(piece.indices.begin(), piece.indices.end(),
+                    soup.indices.begin() + value_start[it]);
+          std::size_t offset = value_start[it];
+          for (std::size_t k = 0; k < piece.degrees.size(); k++) {
+            offset += piece.degrees[k];
+            soup.offsets[record_start[it] + k + 1] = offset;
+          }
+          piece = Ascii_ply_piece();
+        });
+    }
+  }
+
+  const std::size_t num_points = soup.num_points();
+  for (std::uint32_t index : soup.indices)
+    if (index >= num_points)
+      return false;
+  return true;
+}
+
+// Read an ASCII PLY file into the soup
+inline bool read_ascii_ply_soup(std::string const& input_file, int num_threads,
+                                Flat_soup & soup) {
+  Mapped_file mapped;
+  Ply_header header;
+  return mapped.open(input_file) && parse_ply_header(mapped.data(), mapped.size(), header) &&
+    read_ascii_ply_soup(mapped.data(), mapped.size(), header, num_threads, soup);
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_PLY_ASCII_H
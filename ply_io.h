@@ -0,0 +1,470 @@
+// Low-level PLY file access that does not depend on CGAL. The header
+// is parsed into a list of elements and properties, the body of a
+// binary file is walked in place through a memory map, and binary
+// output is accumulated in large blocks before being written.
+
+#ifndef CGAL_TOOLS_PLY_IO_H
+#define CGAL_TOOLS_PLY_IO_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace cgal_tools {
+
+inline bool host_is_little_endian() {
+  const std::uint16_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+// A read-only memory map of a whole file
+class Mapped_file {
+public:
+  Mapped_file(): m_data(NULL), m_size(0) {}
+  ~Mapped_file() { close(); }
+
+  bool open(std::string const& file) {
+    close();
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+      ::close(fd);
+      return false;
+    }
+    void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED)
+      return false;
+    // The body is read front to back
+    madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(ptr);
+    m_size = st.st_size;
+    return true;
+  }
+
+  void close() {
+    if (m_data != NULL)
+      munmap(const_cast<char*>(m_data), m_size);
+    m_data = NULL;
+    m_size = 0;
+  }
+
+  const char* data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+
+  // For when the data will be read in no particular order
+  void set_random_access() {
+    if (m_data != NULL)
+      madvise(const_cast<char*>(m_data), m_size, MADV_RANDOM);
+  }
+
+private:
+  Mapped_file(Mapped_file const&);
+  Mapped_file& operator=(Mapped_file const&);
+
+  const char* m_data;
+  std::size_t m_size;
+};
+
+enum Ply_type { PLY_INVALID, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16,
+                PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+inline Ply_type ply_type_from_name(std::string const& name) {
+  if (name == "char"   || name == "int8")    return PLY_INT8;
+  if (name == "uchar"  || name == "uint8")   return PLY_UINT8;
+  if (name == "short"  || name == "int16")   return PLY_INT16;
+  if (name == "ushort" || name == "uint16")  return PLY_UINT16;
+  if (name == "int"    || name == "int32")   return PLY_INT32;
+  if (name == "uint"   || name == "uint32")  return PLY_UINT32;
+  if (name == "float"  || name == "float32") return PLY_FLOAT32;
+  if (name == "double" || name == "float64") return PLY_FLOAT64;
+  return PLY_INVALID;
+}
+
+inline std::size_t ply_type_size(Ply_type type) {
+  switch (type) {
+  case PLY_INT8:    case PLY_UINT8:   return 1;
+  case PLY_INT16:   case PLY_UINT16:  return 2;
+  case PLY_INT32:   case PLY_UINT32:  case PLY_FLOAT32: return 4;
+  case PLY_FLOAT64: return 8;
+  default: return 0;
+  }
+}
+
+// Read a little-endian binary value of given type as a double. The
+// pointer need not be aligned.
+inline double ply_read_scalar(const char* ptr, Ply_type type) {
+  switch (type) {
+  case PLY_INT8:    { std::int8_t   v; std::memcpy(&v, ptr, 1); return v; }
+  case PLY_UINT8:   { std::uint8_t  v; std::memcpy(&v, ptr, 1); return v; }
+  case PLY_INT16:   { std::int16_t  v; std::memcpy(&v, ptr, 2); return v; }
+  case PLY_UINT16:  { std::uint16_t v; std::memcpy(&v, ptr, 2); return v; }
+  case PLY_INT32:   { std::int32_t  v; std::memcpy(&v, ptr, 4); return v; }
+  case PLY_UINT32:  { std::uint32_t v; std::memcpy(&v, ptr, 4); return v; }
+  case PLY_FLOAT32: { float         v; std::memcpy(&v, ptr, 4); return v; }
+  case PLY_FLOAT64: { double        v; std::memcpy(&v, ptr, 8); return v; }
+  default: return 0;
+  }
+}
+
+struct Ply_property {
+  std::string name;
+  Ply_type type;        // the value type
+  Ply_type count_type;  // PLY_INVALID unless this is a list
+  bool is_list() const { return count_type != PLY_INVALID; }
+};
+
+struct Ply_element {
+  std::string name;
+  std::size_t count;
+  std::vector<Ply_property> properties;
+
+  int property_index(std::string const& prop_name) const {
+    for (std::size_t it = 0; it < properties.size(); it++)
+      if (properties[it].name == prop_name) return it;
+    return -1;
+  }
+
+  // The size of each record if it has no list properties, else 0
+  std::size_t fixed_record_size() const {
+    std::size_t size = 0;
+    for (std::size_t it = 0; it < properties.size(); it++) {
+      if (properties[it].is_list()) return 0;
+      size += ply_type_size(properties[it].type);
+    }
+    return size;
+  }
+};
+
+struct Ply_header {
+  enum Format { ASCII, BINARY_LITTLE_ENDIAN, BINARY_BIG_ENDIAN };
+  Format format;
+  std::vector<Ply_element> elements;
+  std::size_t body_offset; // where the data starts, right after end_header
+
+  int element_index(std::string const& name) const {
+    for (std::size_t it = 0; it < elements.size(); it++)
+      if (elements[it].name == name) return it;
+    return -1;
+  }
+};
+
+// Parse the text header at the start of a PLY file
+inline bool parse_ply_header(const char* data, std::size_t size, Ply_header & header) {
+  header = Ply_header();
+  header.format = Ply_header::ASCII;
+
+  std::size_t pos = 0;
+  bool have_format = false;
+  int line_no = 0;
+  while (pos < size) {
+    std::size_t end = pos;
+    while (end < size && data[end] != '\n') end++;
+    if (end == size) return false; // never saw end_header
+    std::string line(data + pos, end - pos);
+    if (!line.empty() && line[line.size() - 1] == '\r')
+      line.resize(line.size() - 1);
+    pos = end + 1;
+
+    std::istringstream is(line);
+    std::string keyword;
+    is >> keyword;
+    if (line_no++ == 0) {
+      if (keyword != "ply") return false;
+      continue;
+    }
+
+    if (keyword == "format") {
+      std::string format;
+      is >> format;
+      if (format == "ascii")                     header.format = Ply_header::ASCII;
+      else if (format == "binary_little_endian") header.format = Ply_header::BINARY_LITTLE_ENDIAN;
+      else if (format == "binary_big_endian")    header.format = Ply_header::BINARY_BIG_ENDIAN;
+      else return false;
+      have_format = true;
+    } else if (keyword == "element") {
+      Ply_element element;
+      if (!(is >> element.name >> element.count)) return false;
+      header.elements.push_back(element);
+    } else if (keyword == "property") {
+      if (header.elements.empty()) return false;
+      std::string type;
+      Ply_property prop;
+      is >> type;
+      if (type == "list") {
+        std::string count_type, value_type;
+        is >> count_type >> value_type;
+        prop.count_type = ply_type_from_name(count_type);
+        prop.type       = ply_type_from_name(value_type);
+        if (prop.count_type == PLY_INVALID) return false;
+      } else {
+        prop.count_type = PLY_INVALID;
+        prop.type       = ply_type_from_name(type);
+      }
+      if (prop.type == PLY_INVALID || !(is >> prop.name)) return false;
+      header.elements.back().properties.push_back(prop);
+    } else if (keyword == "end_header") {
+      header.body_offset = pos;
+      return have_format;
+    }
+    // Comments, obj_info, and blank lines are ignored
+  }
+
+  return false;
+}
+
+// Whether the file holds nothing but vertex positions and face vertex
+// lists, which is all the fast mesh readers keep. Files with more, such
+// as colours, normals or quality, should be read by the CGAL reader,
+// which keeps them as properties of the mesh.
+inline bool ply_has_only_geometry(Ply_header const& header) {
+  for (Ply_element const& element : header.elements) {
+    if (element.name != "vertex" && element.name != "face" && element.count > 0)
+      return false;
+    for (Ply_property const& prop : element.properties) {
+      bool geometry = element.name == "vertex" ?
+        !prop.is_list() && (prop.name == "x" || prop.name == "y" || prop.name == "z") :
+        prop.is_list() && (prop.name == "vertex_indices" || prop.name == "vertex_index");
+      if (!geometry)
+        return false;
+    }
+  }
+  return true;
+}
+
+// Walk the body of a little-endian binary PLY file in place. For each
+// vertex call vertex_fn(x, y, z), and for each face call
+// face_fn(indices, num_indices). Other elements and properties are
+// skipped. A callback returning false aborts the walk. Return false if
+// the data is malformed or the walk was aborted.
+template <class VertexFn, class FaceFn>
+bool walk_binary_ply(const char* data, std::size_t size, Ply_header const& header,
+                     VertexFn vertex_fn, FaceFn face_fn) {
+  const char* ptr = data + header.body_offset;
+  const char* end = data + size;
+  std::vector<std::uint32_t> indices;
+
+  for (std::size_t e = 0; e < header.elements.size(); e++) {
+    Ply_element const& element = header.elements[e];
+    std::vector<Ply_property> const& props = element.properties;
+
+    if (element.name == "vertex") {
+      int ix = element.property_index("x");
+      int iy = element.property_index("y");
+      int iz = element.property_index("z");
+      if (ix < 0 || iy < 0 || iz < 0) return false;
+
+      std::size_t record_size = element.fixed_record_size();
+      if (record_size > 0) {
+        // The usual case, each record has the same layout
+        std::size_t ox = 0, oy = 0, oz = 0, offset = 0;
+        for (int p = 0; p < int(props.size()); p++) {
+          if (p == ix) ox = offset;
+          if (p == iy) oy = offset;
+          if (p == iz) oz = offset;
+          offset += ply_type_size(props[p].type);
+        }
+        if (std::size_t(end - ptr) / record_size < element.count) return false;
+        for (std::size_t v = 0; v < element.count; v++, ptr += record_size) {
+          if (!vertex_fn(ply_read_scalar(ptr + ox, props[ix].type),
+                         ply_read_scalar(ptr + oy, props[iy].type),
+                         ply_read_scalar(ptr + oz, props[iz].type)))
+            return false;
+        }
+        continue;
+      }
+    }
+
+    int list_index = -1;
+    if (element.name == "face") {
+      list_index = element.property_index("vertex_indices");
+      if (list_index < 0)
+        list_index = element.property_index("vertex_index");
+      if (list_index < 0 || !props[list_index].is_list()) return false;
+    }
+
+    // The general case, records of variable size
+    double xyz[3] = {0, 0, 0};
+    for (std::size_t r = 0; r < element.count; r++) {
+      for (int p = 0; p < int(props.size()); p++) {
+        Ply_property const& prop = props[p];
+        std::size_t value_size = ply_type_size(prop.type);
+        if (!prop.is_list()) {
+          if (std::size_t(end - ptr) < value_size) return false;
+          if (element.name == "vertex") {
+            if (prop.name == "x") xyz[0] = ply_read_scalar(ptr, prop.type);
+            if (prop.name == "y") xyz[1] = ply_read_scalar(ptr, prop.type);
+            if (prop.name == "z") xyz[2] = ply_read_scalar(ptr, prop.type);
+          }
+          ptr += value_size;
+          continue;
+        }
+
+        std::size_t count_size = ply_type_size(prop.count_type);
+        if (std::size_t(end - ptr) < count_size) return false;
+        double count = ply_read_scalar(ptr, prop.count_type);
+        ptr += count_size;
+        if (count < 0 || std::size_t(end - ptr) / value_size < std::size_t(count))
+          return false;
+        if (p == list_index) {
+          indices.resize(std::size_t(count));
+          for (std::size_t it = 0; it < indices.size(); it++) {
+            double index = ply_read_scalar(ptr + it * value_size, prop.type);
+            if (index < 0) return false;
+            indices[it] = std::uint32_t(index);
+          }
+        }
+        ptr += std::size_t(count) * value_size;
+      }
+
+      if (element.name == "vertex" && !vertex_fn(xyz[0], xyz[1], xyz[2]))
+        return false;
+      if (list_index >= 0 && !face_fn(indices.data(), indices.size()))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+// Random access to the vertex coordinates of a memory-mapped binary
+// little-endian PLY file, for when the vertices are too many to load.
+// Requires the vertex records and all records before them to have
+// fixed size.
+class Ply_vertex_table {
+public:
+  Ply_vertex_table(): m_base(NULL), m_stride(0), m_count(0) {}
+
+  bool init(const char* data, std::size_t size, Ply_header const& header) {
+    if (header.format != Ply_header::BINARY_LITTLE_ENDIAN || !host_is_little_endian())
+      return false;
+    std::size_t offset = header.body_offset;
+    for (std::size_t e = 0; e < header.elements.size(); e++) {
+      Ply_element const& element = header.elements[e];
+      std::size_t record_size = element.fixed_record_size();
+      if (record_size == 0)
+        return false;
+      if (element.name != "vertex") {
+        offset += record_size * element.count;
+        continue;
+      }
+
+      const char* names[3] = {"x", "y", "z"};
+      for (int c = 0; c < 3; c++) {
+        int index = element.property_index(names[c]);
+        if (index < 0)
+          return false;
+        m_types[c] = element.properties[index].type;
+        m_offsets[c] = 0;
+        for (int p = 0; p < index; p++)
+          m_offsets[c] += ply_type_size(element.properties[p].type);
+      }
+      if (offset + record_size * element.count > size)
+        return false;
+      m_base   = data + offset;
+      m_stride = record_size;
+      m_count  = element.count;
+      return true;
+    }
+    return false;
+  }
+
+  std::size_t size() const { return m_count; }
+
+  void point(std::size_t index, double xyz[3]) const {
+    const char* record = m_base + index * m_stride;
+    for (int c = 0; c < 3; c++)
+      xyz[c] = ply_read_scalar(record + m_offsets[c], m_types[c]);
+  }
+
+private:
+  const char* m_base;
+  std::size_t m_stride, m_count;
+  std::size_t m_offsets[3];
+  Ply_type m_types[3];
+};
+
+// Write a binary little-endian PLY file with vertex coordinates and
+// a face list, buffering the output in large blocks.
+class Ply_binary_writer {
+public:
+  explicit Ply_binary_writer(std::string const& file,
+                             std::size_t buffer_size = std::size_t(1) << 24):
+    m_out(file.c_str(), std::ios::binary), m_buf(buffer_size), m_pos(0) {}
+
+  ~Ply_binary_writer() { close(); }
+
+  bool is_open() const { return m_out.is_open(); }
+
+  // The coordinate type is "float" or "double"
+  void write_header(std::size_t num_vertices, std::size_t num_faces,
+                    std::string const& coord_type) {
+    std::ostringstream os;
+    os << "ply\n"
+       << "format binary_little_endian 1.0\n"
+       << "comment Generated by cgal_tools\n"
+       << "element vertex " << num_vertices << "\n"
+       << "property " << coord_type << " x\n"
+       << "property " << coord_type << " y\n"
+       << "property " << coord_type << " z\n"
+       << "element face " << num_faces << "\n"
+       << "property list uchar int vertex_indices\n"
+       << "end_header\n";
+    std::string text = os.str();
+    write_bytes(text.data(), text.size());
+  }
+
+  template <class T>
+  void put(T value) {
+    if (m_pos + sizeof(T) > m_buf.size())
+      flush();
+    std::memcpy(&m_buf[m_pos], &value, sizeof(T));
+    m_pos += sizeof(T);
+  }
+
+  void write_bytes(const char* data, std::size_t size) {
+    if (m_pos + size > m_buf.size())
+      flush();
+    if (size > m_buf.size()) {
+      m_out.write(data, size);
+      return;
+    }
+    std::memcpy(&m_buf[m_pos], data, size);
+    m_pos += size;
+  }
+
+  void flush() {
+    if (m_pos > 0)
+      m_out.write(&m_buf[0], m_pos);
+    m_pos = 0;
+  }
+
+  bool close() {
+    if (!m_out.is_open())
+      return false;
+    flush();
+    m_out.close();
+    return !m_out.fail();
+  }
+
+private:
+  std::ofstream m_out;
+  std::vector<char> m_buf;
+  std::size_t m_pos;
+};
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_PLY_IO_H
@@ -0,0 +1,334 @@
+// A polygon soup held in flat arrays, and its repair in parallel:
+// merging duplicate points, removing degenerate and duplicate
+// polygons, and dropping points no polygon uses. Duplicates are found
+// by hashing rather than sorting, and the result does not depend on
+// the number of threads. This has no CGAL dependency.
+
+#ifndef CGAL_TOOLS_POLYGON_SOUP_H
+#define CGAL_TOOLS_POLYGON_SOUP_H
+
+#include "parallel_for.h"
+#include "ply_io.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace cgal_tools {
+
+// The vertices of polygon p are indices[offsets[p]] up to
+// indices[offsets[p + 1]], and point i is coords[3 * i] up to
+// coords[3 * i + 2].
+struct Flat_soup {
+  std::vector<double>        coords;
+  std::vector<std::size_t>   offsets;
+  std::vector<std::uint32_t> indices;
+
+  Flat_soup(): offsets(1, 0) {}
+  std::size_t num_points() const { return coords.size() / 3; }
+  std::size_t num_polygons() const { return offsets.size() - 1; }
+  std::size_t degree(std::size_t p) const { return offsets[p + 1] - offsets[p]; }
+  bool all_triangles() const { return indices.size() == 3 * num_polygons(); }
+};
+
+// Read a binary little-endian PLY file straight into the soup. Polygons
+// with out of range indices are skipped. Return false if the file is
+// not of that kind.
+inline bool read_binary_ply_soup(std::string const& input_file, Flat_soup & soup) {
+  Mapped_file mapped;
+  Ply_header header;
+  if (!mapped.open(input_file) || !parse_ply_header(mapped.data(), mapped.size(), header) ||
+      header.format != Ply_header::BINARY_LITTLE_ENDIAN || !host_is_little_endian())
+    return false;
+
+  int vertex_id = header.element_index("vertex");
+  int face_id   = header.element_index("face");
+  if (vertex_id < 0 || face_id < 0)
+    return false;
+
+  soup = Flat_soup();
+  soup.coords.reserve(3 * header.elements[vertex_id].count);
+  soup.offsets.reserve(header.elements[face_id].count + 1);
+  soup.indices.reserve(3 * header.elements[face_id].count);
+  std::size_t num_points = header.elements[vertex_id].count;
+  return walk_binary_ply
+    (mapped.data(), mapped.size(), header,
+     [&](double x, double y, double z) {
+       soup.coords.push_back(x);
+       soup.coords.push_back(y);
+       soup.coords.push_back(z);
+       return true;
+     },
+     [&](const std::uint32_t* indices, std::size_t n) {
+       for (std::size_t it = 0; it < n; it++)
+         if (indices[it] >= num_points) return true;
+       soup.indices.insert(soup.indices.end(), indices, indices + n);
+       soup.offsets.push_back(soup.indices.size());
+       return true;
+     });
+}
+
+// For each item i in [0, n), set rep[i] to the smallest j with
+// equal(i, j). The items are split by hash into shards, each shard is
+// sorted by index, and each is searched with its own open addressing
+// table, so shards are handled in parallel without locks.
+template <class Hash, class Equal>
+void find_duplicates(std::size_t n, Hash hash, Equal equal, int num_threads,
+                     std::vector<std::uint32_t> & rep) {
+  rep.resize(n);
+  if (n == 0)
+    return;
+
+  std::vector<std::uint64_t> hashes(n);
+  parallel_for(0, n, num_threads, [&](std::size_t it) { hashes[it] = hash(it); }, 1 << 14);
+
+  // The shard is given by the top bits and the table slot by the low bits
+  const int shard_bits = 8;
+  const std::size_t num_shards = std::size_t(1) << shard_bits;
+  auto shard_of = [&](std::size_t it) { return std::size_t(hashes[it] >> (64 - shard_bits)); };
+
+  // Count per block and shard, then scatter, keeping index order
+  const std::size_t block_size = std::max<std::size_t>(1 << 16, n / 1024 + 1);
+  const std::size_t num_blocks = (n + block_size - 1) / block_size;
+  std::vector<std::size_t> counts(num_blocks * num_shards, 0);
+  parallel_for(0, num_blocks, num_threads, [&](std::size_t b) {
+      std::size_t end = std::min(n, (b + 1) * block_size);
+      for (std::size_t it = b * block_size; it < end; it++)
+        counts[b * num_shards + shard_of(it)]++;
+    });
+  std::vector<std::size_t> shard_begin(num_shards + 1, 0);
+  std::vector<std::size_t> positions(num_blocks * num_shards);
+  std::size_t total = 0;
+  for (std::size_t s = 0; s < num_shards; s++) {
+    shard_begin[s] = total;
+    for (std::size_t b = 0; b < num_blocks; b++) {
+      positions[b * num_shards + s] = total;
+      total += counts[b * num_shards + s];
+    }
+  }
+  shard_begin[num_shards] = total;
+  std::vector<std::size_t>().swap(counts);
+
+  std::vector<std::uint32_t> order(n);
+  parallel_for(0, num_blocks, num_threads, [&](std::size_t b) {
+      std::size_t end = std::min(n, (b + 1) * block_size);
+      for (std::size_t it = b * block_size; it < end; it++)
+        order[positions[b * num_shards + shard_of(it)]++] = it;
+    });
+
+  const std::uint32_t empty = std::uint32_t(-1);
+  parallel_for(0, num_shards, num_threads, [&](std::size_t s) {
+      std::size_t size = shard_begin[s + 1] - shard_begin[s];
+      std::size_t capacity = 16;
+      while (capacity < 2 * size)
+        capacity *= 2;
+      std::vector<std::uint32_t> table(capacity, empty);
+
+      for (std::size_t k = shard_begin[s]; k < shard_begin[s + 1]; k++) {
+        std::uint32_t it = order[k];
+        std::size_t slot = hashes[it] & (capacity - 1);
+        while (true) {
+          std::uint32_t other = table[slot];
+          if (other == empty) {
+            table[slot] = it;
+            rep[it] = it;
+            break;
+          }
+          if (hashes[other] == hashes[it] && equal(other, it)) {
+            rep[it] = other;
+            break;
+          }
+          slot = (slot + 1) & (capacity - 1);
+        }
+      }
+    });
+}
+
+inline std::uint64_t mix_hash(std::uint64_t h, std::uint64_t value) {
+  h ^= value + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return h;
+}
+
+// Merge points with identical coordinates, keeping the first of each.
+// Return the number of points removed.
+inline std::size_t merge_duplicate_points(Flat_soup & soup, int num_threads) {
+  const std::size_t n = soup.num_points();
+  auto bits = [&](std::size_t it, int c) {
+    double value = soup.coords[3 * it + c];
+    if (value == 0) value = 0; // so that -0 and 0 hash the same
+    std::uint64_t result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+  };
+  std::vector<std::uint32_t> rep;
+  find_duplicates(n,
+                  [&](std::size_t it) {
+                    return mix_hash(mix_hash(mix_hash(0, bits(it, 0)), bits(it, 1)), bits(it, 2));
+                  },
+                  [&](std::size_t a, std::size_t b) {
+                    const double* p = &soup.coords[3 * a];
+                    const double* q = &soup.coords[3 * b];
+                    return p[0] == q[0] && p[1] == q[1] && p[2] == q[2];
+                  },
+                  num_threads, rep);
+
+  // Number the kept points in order. A duplicate comes after the point
+  // it is merged into, so that point is numbered first.
+  std::vector<std::uint32_t> new_index(n);
+  std::size_t num_kept = 0;
+  for (std::size_t it = 0; it < n; it++) {
+    if (rep[it] == it) {
+      new_index[it] = num_kept;
+      if (num_kept != it)
+        std::memcpy(&soup.coords[3 * num_kept], &soup.coords[3 * it], 3 * sizeof(double));
+      num_kept++;
+    } else {
+      new_index[it] = new_index[rep[it]];
+    }
+  }
+  soup.coords.resize(3 * num_kept);
+
+  parallel_for(0, soup.indices.size(), num_threads, [&](std::size_t it) {
+      soup.indices[it] = new_index[soup.indices[it]];
+    }, 1 << 16);
+
+  return n - num_kept;
+}
+
+// Remove consecutive repeated vertices within each polygon, then the
+// polygons left with fewer than three distinct vertices. Return the
+// number of polygons removed.
+inline std::size_t remove_degenerate_polygons(Flat_soup & soup) {
+  std::size_t num_polygons = soup.num_polygons();
+  std::size_t out = 0, num_out_polygons = 0;
+  std::size_t begin = soup.offsets[0];
+  for (std::size_t p = 0; p < num_polygons; p++) {
+    std::size_t end = soup.offsets[p + 1];
+    std::size_t start = out;
+    for (std::size_t it = begin; it < end; it++) {
+      std::uint32_t v = soup.indices[it];
+      if (out > start && soup.indices[out - 1] == v)
+        continue;
+      soup.indices[out++] = v;
+    }
+    while (out - start > 1 && soup.indices[out - 1] == soup.indices[start])
+      out--;
+
+    if (out - start < 3) {
+      out = start;
+    } else {
+      num_out_polygons++;
+      soup.offsets[num_out_polygons] = out;
+    }
+    begin = end;
+  }
+  soup.offsets.resize(num_out_polygons + 1);
+  soup.indices.resize(out);
+  return num_polygons - num_out_polygons;
+}
+
+// Remove polygons with the same vertices as an earlier one, in either
+// orientation, keeping the first. Return the number removed.
+inline std::size_t merge_duplicate_polygons(Flat_soup & soup, int num_threads) {
+  const std::size_t n = soup.num_polygons();
+
+  // Compare polygons by their vertices sorted, and then confirm that
+  // the cycles match
+  auto same_cycle = [&](std::size_t a, std::size_t b) {
+    std::size_t na = soup.degree(a), nb = soup.degree(b);
+    if (na != nb)
+      return false;
+    std::uint32_t const* pa = &soup.indices[soup.offsets[a]];
+    std::uint32_t const* pb = &soup.indices[soup.offsets[b]];
+    std::size_t shift = 0;
+    while (shift < nb && pb[shift] != pa[0])
+      shift++;
+    if (shift == nb)
+      return false;
+    bool forward = true, backward = true;
+    for (std::size_t it = 0; it < na; it++) {
+      forward  = forward  && pa[it] == pb[(shift + it) % nb];
+      backward = backward && pa[it] == pb[(shift + nb - it) % nb];
+    }
+    return forward || backward;
+  };
+  std::vector<std::uint32_t> rep;
+  find_duplicates(n,
+                  [&](std::size_t p) {
+                    // An order independent hash of the vertices
+                    std::uint64_t sum = 0, x = 0;
+                    for (std::size_t it = soup.offsets[p]; it < soup.offsets[p + 1]; it++) {
+                      std::uint64_t h = mix_hash(0, soup.indices[it]);
+                      sum += h;
+                      x ^= h * 0x9e3779b97f4a7c15ull;
+                    }
+                    return mix_hash(mix_hash(sum, x), soup.degree(p));
+                  },
+                  same_cycle, num_threads, rep);
+
+  std::size_t out = 0, num_kept = 0;
+  for (std::size_t p = 0; p < n; p++) {
+    if (rep[p] != p)
+      continue;
+    std::size_t begin = soup.offsets[p], end = soup.offsets[p + 1];
+    for (std::size_t it = begin; it < end; it++)
+      soup.indices[out++] = soup.indices[it];
+    num_kept++;
+    soup.offsets[num_kept] = out;
+  }
+  soup.offsets.resize(num_kept + 1);
+  soup.indices.resize(out);
+  return n - num_kept;
+}
+
+// Remove points no polygon uses. Return the number removed.
+inline std::size_t remove_isolated_points(Flat_soup & soup, int num_threads) {
+  const std::size_t n = soup.num_points();
+  std::vector<unsigned char> used(n, 0);
+  for (std::uint32_t v : soup.indices)
+    used[v] = 1;
+
+  std::vector<std::uint32_t> new_index(n);
+  std::size_t num_kept = 0;
+  for (std::size_t it = 0; it < n; it++) {
+    if (!used[it])
+      continue;
+    new_index[it] = num_kept;
+    if (num_kept != it)
+      std::memcpy(&soup.coords[3 * num_kept], &soup.coords[3 * it], 3 * sizeof(double));
+    num_kept++;
+  }
+  soup.coords.resize(3 * num_kept);
+
+  parallel_for(0, soup.indices.size(), num_threads, [&](std::size_t it) {
+      soup.indices[it] = new_index[soup.indices[it]];
+    }, 1 << 16);
+
+  return n - num_kept;
+}
+
+struct Soup_repair_stats {
+  std::size_t points_merged, degenerate_polygons, duplicate_polygons, isolated_points;
+  Soup_repair_stats(): points_merged(0), degenerate_polygons(0), duplicate_polygons(0),
+                       isolated_points(0) {}
+};
+
+// The steps of CGAL's repair_polygon_soup() that matter for meshes
+// from scanning and reconstruction, in the same order
+inline Soup_repair_stats repair_flat_soup(Flat_soup & soup, int num_threads) {
+  Soup_repair_stats stats;
+  stats.points_merged       = merge_duplicate_points(soup, num_threads);
+  stats.degenerate_polygons = remove_degenerate_polygons(soup);
+  stats.duplicate_polygons  = merge_duplicate_polygons(soup, num_threads);
+  stats.isolated_points     = remove_isolated_points(soup, num_threads);
+  return stats;
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_POLYGON_SOUP_H
@@ -0,0 +1,825 @@
+// Smoothe, fill holes in, or simplify a mesh that is too large to fit
+// in memory. The input, which must be binary little-endian PLY, is
+// memory-mapped and its faces are sorted into spatial tiles, with
+// each face going to every tile it overlaps, margin included. The
+// tiles are then processed independently and in parallel, as many at
+// a time as fit in the memory budget. Each tile owns the vertices and
+// faces lying in it, and only writes those. The output is assembled
+// from the tile results, with vertices shared across tiles matched by
+// their index in the input.
+//
+// Smoothing and hole filling do not change the input faces, so tiles
+// agree along the seams by construction. For simplification, the
+// vertices each tile does not exclusively own are kept fixed, so the
+// seams are not simplified but stay watertight.
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Surface_mesh.h>
+
+#include "fill_holes.h"
+#include "simplify_mesh.h"
+#include "smoothe_mesh.h"
+#include "parallel_for.h"
+#include "ply_io.h"
+#include "tool_options.h"
+#include "tool_stats.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel;
+typedef Kernel::Point_3                                     Point;
+typedef CGAL::Surface_mesh<Point>                           Mesh;
+typedef Mesh::Vertex_index                                  Vertex_index;
+typedef Mesh::Halfedge_index                                Halfedge_index;
+typedef Mesh::Edge_index                                    Edge_index;
+typedef Mesh::Face_index                                    Face_index;
+
+// A rough upper bound on the memory used per face of a tile, by the
+// mesh and by the operations on it, used to keep within the budget
+const double BYTES_PER_TILE_FACE = 1024.0;
+
+// The most tiles the grid may have. Each tile has its own temporary
+// files and spill buffer.
+const int MAX_NUM_TILES = 1 << 16;
+
+// A regular grid of cubical tiles covering the mesh bounding box
+struct Tile_grid {
+  double origin[3];
+  double tile_size;
+  int dims[3];
+
+  int num_tiles() const { return dims[0] * dims[1] * dims[2]; }
+
+  int cell(double x, int c) const {
+    double d = std::floor((x - origin[c]) / tile_size);
+    if (d < 0) return 0;
+    if (d > dims[c] - 1) return dims[c] - 1;
+    return int(d);
+  }
+
+  int tile_id(const int cells[3]) const {
+    return cells[0] + dims[0] * (cells[1] + dims[1] * cells[2]);
+  }
+
+  int tile_of(const double p[3]) const {
+    int cells[3] = {cell(p[0], 0), cell(p[1], 1), cell(p[2], 2)};
+    return tile_id(cells);
+  }
+
+  void tile_cells(int tile, int cells[3]) const {
+    cells[0] = tile % dims[0];
+    cells[1] = (tile / dims[0]) % dims[1];
+    cells[2] = tile / (dims[0] * dims[1]);
+  }
+
+  // Whether the box [lo - margin, hi + margin] overlaps the tile
+  bool overlaps(int tile, const double lo[3], const double hi[3], double margin) const {
+    int cells[3];
+    tile_cells(tile, cells);
+    for (int c = 0; c < 3; c++) {
+      if (cells[c] < cell(lo[c] - margin, c) || cells[c] > cell(hi[c] + margin, c))
+        return false;
+    }
+    return true;
+  }
+};
+
+// What to do with each tile
+struct Operation {
+  std::string name;
+  cgal_tools::Smoothe_params    smoothe;
+  cgal_tools::Fill_holes_params fill;
+  cgal_tools::Simplify_params   simplify;
+};
+
+// Everything the tiles share, all read-only during processing
+struct Context {
+  cgal_tools::Ply_vertex_table vertices;
+  Tile_grid grid;
+  double margin;
+  std::string temp_dir;
+  Operation op;
+
+  void point(std::uint32_t index, double p[3]) const { vertices.point(index, p); }
+
+  std::string tile_file(int tile, std::string const& ext) const {
+    return temp_dir + "/tile_" + std::to_string(tile) + "." + ext;
+  }
+};
+
+// Limits the total estimated memory of the tiles being processed
+class Memory_budget {
+public:
+  explicit Memory_budget(double total): m_total(total), m_available(total) {}
+
+  // A tile larger than the whole budget waits until it runs alone
+  double acquire(double amount) {
+    amount = std::min(amount, m_total);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [&]() { return m_available >= amount; });
+    m_available -= amount;
+    return amount;
+  }
+
+  void release(double amount) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_available += amount;
+    }
+    m_cond.notify_all();
+  }
+
+private:
+  double m_total, m_available;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+};
+
+// Buffers the faces sent to each tile, appending them to the tile
+// file when a buffer gets full
+class Tile_spiller {
+public:
+  Tile_spiller(Context const& ctx, std::size_t buffer_size):
+    m_ctx(ctx), m_buffers(ctx.grid.num_tiles()), m_face_counts(ctx.grid.num_tiles(), 0),
+    m_buffer_size(buffer_size), m_ok(true) {}
+
+  void add(int tile, const std::uint32_t* indices, std::size_t n) {
+    std::vector<char> & buf = m_buffers[tile];
+    std::uint8_t degree = n;
+    buf.insert(buf.end(), (const char*)&degree, (const char*)&degree + 1);
+    buf.insert(buf.end(), (const char*)indices, (const char*)(indices + n));
+    m_face_counts[tile]++;
+    if (buf.size() >= m_buffer_size)
+      flush(tile);
+  }
+
+  void flush(int tile) {
+    std::vector<char> & buf = m_buffers[tile];
+    if (buf.empty())
+      return;
+    FILE* fp = fopen(m_ctx.tile_file(tile, "faces").c_str(), "ab");
+    if (fp == NULL || fwrite(&buf[0], 1, buf.size(), fp) != buf.size())
+      m_ok = false;
+    if (fp != NULL)
+      fclose(fp);
+    std::vector<char>().swap(buf);
+  }
+
+  bool finish() {
+    for (std::size_t tile = 0; tile < m_buffers.size(); tile++)
+      flush(tile);
+    return m_ok;
+  }
+
+  std::vector<std::size_t> const& face_counts() const { return m_face_counts; }
+
+private:
+  Context const& m_ctx;
+  std::vector<std::vector<char> > m_buffers;
+  std::vector<std::size_t> m_face_counts;
+  std::size_t m_buffer_size;
+  bool m_ok;
+};
+
+bool read_file(std::string const& file, std::vector<char> & data) {
+  data.clear();
+  FILE* fp = fopen(file.c_str(), "rb");
+  if (fp == NULL)
+    return true; // a tile with no faces has no file
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  data.resize(size);
+  bool ok = (size == 0 || fread(&data[0], 1, size, fp) == std::size_t(size));
+  fclose(fp);
+  return ok;
+}
+
+// What a tile contributes to the output. The owned vertices are listed
+// by input index, sorted, followed by the vertices created by the
+// tile. A face corner that is not negative is an input vertex index,
+// while corner -1-k is vertex k created by the tile.
+struct Tile_result {
+  std::vector<std::uint64_t>   owned_ids;
+  std::vector<double>          owned_points;
+  std::vector<double>          new_points;
+  std::vector<std::uint8_t>    face_sizes;
+  std::vector<std::int64_t>    face_corners;
+};
+
+bool write_tile_result(Context const& ctx, int tile, Tile_result const& result) {
+  FILE* fp = fopen(ctx.tile_file(tile, "ids").c_str(), "wb");
+  if (fp == NULL)
+    return false;
+  bool ok = result.owned_ids.empty() ||
+    fwrite(&result.owned_ids[0], sizeof(std::uint64_t), result.owned_ids.size(), fp)
+    == result.owned_ids.size();
+  fclose(fp);
+
+  fp = fopen(ctx.tile_file(tile, "out").c_str(), "wb");
+  if (fp == NULL)
+    return false;
+  std::uint64_t counts[4] = {result.owned_ids.size(), result.new_points.size() / 3,
+                             result.face_sizes.size(), result.face_corners.size()};
+  ok = ok && fwrite(counts, sizeof(counts), 1, fp) == 1;
+  if (!result.owned_points.empty())
+    ok = ok && fwrite(&result.owned_points[0], sizeof(double), result.owned_points.size(), fp)
+      == result.owned_points.size();
+  if (!result.new_points.empty())
+    ok = ok && fwrite(&result.new_points[0], sizeof(double), result.new_points.size(), fp)
+      == result.new_points.size();
+  if (!result.face_sizes.empty())
+    ok = ok && fwrite(&result.face_sizes[0], 1, result.face_sizes.size(), fp)
+      == result.face_sizes.size();
+  if (!result.face_corners.empty())
+    ok = ok && fwrite(&result.face_corners[0], sizeof(std::int64_t),
+                      result.face_corners.size(), fp) == result.face_corners.size();
+  fclose(fp);
+  return ok;
+}
+
+// Load the faces of a tile, run the operation on them, and write the
+// part of the result the tile owns
+bool process_tile(Context const& ctx, int tile) {
+
+  std::vector<char> data;
+  if (!read_file(ctx.tile_file(tile, "faces"), data))
+    return false;
+  unlink(ctx.tile_file(tile, "faces").c_str());
+
+  // Unpack the faces, and see which the tile owns
+  std::vector<std::size_t>   face_starts;
+  std::vector<std::uint32_t> corners;
+  std::vector<bool>          owned_face;
+  for (std::size_t pos = 0; pos < data.size(); ) {
+    std::uint8_t n = data[pos];
+    pos++;
+    face_starts.push_back(corners.size());
+    double centroid[3] = {0, 0, 0};
+    for (std::uint8_t c = 0; c < n; c++) {
+      std::uint32_t index;
+      std::memcpy(&index, &data[pos], sizeof(index));
+      pos += sizeof(index);
+      corners.push_back(index);
+      double p[3];
+      ctx.point(index, p);
+      for (int k = 0; k < 3; k++)
+        centroid[k] += p[k] / n;
+    }
+    owned_face.push_back(ctx.grid.tile_of(centroid) == tile);
+  }
+  face_starts.push_back(corners.size());
+  std::vector<char>().swap(data);
+  const std::size_t num_faces = owned_face.size();
+
+  // The tile owns the vertices lying in it. All faces around these
+  // were loaded.
+  std::vector<std::uint64_t> owned_ids;
+  {
+    std::unordered_set<std::uint32_t> seen;
+    for (std::uint32_t index : corners) {
+      double p[3];
+      if (!seen.insert(index).second)
+        continue;
+      ctx.point(index, p);
+      if (ctx.grid.tile_of(p) == tile)
+        owned_ids.push_back(index);
+    }
+  }
+  std::sort(owned_ids.begin(), owned_ids.end());
+
+  // Whether all faces around a vertex were loaded, which is the case
+  // when it is within the margin of the tile
+  auto star_complete = [&](std::uint32_t index) {
+    double p[3];
+    ctx.point(index, p);
+    return ctx.grid.overlaps(tile, p, p, ctx.margin);
+  };
+
+  // Simplification only works on the faces the tile owns, the other
+  // operations need the margin around them too
+  const bool simplify = (ctx.op.name == "simplify_mesh");
+  Mesh mesh;
+  std::unordered_map<std::uint32_t, Vertex_index> global_to_local;
+  std::vector<std::uint32_t> local_to_global;
+  std::vector<bool> local_is_loose; // vertex of a face that could not be added
+  std::vector<std::size_t> failed_faces;
+  std::vector<Vertex_index> face_vertices;
+  for (std::size_t f = 0; f < num_faces; f++) {
+    if (simplify && !owned_face[f])
+      continue;
+    face_vertices.clear();
+    for (std::size_t c = face_starts[f]; c < face_starts[f + 1]; c++) {
+      auto inserted = global_to_local.insert(std::make_pair(corners[c], Vertex_index()));
+      if (inserted.second) {
+        double p[3];
+        ctx.point(corners[c], p);
+        inserted.first->second = mesh.add_vertex(Point(p[0], p[1], p[2]));
+        local_to_global.push_back(corners[c]);
+        local_is_loose.push_back(false);
+      }
+      face_vertices.push_back(inserted.first->second);
+    }
+    if (mesh.add_face(face_vertices) == Mesh::null_face()) {
+      // Such faces are passed through, and their vertices kept fixed
+      failed_faces.push_back(f);
+      for (Vertex_index v : face_vertices)
+        local_is_loose[v] = true;
+    }
+  }
+  const std::size_t num_copied = local_to_global.size();
+
+  Tile_result result;
+  result.owned_ids = owned_ids;
+
+  auto add_input_face = [&](std::size_t f) {
+    result.face_sizes.push_back(face_starts[f + 1] - face_starts[f]);
+    for (std::size_t c = face_starts[f]; c < face_starts[f + 1]; c++)
+      result.face_corners.push_back(corners[c]);
+  };
+
+  if (ctx.op.name == "smoothe_mesh") {
+
+    // Keep fixed the vertices near the edge of the loaded region
+    Mesh::Property_map<Vertex_index, bool> constrained =
+      mesh.add_property_map<Vertex_index, bool>("v:constrained", false).first;
+    for (Vertex_index v : mesh.vertices()) {
+      constrained[v] = !star_complete(local_to_global[v]) || local_is_loose[v] ||
+        (!ctx.op.smoothe.smoothe_boundary && mesh.is_border(v));
+    }
+    cgal_tools::smoothe_mesh(mesh, ctx.op.smoothe, constrained);
+
+    for (std::size_t f = 0; f < num_faces; f++)
+      if (owned_face[f]) add_input_face(f);
+
+  } else if (ctx.op.name == "fill_holes") {
+
+    // A boundary cycle is a hole of the input only if all its vertices
+    // have their faces loaded. It is filled by the tile owning its
+    // vertex with the smallest index.
+    std::vector<Halfedge_index> cycles;
+    CGAL::Polygon_mesh_processing::extract_boundary_cycles(mesh, std::back_inserter(cycles));
+    for (Halfedge_index h : cycles) {
+      bool complete = true;
+      std::uint32_t min_index = std::numeric_limits<std::uint32_t>::max();
+      for (Halfedge_index hc : CGAL::halfedges_around_face(h, mesh)) {
+        Vertex_index v = mesh.target(hc);
+        if (std::size_t(v) >= num_copied || local_is_loose[v] ||
+            !star_complete(local_to_global[v])) {
+          complete = false;
+          break;
+        }
+        min_index = std::min(min_index, local_to_global[v]);
+      }
+      if (!complete || !std::binary_search(owned_ids.begin(), owned_ids.end(), min_index))
+        continue;
+      if (!cgal_tools::is_small_hole(h, mesh, ctx.op.fill.max_hole_diam,
+                                     ctx.op.fill.max_num_hole_edges))
+        continue;
+
+      std::vector<Face_index>   patch_facets;
+      std::vector<Vertex_index> patch_vertices;
+      cgal_tools::fill_hole(mesh, h, std::back_inserter(patch_facets),
+                            std::back_inserter(patch_vertices),
+                            cgal_tools::hole_tier(h, mesh, ctx.op.fill));
+      for (Face_index f : patch_facets) {
+        result.face_sizes.push_back(mesh.degree(f));
+        for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh)) {
+          if (std::size_t(v) < num_copied)
+            result.face_corners.push_back(local_to_global[v]);
+          else
+            result.face_corners.push_back(-1 - std::int64_t(std::size_t(v) - num_copied));
+        }
+      }
+    }
+
+    // The new vertices were appended, as nothing was removed
+    for (std::size_t it = num_copied; it < mesh.num_vertices(); it++) {
+      Point const& p = mesh.point(Vertex_index(it));
+      for (int c = 0; c < 3; c++)
+        result.new_points.push_back(p[c]);
+    }
+
+    for (std::size_t f = 0; f < num_faces; f++)
+      if (owned_face[f]) add_input_face(f);
+
+  } else if (simplify) {
+
+    // Only vertices this tile alone uses can move or go away. The
+    // others are on the boundary of the owned faces, belong to another
+    // tile, or are on faces that could not be added.
+    std::vector<bool> locked(num_copied, false);
+    for (Vertex_index v : mesh.vertices()) {
+      double p[3];
+      ctx.point(local_to_global[v], p);
+      locked[v] = local_is_loose[v] || mesh.is_isolated(v) || mesh.is_border(v) ||
+        ctx.grid.tile_of(p) != tile;
+    }
+    Mesh::Property_map<Edge_index, bool> constrained =
+      mesh.add_property_map<Edge_index, bool>("e:constrained", false).first;
+    for (Edge_index e : mesh.edges()) {
+      constrained[e] = locked[mesh.vertex(e, 0)] || locked[mesh.vertex(e, 1)];
+    }
+    if (CGAL::is_triangle_mesh(mesh))
+      cgal_tools::simplify_mesh(mesh, ctx.op.simplify, constrained);
+
+    for (Face_index f : mesh.faces()) {
+      result.face_sizes.push_back(mesh.degree(f));
+      for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh))
+        result.face_corners.push_back(local_to_global[v]);
+    }
+    for (std::size_t f : failed_faces)
+      add_input_face(f);
+
+    // Drop the owned vertices that got collapsed away
+    std::vector<std::uint64_t> kept_ids;
+    for (std::uint64_t index : owned_ids) {
+      auto it = global_to_local.find(index);
+      if (it == global_to_local.end() || !mesh.is_removed(it->second))
+        kept_ids.push_back(index);
+    }
+    result.owned_ids.swap(kept_ids);
+  }
+
+  // The owned vertices as they are now
+  for (std::uint64_t index : result.owned_ids) {
+    double p[3];
+    ctx.point(index, p);
+    auto it = global_to_local.find(index);
+    if (it != global_to_local.end()) {
+      Point const& q = mesh.point(it->second);
+      for (int c = 0; c < 3; c++)
+        p[c] = q[c];
+    }
+    result.owned_points.insert(result.owned_points.end(), p, p + 3);
+  }
+
+  return write_tile_result(ctx, tile, result);
+}
+
+// Write the output PLY from the tile results
+bool assemble_output(Context const& ctx, std::string const& output_file) {
+
+  const int num_tiles = ctx.grid.num_tiles();
+  std::vector<std::uint64_t> num_owned(num_tiles, 0), num_new(num_tiles, 0);
+  std::vector<std::uint64_t> num_out_faces(num_tiles, 0), num_corners(num_tiles, 0);
+  std::vector<std::uint64_t> base(num_tiles + 1, 0);
+  std::uint64_t total_faces = 0;
+  for (int tile = 0; tile < num_tiles; tile++) {
+    FILE* fp = fopen(ctx.tile_file(tile, "out").c_str(), "rb");
+    if (fp != NULL) {
+      std::uint64_t counts[4];
+      bool ok = (fread(counts, sizeof(counts), 1, fp) == 1);
+      fclose(fp);
+      if (!ok)
+        return false;
+      num_owned[tile]     = counts[0];
+      num_new[tile]       = counts[1];
+      num_out_faces[tile] = counts[2];
+      num_corners[tile]   = counts[3];
+    }
+    base[tile + 1] = base[tile] + num_owned[tile] + num_new[tile];
+    total_faces += num_out_faces[tile];
+  }
+
+  cgal_tools::Ply_binary_writer writer(output_file);
+  if (!writer.is_open())
+    return false;
+  writer.write_header(base[num_tiles], total_faces, "double");
+
+  std::vector<char> data;
+  for (int tile = 0; tile < num_tiles; tile++) {
+    if (num_owned[tile] + num_new[tile] == 0)
+      continue;
+    if (!read_file(ctx.tile_file(tile, "out"), data))
+      return false;
+    writer.write_bytes(&data[4 * sizeof(std::uint64_t)],
+                       3 * sizeof(double) * (num_owned[tile] + num_new[tile]));
+  }
+
+  // The sorted owned vertex indices of the tiles around the current
+  // one, to find where in the output a vertex of the input went
+  std::map<int, std::vector<std::uint64_t> > owned_ids;
+  for (int tile = 0; tile < num_tiles; tile++) {
+    if (num_out_faces[tile] == 0)
+      continue;
+    if (!read_file(ctx.tile_file(tile, "out"), data))
+      return false;
+    std::size_t pos = 4 * sizeof(std::uint64_t) +
+      3 * sizeof(double) * (num_owned[tile] + num_new[tile]);
+    const std::uint8_t* sizes = (const std::uint8_t*)&data[pos];
+    pos += num_out_faces[tile];
+
+    std::vector<int> used_tiles;
+    std::size_t corner = 0;
+    for (std::uint64_t f = 0; f < num_out_faces[tile]; f++) {
+      writer.put<std::uint8_t>(sizes[f]);
+      for (std::uint8_t c = 0; c < sizes[f]; c++, corner++) {
+        std::int64_t ref;
+        std::memcpy(&ref, &data[pos + corner * sizeof(ref)], sizeof(ref));
+        if (ref < 0) {
+          writer.put<std::int32_t>(base[tile] + num_owned[tile] + (-1 - ref));
+          continue;
+        }
+
+        double p[3];
+        ctx.point(ref, p);
+        int owner = ctx.grid.tile_of(p);
+        auto it = owned_ids.find(owner);
+        if (it == owned_ids.end()) {
+          std::vector<char> id_data;
+          if (!read_file(ctx.tile_file(owner, "ids"), id_data))
+            return false;
+          std::vector<std::uint64_t> ids(id_data.size() / sizeof(std::uint64_t));
+          if (!ids.empty())
+            std::memcpy(&ids[0], &id_data[0], id_data.size());
+          it = owned_ids.insert(std::make_pair(owner, ids)).first;
+        }
+        used_tiles.push_back(owner);
+
+        std::vector<std::uint64_t> const& ids = it->second;
+        auto found = std::lower_bound(ids.begin(), ids.end(), std::uint64_t(ref));
+        if (found == ids.end() || *found != std::uint64_t(ref)) {
+          std::cerr << "Tile " << tile << " uses vertex " << ref
+                    << " which tile " << owner << " did not keep." << std::endl;
+          return false;
+        }
+        writer.put<std::int32_t>(base[owner] + (found - ids.begin()));
+      }
+    }
+
+    // Keep in memory only the tiles the next one will likely need
+    std::sort(used_tiles.begin(), used_tiles.end());
+    for (auto it = owned_ids.begin(); it != owned_ids.end(); ) {
+      if (!std::binary_search(used_tiles.begin(), used_tiles.end(), it->first))
+        it = owned_ids.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  return writer.close();
+}
+
+void remove_temp_dir(Context const& ctx) {
+  const char* exts[3] = {"faces", "ids", "out"};
+  for (int tile = 0; tile < ctx.grid.num_tiles(); tile++)
+    for (int e = 0; e < 3; e++)
+      unlink(ctx.tile_file(tile, exts[e]).c_str());
+  rmdir(ctx.temp_dir.c_str());
+}
+
+// Parse the operation and its parameters starting at argv[pos]
+bool parse_operation(int argc, char** argv, int pos, Operation & op) {
+  if (pos >= argc)
+    return false;
+  op.name = argv[pos];
+  char** p = argv + pos + 1;
+  int num_params = argc - pos - 1;
+  if (op.name == "smoothe_mesh" && num_params == 3) {
+    op.smoothe.num_iterations   = atoi(p[0]);
+    op.smoothe.smoothing_time   = atof(p[1]);
+    op.smoothe.smoothe_boundary = atoi(p[2]);
+    return true;
+  }
+  if (op.name == "fill_holes" && num_params == 2) {
+    op.fill.max_hole_diam      = atof(p[0]);
+    op.fill.max_num_hole_edges = atoi(p[1]);
+    return true;
+  }
+  if (op.name == "simplify_mesh" && num_params == 1) {
+    op.simplify.edge_keep_ratio = atof(p[0]);
+    return true;
+  }
+  return false;
+}
+
+int main(int argc, char* argv[]) {
+
+  double tile_size = 0, margin = -1, memory_budget_mb = 4096;
+  int num_threads = 0;
+  std::string temp_dir;
+  cgal_tools::extract_option(argc, argv, "tile_size", tile_size);
+  cgal_tools::extract_option(argc, argv, "margin", margin);
+  cgal_tools::extract_option(argc, argv, "memory_budget_mb", memory_budget_mb);
+  cgal_tools::extract_option(argc, argv, "num_threads", num_threads);
+  cgal_tools::extract_option(argc, argv, "temp_dir", temp_dir);
+
+  Context ctx;
+  if (argc < 4 || tile_size <= 0 || !cgal_tools::check_no_unknown_options(argc, argv) ||
+      !parse_operation(argc, argv, 3, ctx.op)) {
+    std::cout << "Usage: " << argv[0]
+              << " --tile_size S [--margin M] [--memory_budget_mb B] [--num_threads N]"
+              << " [--temp_dir DIR] input.ply output.ply operation [params]\n"
+              << "Operations, with the same parameters as the tools of the same name:\n"
+              << "  smoothe_mesh num_iterations smoothing_time smoothe_boundary\n"
+              << "  fill_holes max_hole_diameter max_num_hole_edges\n"
+              << "  simplify_mesh edge_keep_ratio\n"
+              << "The input must be binary little-endian PLY. The output is written so.\n"
+              << "For fill_holes, both limits must be positive, and the margin at least\n"
+              << "max_hole_diameter.\n";
+    return 1;
+  }
+
+  const char* input_file  = argv[1];
+  const char* output_file = argv[2];
+
+  // A hole is filled only by a tile that sees it whole, so its size must
+  // be bounded for the margin to hold it
+  if (ctx.op.name == "fill_holes" &&
+      (ctx.op.fill.max_hole_diam <= 0 || ctx.op.fill.max_num_hole_edges <= 0)) {
+    std::cerr << "When tiling, fill_holes needs a positive maximum hole diameter "
+              << "and number of edges." << std::endl;
+    return 1;
+  }
+  if (ctx.op.name == "fill_holes" && margin >= 0 && margin < ctx.op.fill.max_hole_diam) {
+    std::cerr << "The margin must be at least the maximum hole diameter." << std::endl;
+    return 1;
+  }
+
+  // Each hole must fit within the margin around the tile owning it
+  if (margin < 0) {
+    if (ctx.op.name == "fill_holes")
+      margin = 2.0 * ctx.op.fill.max_hole_diam;
+    else if (ctx.op.name == "smoothe_mesh")
+      margin = 0.1 * tile_size;
+    else
+      margin = 0.0;
+  }
+  // Simplification needs no context beyond the owned faces
+  if (ctx.op.name == "simplify_mesh")
+    margin = 0.0;
+  ctx.margin = margin;
+
+  std::cout << "Reading mesh:    " << input_file << "\n";
+  std::cout << "Operation:       " << ctx.op.name << "\n";
+  std::cout << "Tile size:       " << tile_size << "\n";
+  std::cout << "Margin:          " << margin << "\n";
+  std::cout << "Memory budget:   " << memory_budget_mb << " MB\n";
+
+  cgal_tools::Mapped_file mapped;
+  cgal_tools::Ply_header header;
+  if (!mapped.open(input_file) ||
+      !cgal_tools::parse_ply_header(mapped.data(), mapped.size(), header) ||
+      !ctx.vertices.init(mapped.data(), mapped.size(), header) ||
+      header.element_index("face") < 0) {
+    std::cerr << "Expecting a binary little-endian PLY file with vertices and faces. "
+              << "Use the --binary option of the other tools to make one." << std::endl;
+    return 1;
+  }
+  if (header.elements[header.element_index("vertex")].count >
+      std::size_t(std::numeric_limits<std::int32_t>::max())) {
+    std::cerr << "Too many vertices." << std::endl;
+    return 1;
+  }
+
+  // Vertices are looked up by index from here on
+  mapped.set_random_access();
+  double start = cgal_tools::wall_time();
+
+  // Lay the grid over the bounding box of the vertices
+  double lo[3] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                  std::numeric_limits<double>::max()};
+  double hi[3] = {-lo[0], -lo[1], -lo[2]};
+  for (std::size_t it = 0; it < ctx.vertices.size(); it++) {
+    double p[3];
+    ctx.point(it, p);
+    for (int c = 0; c < 3; c++) {
+      lo[c] = std::min(lo[c], p[c]);
+      hi[c] = std::max(hi[c], p[c]);
+    }
+  }
+  ctx.grid.tile_size = tile_size;
+  double total = 1;
+  for (int c = 0; c < 3; c++) {
+    double dim = std::max(1.0, std::ceil((hi[c] - lo[c]) / tile_size));
+    total *= dim;
+    if (!(total <= double(MAX_NUM_TILES))) {
+      std::cerr << "The tile size is too small for the extent of the mesh, which would "
+                << "need more than " << MAX_NUM_TILES << " tiles." << std::endl;
+      return 1;
+    }
+    ctx.grid.origin[c] = lo[c];
+    ctx.grid.dims[c] = int(dim);
+  }
+  const int num_tiles = ctx.grid.num_tiles();
+  std::cout << "Tiles:           " << ctx.grid.dims[0] << " x " << ctx.grid.dims[1]
+            << " x " << ctx.grid.dims[2] << "\n";
+
+  ctx.temp_dir = temp_dir.empty() ? std::string(output_file) + ".tiles" : temp_dir;
+  remove_temp_dir(ctx); // leftovers from an interrupted run
+  if (mkdir(ctx.temp_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    std::cerr << "Cannot create directory: " << ctx.temp_dir << std::endl;
+    return 1;
+  }
+
+  // Send each face to the tiles it overlaps. The buffers take a
+  // quarter of the budget at most.
+  double buffer_bytes = 0.25 * memory_budget_mb * 1024 * 1024 / num_tiles;
+  std::size_t buffer_size = std::max(4096.0, std::min(buffer_bytes, 16.0 * 1024 * 1024));
+  Tile_spiller spiller(ctx, buffer_size);
+  bool success = cgal_tools::walk_binary_ply
+    (mapped.data(), mapped.size(), header,
+     [](double, double, double) { return true; },
+     [&](const std::uint32_t* indices, std::size_t n) {
+       if (n < 3 || n > 255)
+         return false;
+       double flo[3], fhi[3];
+       for (std::size_t it = 0; it < n; it++) {
+         if (indices[it] >= ctx.vertices.size())
+           return false;
+         double p[3];
+         ctx.point(indices[it], p);
+         for (int c = 0; c < 3; c++) {
+           flo[c] = (it == 0) ? p[c] : std::min(flo[c], p[c]);
+           fhi[c] = (it == 0) ? p[c] : std::max(fhi[c], p[c]);
+         }
+       }
+       int c0[3], c1[3];
+       for (int c = 0; c < 3; c++) {
+         c0[c] = ctx.grid.cell(flo[c] - ctx.margin, c);
+         c1[c] = ctx.grid.cell(fhi[c] + ctx.margin, c);
+       }
+       int cells[3];
+       for (cells[2] = c0[2]; cells[2] <= c1[2]; cells[2]++)
+         for (cells[1] = c0[1]; cells[1] <= c1[1]; cells[1]++)
+           for (cells[0] = c0[0]; cells[0] <= c1[0]; cells[0]++)
+             spiller.add(ctx.grid.tile_id(cells), indices, n);
+       return true;
+     });
+  if (!success || !spiller.finish()) {
+    std::cerr << "Failed to sort the faces into tiles." << std::endl;
+    remove_temp_dir(ctx);
+    return 1;
+  }
+  std::cout << "Sorted faces into tiles in " << cgal_tools::wall_time() - start << " s\n";
+
+  // Process the tiles, largest first, so a big one does not hold up
+  // the end of the run
+  std::vector<int> order;
+  std::vector<std::size_t> const& face_counts = spiller.face_counts();
+  std::size_t max_faces = 0;
+  for (int tile = 0; tile < num_tiles; tile++) {
+    if (face_counts[tile] > 0) order.push_back(tile);
+    max_faces = std::max(max_faces, face_counts[tile]);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return face_counts[a] > face_counts[b];
+    });
+  std::cout << "Largest tile:    " << max_faces << " faces\n";
+
+  start = cgal_tools::wall_time();
+  Memory_budget budget(memory_budget_mb * 1024 * 1024);
+  std::vector<unsigned char> tile_ok(num_tiles, 1);
+  cgal_tools::parallel_for(0, order.size(), cgal_tools::resolve_num_threads(num_threads),
+                           [&](std::size_t it) {
+      int tile = order[it];
+      double amount = budget.acquire(BYTES_PER_TILE_FACE * face_counts[tile]);
+      try {
+        tile_ok[tile] = process_tile(ctx, tile);
+      } catch (std::exception const& e) {
+        std::cerr << "Tile " << tile << ": " << e.what() << std::endl;
+        tile_ok[tile] = 0;
+      }
+      budget.release(amount);
+    });
+  std::cout << "Processed " << order.size() << " tiles in "
+            << cgal_tools::wall_time() - start << " s\n";
+
+  for (int tile = 0; tile < num_tiles; tile++) {
+    if (!tile_ok[tile]) {
+      std::cerr << "Failed processing tile " << tile << "." << std::endl;
+      remove_temp_dir(ctx);
+      return 1;
+    }
+  }
+
+  std::cout << "Writing output mesh: " << output_file << std::endl;
+  success = assemble_output(ctx, output_file);
+  remove_temp_dir(ctx);
+  if (!success) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
+  }
+
+  std::cout << "Peak memory: " << cgal_tools::peak_rss_mb() << " MB\n";
+  return 0;
+}
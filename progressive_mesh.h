@@ -0,0 +1,311 @@
+// A progressive mesh: a coarse base mesh and a list of vertex splits,
+// each undoing one edge collapse of the simplification that produced
+// the base mesh. Applying the splits in order refines the mesh back to
+// the input, and undoing them coarsens it again, so any intermediate
+// resolution can be reached incrementally. Vertices and faces keep
+// their ids in the input mesh throughout. This has no CGAL dependency.
+//
+// The file is little-endian binary:
+//   char[8]  "CTPMESH1"
+//   u64      number of vertices and of faces of the input mesh
+//   u64      number of base vertices, then for each: u32 id, f64 x y z
+//   u64      number of base faces, then for each: u32 id, u32 v0 v1 v2
+//   u64      number of splits, then for each split, coarsest first:
+//     u32    removed vertex u, u32 kept vertex v
+//     f64    x y z of u, then of v before the collapse
+//     u8     number of faces the collapse removed, then for each:
+//            u32 id, u32 v0 v1 v2
+//     u32    number of faces that had u and got v instead, then their ids
+
+#ifndef CGAL_TOOLS_PROGRESSIVE_MESH_H
+#define CGAL_TOOLS_PROGRESSIVE_MESH_H
+
+#include "ply_io.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace cgal_tools {
+
+// The smallest sizes in bytes of a base vertex, a base face and a split
+// in the file
+const std::size_t PM_BASE_VERTEX_SIZE = 4 + 3 * 8;
+const std::size_t PM_BASE_FACE_SIZE   = 4 + 3 * 4;
+const std::size_t PM_SPLIT_SIZE       = 2 * 4 + 6 * 8 + 1 + 4;
+
+struct Vertex_split {
+  std::uint32_t u, v;
+  double pu[3], pv[3];
+  std::vector<std::uint32_t>                 removed_face_ids;
+  std::vector<std::array<std::uint32_t, 3> > removed_faces;
+  std::vector<std::uint32_t>                 rewritten_faces;
+};
+
+struct Progressive_mesh_base {
+  std::size_t num_vertices, num_faces;                    // of the input
+  std::vector<std::uint32_t>                 vertex_ids;
+  std::vector<std::array<double, 3> >        points;
+  std::vector<std::uint32_t>                 face_ids;
+  std::vector<std::array<std::uint32_t, 3> > faces;
+  Progressive_mesh_base(): num_vertices(0), num_faces(0) {}
+};
+
+// Write the base mesh and the splits. The splits are given in the
+// order of the collapses, and are written in reverse, coarsest first.
+inline bool write_progressive_mesh(std::string const& file, Progressive_mesh_base const& base,
+                                   std::vector<Vertex_split> const& collapses) {
+  if (!host_is_little_endian())
+    return false;
+  Ply_binary_writer out(file);
+  if (!out.is_open())
+    return false;
+
+  out.write_bytes("CTPMESH1", 8);
+  out.put<std::uint64_t>(base.num_vertices);
+  out.put<std::uint64_t>(base.num_faces);
+  out.put<std::uint64_t>(base.vertex_ids.size());
+  for (std::size_t it = 0; it < base.vertex_ids.size(); it++) {
+    out.put<std::uint32_t>(base.vertex_ids[it]);
+    for (int c = 0; c < 3; c++)
+      out.put<double>(base.points[it][c]);
+  }
+  out.put<std::uint64_t>(base.face_ids.size());
+  for (std::size_t it = 0; it < base.face_ids.size(); it++) {
+    out.put<std::uint32_t>(base.face_ids[it]);
+    for (int c = 0; c < 3; c++)
+      out.put<std::uint32_t>(base.faces[it][c]);
+  }
+
+  out.put<std::uint64_t>(collapses.size());
+  for (std::size_t k = collapses.size(); k-- > 0; ) {
+    Vertex_split const& s = collapses[k];
+    out.put<std::uint32_t>(s.u);
+    out.put<std::uint32_t>(s.v);
+    for (int c = 0; c < 3; c++) out.put<double>(s.pu[c]);
+    for (int c = 0; c < 3; c++) out.put<double>(s.pv[c]);
+    out.put<std::uint8_t>(s.removed_face_ids.size());
+    for (std::size_t it = 0; it < s.removed_face_ids.size(); it++) {
+      out.put<std::uint32_t>(s.removed_face_ids[it]);
+      for (int c = 0; c < 3; c++)
+        out.put<std::uint32_t>(s.removed_faces[it][c]);
+    }
+    out.put<std::uint32_t>(s.rewritten_faces.size());
+    for (std::uint32_t f : s.rewritten_faces)
+      out.put<std::uint32_t>(f);
+  }
+
+  return out.close();
+}
+
+// Rebuilds the mesh at any number of applied splits. Going from one
+// level to another costs time in proportion to the splits in between.
+class Progressive_mesh {
+public:
+  Progressive_mesh(): m_level(0), m_num_faces(0) {}
+
+  // Return false if the file cannot be read or is not a valid
+  // progressive mesh. Every count is checked against the bytes left
+  // before anything is allocated, and every id against the number of
+  // vertices or faces, so a damaged file cannot make it run out of
+  // memory or index out of bounds.
+  bool read(std::string const& file) {
+    Mapped_file mapped;
+    if (!mapped.open(file) || !host_is_little_endian())
+      return false;
+    const char* ptr = mapped.data();
+    const char* end = ptr + mapped.size();
+    bool ok = true;
+    auto get = [&](void* value, std::size_t size) {
+      if (std::size_t(end - ptr) < size) {
+        ok = false;
+        std::memset(value, 0, size);
+        return;
+      }
+      std::memcpy(value, ptr, size);
+      ptr += size;
+    };
+    auto get_u32 = [&]() { std::uint32_t value; get(&value, 4); return value; };
+    auto get_u64 = [&]() { std::uint64_t value; get(&value, 8); return value; };
+    // Whether count records of at least the given size fit in the rest
+    auto fits = [&](std::uint64_t count, std::size_t record_size) {
+      return ok && count <= std::size_t(end - ptr) / record_size;
+    };
+
+    char magic[8];
+    get(magic, 8);
+    if (!ok || std::memcmp(magic, "CTPMESH1", 8) != 0)
+      return false;
+
+    std::uint64_t num_vertices = get_u64(), num_faces = get_u64();
+
+    std::uint64_t num_base_vertices = get_u64();
+    if (!fits(num_base_vertices, PM_BASE_VERTEX_SIZE))
+      return false;
+    std::vector<std::uint32_t>          base_vertex_ids(num_base_vertices);
+    std::vector<std::array<double, 3> > base_points(num_base_vertices);
+    for (std::uint64_t it = 0; it < num_base_vertices; it++) {
+      base_vertex_ids[it] = get_u32();
+      get(&base_points[it][0], 3 * sizeof(double));
+    }
+    std::uint64_t num_base_faces = get_u64();
+    if (!fits(num_base_faces, PM_BASE_FACE_SIZE))
+      return false;
+    std::vector<std::uint32_t>                 base_face_ids(num_base_faces);
+    std::vector<std::array<std::uint32_t, 3> > base_faces(num_base_faces);
+    for (std::uint64_t it = 0; it < num_base_faces; it++) {
+      base_face_ids[it] = get_u32();
+      get(&base_faces[it][0], 3 * sizeof(std::uint32_t));
+    }
+
+    std::uint64_t num_splits = get_u64();
+    if (!fits(num_splits, PM_SPLIT_SIZE))
+      return false;
+    std::vector<Vertex_split> splits(num_splits);
+    std::uint64_t num_removed_faces = 0;
+    for (std::uint64_t k = 0; k < num_splits && ok; k++) {
+      Vertex_split & s = splits[k];
+      s.u = get_u32();
+      s.v = get_u32();
+      get(s.pu, sizeof(s.pu));
+      get(s.pv, sizeof(s.pv));
+      std::uint8_t num_removed = 0;
+      get(&num_removed, 1);
+      s.removed_face_ids.resize(num_removed);
+      s.removed_faces.resize(num_removed);
+      for (int it = 0; it < num_removed; it++) {
+        s.removed_face_ids[it] = get_u32();
+        get(&s.removed_faces[it][0], 3 * sizeof(std::uint32_t));
+      }
+      num_removed_faces += num_removed;
+      std::uint32_t num_rewritten = get_u32();
+      if (!fits(num_rewritten, 4))
+        return false;
+      s.rewritten_faces.resize(num_rewritten);
+      get(s.rewritten_faces.data(), 4 * std::size_t(num_rewritten));
+    }
+    if (!ok)
+      return false;
+
+    // Each vertex is in the base mesh or comes back with a split, and
+    // each face is in the base mesh or comes back with the split that
+    // removed it
+    if (num_vertices > num_base_vertices + num_splits ||
+        num_faces > num_base_faces + num_removed_faces)
+      return false;
+    auto valid_face = [&](std::array<std::uint32_t, 3> const& f) {
+      return f[0] < num_vertices && f[1] < num_vertices && f[2] < num_vertices;
+    };
+    for (std::uint32_t id : base_vertex_ids)
+      if (id >= num_vertices) return false;
+    for (std::uint64_t it = 0; it < num_base_faces; it++)
+      if (base_face_ids[it] >= num_faces || !valid_face(base_faces[it])) return false;
+    for (Vertex_split const& s : splits) {
+      if (s.u >= num_vertices || s.v >= num_vertices) return false;
+      for (std::size_t it = 0; it < s.removed_face_ids.size(); it++)
+        if (s.removed_face_ids[it] >= num_faces || !valid_face(s.removed_faces[it]))
+          return false;
+      for (std::uint32_t f : s.rewritten_faces)
+        if (f >= num_faces) return false;
+    }
+
+    m_points.assign(num_vertices, std::array<double, 3>{{0, 0, 0}});
+    m_faces.assign(num_faces, std::array<std::uint32_t, 3>{{0, 0, 0}});
+    m_vertex_alive.assign(num_vertices, 0);
+    m_face_alive.assign(num_faces, 0);
+    m_num_faces = 0;
+    for (std::uint64_t it = 0; it < num_base_vertices; it++) {
+      m_points[base_vertex_ids[it]] = base_points[it];
+      m_vertex_alive[base_vertex_ids[it]] = 1;
+    }
+    for (std::uint64_t it = 0; it < num_base_faces; it++) {
+      m_faces[base_face_ids[it]] = base_faces[it];
+      if (!m_face_alive[base_face_ids[it]]) m_num_faces++;
+      m_face_alive[base_face_ids[it]] = 1;
+    }
+    m_splits.swap(splits);
+    m_level = 0;
+    return true;
+  }
+
+  std::size_t num_splits() const { return m_splits.size(); }
+  std::size_t level() const { return m_level; }
+  std::size_t num_faces() const { return m_num_faces; }
+
+  // Apply or undo splits until the given number of them are applied
+  void set_level(std::size_t level) {
+    level = std::min(level, m_splits.size());
+    while (m_level < level)
+      apply(m_splits[m_level++]);
+    while (m_level > level)
+      undo(m_splits[--m_level]);
+  }
+
+  // The current mesh, with vertices numbered consecutively
+  void extract(std::vector<std::array<double, 3> > & points,
+               std::vector<std::array<std::uint32_t, 3> > & faces) const {
+    std::vector<std::uint32_t> index(m_points.size(), 0);
+    points.clear();
+    for (std::size_t it = 0; it < m_points.size(); it++) {
+      if (!m_vertex_alive[it]) continue;
+      index[it] = points.size();
+      points.push_back(m_points[it]);
+    }
+    faces.clear();
+    for (std::size_t it = 0; it < m_faces.size(); it++) {
+      if (!m_face_alive[it]) continue;
+      std::array<std::uint32_t, 3> const& f = m_faces[it];
+      faces.push_back({{index[f[0]], index[f[1]], index[f[2]]}});
+    }
+  }
+
+private:
+  void apply(Vertex_split & s) {
+    // Keep the position of v after the collapse, to undo the split
+    std::array<double, 3> kept = m_points[s.v];
+    std::memcpy(&m_points[s.u][0], s.pu, sizeof(s.pu));
+    std::memcpy(&m_points[s.v][0], s.pv, sizeof(s.pv));
+    std::memcpy(s.pv, &kept[0], sizeof(s.pv));
+    m_vertex_alive[s.u] = 1;
+    for (std::uint32_t f : s.rewritten_faces)
+      replace(m_faces[f], s.v, s.u);
+    for (std::size_t it = 0; it < s.removed_face_ids.size(); it++) {
+      m_faces[s.removed_face_ids[it]] = s.removed_faces[it];
+      m_face_alive[s.removed_face_ids[it]] = 1;
+      m_num_faces++;
+    }
+  }
+
+  void undo(Vertex_split & s) {
+    std::array<double, 3> before = m_points[s.v];
+    std::memcpy(&m_points[s.v][0], s.pv, sizeof(s.pv));
+    std::memcpy(s.pv, &before[0], sizeof(s.pv));
+    m_vertex_alive[s.u] = 0;
+    for (std::uint32_t f : s.rewritten_faces)
+      replace(m_faces[f], s.u, s.v);
+    for (std::uint32_t f : s.removed_face_ids) {
+      m_face_alive[f] = 0;
+      m_num_faces--;
+    }
+  }
+
+  static void replace(std::array<std::uint32_t, 3> & face, std::uint32_t from,
+                      std::uint32_t to) {
+    for (int c = 0; c < 3; c++)
+      if (face[c] == from)
+        face[c] = to;
+  }
+
+  std::vector<Vertex_split>                  m_splits;
+  std::vector<std::array<double, 3> >        m_points;
+  std::vector<std::array<std::uint32_t, 3> > m_faces;
+  std::vector<unsigned char>                 m_vertex_alive, m_face_alive;
+  std::size_t                                m_level, m_num_faces;
+};
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_PROGRESSIVE_MESH_H
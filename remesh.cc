@@ -1,22 +1,28 @@
 #include <CGAL/Simple_cartesian.h>
 #include <CGAL/Advancing_front_surface_reconstruction.h>
-#include <CGAL/Surface_mesh.h>
-#include <CGAL/IO/PLY_reader.h>
-#include <CGAL/IO/PLY_writer.h>
+#include <CGAL/IO/polygon_soup_io.h>
+
+#include "parallel_for.h"
+#include "ply_io.h"
+#include "polygon_soup.h"
+#include "tool_options.h"
+#include "tool_stats.h"
 
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
 
-// TODO(oalexan1): This code needs to be ported to CGAL 5.3 like the rest
-// of the files here. Also remove the Gflags dependency.
-
-namespace PMP = CGAL::Polygon_mesh_processing;
+// Reconstruct a surface from the vertices of a mesh or a point cloud
+// with the advancing front method
 
 typedef CGAL::Simple_cartesian<double> K;
 typedef K::Point_3  Point_3;
 typedef std::array<std::size_t, 3> Facet;
-typedef CGAL::Surface_mesh<K::Point_3> Mesh;
 
 struct Perimeter {
   double bound;
@@ -49,65 +55,261 @@ struct Perimeter {
   }
 };
 
-DEFINE_string(input_mesh, "",
-              "The input mesh file.");
-DEFINE_string(output_mesh, "",
-              "The output mesh file.");
-DEFINE_double(max_triangle_perimeter, 0.0,
-              "All created triangular faces must have perimeter no more than this.");
-DEFINE_double(radius_ratio_bound, 5.0,
-             "A larger value of this allows for more (but less pretty) triangles.");
+struct Remesh_params {
+  double max_triangle_perimeter;
+  double radius_ratio_bound;
+  double beta;
+  double chunk_size;  // zero means a single reconstruction
+  double overlap;
+  int    num_threads;
+  Remesh_params(): max_triangle_perimeter(0), radius_ratio_bound(5.0), beta(0.52),
+                   chunk_size(0), overlap(-1), num_threads(0) {}
+};
+
+// Read the points. Binary little-endian PLY files are memory-mapped,
+// and faces, if any, are ignored.
+bool read_points(std::string const& input_file, std::vector<Point_3> & points) {
+  {
+    cgal_tools::Mapped_file mapped;
+    cgal_tools::Ply_header header;
+    if (mapped.open(input_file) && parse_ply_header(mapped.data(), mapped.size(), header) &&
+        header.format == cgal_tools::Ply_header::BINARY_LITTLE_ENDIAN &&
+        cgal_tools::host_is_little_endian() && header.element_index("vertex") >= 0) {
+      points.clear();
+      points.reserve(header.elements[header.element_index("vertex")].count);
+      if (cgal_tools::walk_binary_ply
+          (mapped.data(), mapped.size(), header,
+           [&](double x, double y, double z) {
+             points.push_back(Point_3(x, y, z));
+             return true;
+           },
+           [&](const std::uint32_t*, std::size_t) { return true; }))
+        return !points.empty();
+    }
+  }
+
+  points.clear();
+  std::vector< std::vector<std::size_t> > polygons;
+  return CGAL::IO::read_polygon_soup(input_file, points, polygons) && !points.empty();
+}
+
+void reconstruct(std::vector<Point_3> const& points, Remesh_params const& params,
+                 std::vector<Facet> & faces) {
+  Perimeter perimeter(params.max_triangle_perimeter);
+  CGAL::advancing_front_surface_reconstruction(points.begin(),
+                                               points.end(),
+                                               std::back_inserter(faces),
+                                               perimeter,
+                                               params.radius_ratio_bound,
+                                               params.beta);
+}
+
+// The most chunks space is split into. Their point counts alone take 8
+// bytes each.
+const std::size_t MAX_NUM_CHUNKS = std::size_t(1) << 24;
+
+// Split space into cubic chunks of the given size, and reconstruct the
+// points of each chunk, together with those within the overlap
+// distance of it, on its own. Only the facets whose centroid is in the
+// chunk itself are kept, so neighbouring chunks agree near their shared
+// boundary as long as the overlap is larger than the triangles. Facets
+// found by more than one chunk are kept once. Chunks are handled in
+// parallel, and the result does not depend on the number of threads.
+// Return false, with no faces, if the chunk size is so small compared
+// with the extent of the points that there would be more than
+// MAX_NUM_CHUNKS chunks.
+bool reconstruct_in_chunks(std::vector<Point_3> const& points, Remesh_params const& params,
+                           std::vector<Facet> & faces) {
+
+  const double size = params.chunk_size, overlap = params.overlap;
+  double lo[3], hi[3];
+  for (int c = 0; c < 3; c++) {
+    lo[c] = std::numeric_limits<double>::max();
+    hi[c] = -lo[c];
+  }
+  for (Point_3 const& p : points) {
+    for (int c = 0; c < 3; c++) {
+      lo[c] = std::min(lo[c], p[c]);
+      hi[c] = std::max(hi[c], p[c]);
+    }
+  }
+
+  // Count in floating point first, as the count may not fit in size_t
+  std::size_t dims[3];
+  double total = 1;
+  for (int c = 0; c < 3; c++) {
+    double dim = std::floor(std::max(0.0, hi[c] - lo[c]) / size) + 1;
+    total *= dim;
+    if (!(total <= double(MAX_NUM_CHUNKS))) {
+      std::cerr << "The chunk size is too small for the extent of the points, which would "
+                << "need more than " << MAX_NUM_CHUNKS << " chunks." << std::endl;
+      faces.clear();
+      return false;
+    }
+    dims[c] = std::size_t(dim);
+  }
+  const std::size_t num_chunks = dims[0] * dims[1] * dims[2];
+
+  // The range of chunks along one axis whose extended box holds a value
+  auto chunk_range = [&](double value, int c, long & first, long & last) {
+    first = std::max(0L, long(std::floor((value - lo[c] - overlap) / size)));
+    last  = std::min(long(dims[c]) - 1, long(std::floor((value - lo[c] + overlap) / size)));
+  };
+  auto for_each_chunk = [&](Point_3 const& p, auto fn) {
+    long first[3], last[3];
+    for (int c = 0; c < 3; c++)
+      chunk_range(p[c], c, first[c], last[c]);
+    for (long i = first[0]; i <= last[0]; i++)
+      for (long j = first[1]; j <= last[1]; j++)
+        for (long k = first[2]; k <= last[2]; k++)
+          fn((std::size_t(k) * dims[1] + j) * dims[0] + i);
+  };
+
+  // The points of each chunk, in compressed sparse row form
+  std::vector<std::size_t> offsets(num_chunks + 1, 0);
+  for (Point_3 const& p : points)
+    for_each_chunk(p, [&](std::size_t chunk) { offsets[chunk + 1]++; });
+  for (std::size_t it = 0; it < num_chunks; it++)
+    offsets[it + 1] += offsets[it];
+  std::vector<std::uint32_t> chunk_points(offsets[num_chunks]);
+  {
+    std::vector<std::size_t> pos(offsets.begin(), offsets.end() - 1);
+    for (std::size_t it = 0; it < points.size(); it++)
+      for_each_chunk(points[it], [&](std::size_t chunk) { chunk_points[pos[chunk]++] = it; });
+  }
+
+  std::vector<std::size_t> nonempty;
+  for (std::size_t chunk = 0; chunk < num_chunks; chunk++)
+    if (offsets[chunk + 1] - offsets[chunk] >= 3)
+      nonempty.push_back(chunk);
+  std::cout << "Reconstructing " << nonempty.size() << " chunks." << std::endl;
+
+  std::vector<std::vector<Facet> > chunk_faces(nonempty.size());
+  cgal_tools::parallel_for(0, nonempty.size(), params.num_threads, [&](std::size_t it) {
+      std::size_t chunk = nonempty[it];
+      std::size_t cell[3] = {chunk % dims[0], (chunk / dims[0]) % dims[1],
+                             chunk / (dims[0] * dims[1])};
+      std::vector<Point_3> local;
+      local.reserve(offsets[chunk + 1] - offsets[chunk]);
+      for (std::size_t k = offsets[chunk]; k < offsets[chunk + 1]; k++)
+        local.push_back(points[chunk_points[k]]);
+
+      std::vector<Facet> local_faces;
+      reconstruct(local, params, local_faces);
+
+      for (Facet const& f : local_faces) {
+        bool inside = true;
+        for (int c = 0; c < 3; c++) {
+          double centroid = (local[f[0]][c] + local[f[1]][c] + local[f[2]][c]) / 3.0;
+          long index = long(std::floor((centroid - lo[c]) / size));
+          index = std::max(0L, std::min(long(dims[c]) - 1, index));
+          inside = inside && (std::size_t(index) == cell[c]);
+        }
+        if (inside) {
+          std::size_t base = offsets[chunk];
+          chunk_faces[it].push_back({{chunk_points[base + f[0]], chunk_points[base + f[1]],
+                                      chunk_points[base + f[2]]}});
+        }
+      }
+    });
+
+  cgal_tools::Flat_soup soup;
+  for (std::vector<Facet> const& facets : chunk_faces) {
+    for (Facet const& f : facets) {
+      soup.indices.insert(soup.indices.end(), f.begin(), f.end());
+      soup.offsets.push_back(soup.indices.size());
+    }
+  }
+  std::vector<std::vector<Facet> >().swap(chunk_faces);
+  std::size_t num_duplicates = cgal_tools::merge_duplicate_polygons(soup, params.num_threads);
+  std::cout << "Removed " << num_duplicates << " facets found by more than one chunk."
+            << std::endl;
+
+  faces.resize(soup.num_polygons());
+  for (std::size_t it = 0; it < faces.size(); it++)
+    for (int c = 0; c < 3; c++)
+      faces[it][c] = soup.indices[3 * it + c];
+  return true;
+}
 
 int main(int argc, char* argv[]) {
-  gflags::ParseCommandLineFlags(&argc, &argv, true);
 
-  // Sanity checks
-  if (FLAGS_input_mesh == "") {
-    std::cout << "The input mesh file is not specified.\n";
+  Remesh_params params;
+  cgal_tools::Tool_stats stats("remesh");
+  cgal_tools::extract_stats_options(argc, argv, stats);
+  bool binary_output = cgal_tools::extract_flag(argc, argv, "binary");
+  cgal_tools::extract_option(argc, argv, "chunk_size", params.chunk_size);
+  cgal_tools::extract_option(argc, argv, "overlap", params.overlap);
+  cgal_tools::extract_option(argc, argv, "num_threads", params.num_threads);
+
+  if (argc < 5 || !cgal_tools::check_no_unknown_options(argc, argv)) {
+    std::cout << "Usage: " << argv[0]
+              << " [--binary] [--chunk_size S [--overlap D] [--num_threads N]] "
+              << cgal_tools::stats_usage()
+              << " max_triangle_perimeter radius_ratio_bound input.ply output.ply\n"
+              << "All created triangular faces have perimeter no more than the given\n"
+              << "value. A larger radius ratio bound (such as 5) allows for more, but\n"
+              << "less pretty, triangles. With --chunk_size, space is split into cubes of\n"
+              << "this size, reconstructed in parallel, each with the points within the\n"
+              << "overlap distance of it (by default the maximum triangle perimeter).\n";
     return 1;
   }
-  if (FLAGS_output_mesh == "") {
-    std::cout << "The output mesh file is not specified.\n";
+
+  params.max_triangle_perimeter = atof(argv[1]);
+  params.radius_ratio_bound     = atof(argv[2]);
+  const char* input_file        = argv[3];
+  const char* output_file       = argv[4];
+
+  // Sanity checks
+  if (params.max_triangle_perimeter <= 0) {
+    std::cout << "The maximum triangle perimeter must be positive.\n";
     return 1;
   }
-  if (FLAGS_max_triangle_perimeter <= 0) {
-    std::cout << "The maximum triangle perimeter is not specified.\n";
+  if (params.radius_ratio_bound <= 0) {
+    std::cout << "The radius ratio bound must be positive.\n";
     return 1;
   }
-  if (FLAGS_radius_ratio_bound <= 0) {
-    std::cout << "The maximum number of edges of a hole to fill "
-      "should be set to a positive value.\n";
+  if (params.overlap < 0)
+    params.overlap = params.max_triangle_perimeter;
+  if (params.chunk_size > 0 && params.overlap >= params.chunk_size / 2) {
+    std::cout << "The overlap must be less than half the chunk size.\n";
     return 1;
   }
 
+  std::cout << "Reading: " << input_file << std::endl;
+  stats.start_phase("read");
   std::vector<Point_3> points;
-  std::vector< std::vector<std::size_t> > polygons;
-  std::vector<CGAL::Color> fcolors;
-  std::vector<CGAL::Color> vcolors;
-
-  std::cout << "Reading: " << FLAGS_input_mesh << std::endl;
-  std::ifstream in(FLAGS_input_mesh.c_str());
-  if (!in || !CGAL::read_PLY(in, points, polygons, fcolors, vcolors) || points.empty()) {
-    std::cerr << "Cannot open file: " << FLAGS_input_mesh << std::endl;
+  if (!read_points(input_file, points)) {
+    std::cerr << "Cannot open file: " << input_file << std::endl;
     return EXIT_FAILURE;
   }
-  std::cerr << "Read: " << points.size() << " points." << std::endl;
-
-  Perimeter perimeter(FLAGS_max_triangle_perimeter);
-  double beta = 0.52;
+  std::cout << "Read: " << points.size() << " points." << std::endl;
+  stats.set_count("points", points.size());
 
+  stats.start_phase("reconstruct");
   std::vector<Facet> faces;
-  CGAL::advancing_front_surface_reconstruction(points.begin(),
-                                               points.end(),
-                                               std::back_inserter(faces),
-                                               perimeter,
-                                               FLAGS_radius_ratio_bound,
-                                               beta);
+  if (params.chunk_size > 0) {
+    if (!reconstruct_in_chunks(points, params, faces)) {
+      stats.end_phase();
+      return 1;
+    }
+  } else {
+    reconstruct(points, params, faces);
+  }
+  stats.end_phase();
+  stats.set_count("faces", faces.size());
+  std::cout << "Created " << faces.size() << " faces in "
+            << stats.last_phase().wall_seconds << " seconds." << std::endl;
 
-  std::cout << "Writing: " << FLAGS_output_mesh << std::endl;
-  std::ofstream out(FLAGS_output_mesh.c_str());
-  out.precision(17);
-  write_PLY(out, points, faces);
+  std::cout << "Writing: " << output_file << std::endl;
+  stats.start_phase("write");
+  if (!CGAL::IO::write_polygon_soup(output_file, points, faces,
+                                    CGAL::parameters::stream_precision(17)
+                                    .use_binary_mode(binary_output))) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
+  }
 
+  stats.emit();
   return 0;
 }
@@ -1,108 +1,189 @@
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Surface_mesh.h>
+#include <CGAL/IO/polygon_soup_io.h>
 #include <CGAL/Polygon_mesh_processing/repair_polygon_soup.h>
 #include <CGAL/Polygon_mesh_processing/orient_polygon_soup.h>
 #include <CGAL/Polygon_mesh_processing/polygon_soup_to_polygon_mesh.h>
-#include <CGAL/IO/PLY_reader.h>
-#include <CGAL/IO/PLY_writer.h>
 
-#include <algorithm>
+#include "compressed_mesh.h"
+#include "mesh_io.h"
+#include "ply_ascii.h"
+#include "polygon_soup.h"
+#include "tool_options.h"
+#include "tool_stats.h"
+
 #include <array>
 #include <iostream>
+#include <string>
 #include <vector>
-#include <fstream>
-
-#include <gflags/gflags.h>
 
-// A little example to repair a polygon mesh
-
-DEFINE_string(input_mesh, "",
-              "The input mesh file.");
-DEFINE_string(output_mesh, "",
-              "The output mesh file.");
+// Repair a polygon soup, such as a mesh with duplicate vertices or
+// faces, orient it consistently, and turn it into a mesh
 
 typedef CGAL::Exact_predicates_inexact_constructions_kernel     K;
-typedef CGAL::Simple_cartesian<double>                          Kernel;
-typedef K::FT                                                   FT;
 typedef K::Point_3                                              Point_3;
 typedef CGAL::Surface_mesh<Point_3>                             Mesh;
-typedef std::array<FT, 3>                                       Custom_point;
-typedef std::vector<std::size_t>                                CGAL_Polygon;
 namespace PMP = CGAL::Polygon_mesh_processing;
-struct Array_traits {
-  struct Equal_3
-  {
-    bool operator()(const Custom_point& p, const Custom_point& q) const {
-      return (p == q);
-    }
-  };
-  struct Less_xyz_3
-  {
-    bool operator()(const Custom_point& p, const Custom_point& q) const {
-      return std::lexicographical_compare(p.begin(), p.end(), q.begin(), q.end());
-    }
-  };
-  Equal_3 equal_3_object() const { return Equal_3(); }
-  Less_xyz_3 less_xyz_3_object() const { return Less_xyz_3(); }
-};
-
-int main(int argc, char* argv[]) {
 
-  gflags::ParseCommandLineFlags(&argc, &argv, true);
+// Orient the repaired soup and turn it into a mesh
+template <class Polygon>
+void orient_and_convert(std::vector<Point_3> & points, std::vector<Polygon> & polygons,
+                        Mesh & mesh, cgal_tools::Tool_stats & stats) {
+  stats.start_phase("orient");
+  if (!PMP::orient_polygon_soup(points, polygons))
+    std::cout << "Some points were duplicated to make the soup orientable." << std::endl;
+
+  stats.start_phase("to_mesh");
+  PMP::polygon_soup_to_polygon_mesh(points, polygons, mesh);
+  stats.end_phase();
+}
 
-  // Sanity checks
-  if (FLAGS_input_mesh == "") {
-    std::cout << "The input mesh file is not specified.\n";
-    return 1;
+// Read the soup into flat arrays, repair it there on several threads,
+// and convert the result directly to the containers CGAL orients.
+bool fast_repair(std::string const& input_file, int num_threads, Mesh & mesh,
+                 cgal_tools::Tool_stats & stats) {
+
+  stats.start_phase("read");
+  cgal_tools::Flat_soup soup;
+  if (!cgal_tools::read_compressed_mesh_soup(input_file, num_threads, soup) &&
+      !cgal_tools::read_binary_ply_soup(input_file, soup) &&
+      !cgal_tools::read_ascii_ply_soup(input_file, num_threads, soup)) {
+    // Other formats are read by CGAL first
+    std::vector<Point_3> points;
+    std::vector<std::vector<std::size_t> > polygons;
+    if (!CGAL::IO::read_polygon_soup(input_file, points, polygons) || points.empty())
+      return false;
+    soup = cgal_tools::Flat_soup();
+    soup.coords.reserve(3 * points.size());
+    for (Point_3 const& p : points) {
+      soup.coords.push_back(p.x());
+      soup.coords.push_back(p.y());
+      soup.coords.push_back(p.z());
+    }
+    for (std::vector<std::size_t> const& polygon : polygons) {
+      soup.indices.insert(soup.indices.end(), polygon.begin(), polygon.end());
+      soup.offsets.push_back(soup.indices.size());
+    }
   }
-  if (FLAGS_output_mesh == "") {
-    std::cout << "The output mesh file is not specified.\n";
-    return 1;
+  stats.set_count("input_points", soup.num_points());
+  stats.set_count("input_polygons", soup.num_polygons());
+
+  stats.start_phase("repair");
+  cgal_tools::Soup_repair_stats repair = cgal_tools::repair_flat_soup(soup, num_threads);
+  stats.set_count("points_merged", repair.points_merged);
+  stats.set_count("degenerate_polygons", repair.degenerate_polygons);
+  stats.set_count("duplicate_polygons", repair.duplicate_polygons);
+  stats.set_count("isolated_points", repair.isolated_points);
+  std::cout << "Merged " << repair.points_merged << " duplicate points, removed "
+            << repair.degenerate_polygons << " degenerate and " << repair.duplicate_polygons
+            << " duplicate polygons, and " << repair.isolated_points
+            << " isolated points." << std::endl;
+  std::cout << "After reparation, the soup has " << soup.num_points() << " vertices and "
+            << soup.num_polygons() << " faces" << std::endl;
+
+  std::vector<Point_3> points(soup.num_points());
+  cgal_tools::parallel_for(0, points.size(), num_threads, [&](std::size_t it) {
+      points[it] = Point_3(soup.coords[3 * it], soup.coords[3 * it + 1],
+                           soup.coords[3 * it + 2]);
+    }, 1 << 16);
+  std::vector<double>().swap(soup.coords);
+
+  if (soup.all_triangles()) {
+    std::vector<std::array<std::size_t, 3> > triangles(soup.num_polygons());
+    cgal_tools::parallel_for(0, triangles.size(), num_threads, [&](std::size_t it) {
+        for (int c = 0; c < 3; c++)
+          triangles[it][c] = soup.indices[3 * it + c];
+      }, 1 << 16);
+    soup = cgal_tools::Flat_soup();
+    orient_and_convert(points, triangles, mesh, stats);
+  } else {
+    std::vector<std::vector<std::size_t> > polygons(soup.num_polygons());
+    for (std::size_t it = 0; it < polygons.size(); it++)
+      polygons[it].assign(soup.indices.begin() + soup.offsets[it],
+                          soup.indices.begin() + soup.offsets[it + 1]);
+    soup = cgal_tools::Flat_soup();
+    orient_and_convert(points, polygons, mesh, stats);
   }
 
-  std::cout << "Reading: " << FLAGS_input_mesh << std::endl;
-  std::ifstream in(FLAGS_input_mesh);
-
-  std::vector<Kernel::Point_3> points;
-  std::vector< std::vector<std::size_t> > polygons;
+  return true;
+}
 
-  std::vector<CGAL::Color> fcolors;
-  std::vector<CGAL::Color> vcolors;
-  if (!in || !CGAL::read_PLY(in, points, polygons, fcolors, vcolors) || points.empty()) {
-    std::cerr << "Cannot open file: " << FLAGS_input_mesh << std::endl;
-    return EXIT_FAILURE;
+// Repair with CGAL alone
+bool cgal_repair(std::string const& input_file, Mesh & mesh, cgal_tools::Tool_stats & stats) {
+
+  stats.start_phase("read");
+  std::vector<Point_3> points;
+  std::vector<std::vector<std::size_t> > polygons;
+  cgal_tools::Flat_soup soup;
+  if (cgal_tools::read_compressed_mesh_soup(input_file, 0, soup)) {
+    for (std::size_t it = 0; it < soup.num_points(); it++)
+      points.push_back(Point_3(soup.coords[3 * it], soup.coords[3 * it + 1],
+                               soup.coords[3 * it + 2]));
+    for (std::size_t it = 0; it < soup.num_polygons(); it++)
+      polygons.push_back(std::vector<std::size_t>(soup.indices.begin() + soup.offsets[it],
+                                                  soup.indices.begin() + soup.offsets[it + 1]));
+  } else if (!CGAL::IO::read_polygon_soup(input_file, points, polygons)) {
+    return false;
   }
+  if (points.empty())
+    return false;
+  stats.set_count("input_points", points.size());
+  stats.set_count("input_polygons", polygons.size());
+
+  stats.start_phase("repair");
+  PMP::repair_polygon_soup(points, polygons);
+  std::cout << "After reparation, the soup has " << points.size() << " vertices and "
+            << polygons.size() << " faces" << std::endl;
+
+  orient_and_convert(points, polygons, mesh, stats);
+  return true;
+}
 
-  std::vector<CGAL_Polygon> polygons2;
-  for (size_t it = 0; it < polygons.size(); it++) {
-    CGAL_Polygon p;
-    for (size_t it2 = 0; it2 < polygons[it].size(); it2++) {
-      p.push_back(polygons[it][it2]);
-    }
-    polygons2.push_back(p);
-  }
+int main(int argc, char* argv[]) {
 
-  std::vector<std::array<FT, 3> > points2;
-  for (size_t it = 0; it < points.size(); it++) {
-    Kernel::Point_3 point = points[it];
-    points2.push_back(CGAL::make_array<FT>(point[0], point[1], point[2]));
+  cgal_tools::Tool_stats stats("repair_mesh");
+  cgal_tools::extract_stats_options(argc, argv, stats);
+  bool binary_output = cgal_tools::extract_flag(argc, argv, "binary");
+  bool fast = cgal_tools::extract_flag(argc, argv, "fast");
+  int num_threads = 0;
+  cgal_tools::extract_option(argc, argv, "num_threads", num_threads);
+  int quantization_bits = 16;
+  cgal_tools::extract_option(argc, argv, "quantization_bits", quantization_bits);
+
+  if (argc < 3 || !cgal_tools::check_no_unknown_options(argc, argv)) {
+    std::cout << "Usage: " << argv[0] << " [--binary] [--quantization_bits B]"
+              << " [--fast [--num_threads N]] "
+              << cgal_tools::stats_usage() << " input.ply output.ply\n"
+              << "With --fast, duplicate points and polygons are found by hashing on\n"
+              << "several threads, which is much faster for large soups, but only\n"
+              << "duplicates, degenerate polygons and isolated points are repaired.\n"
+              << "Output files named .cmesh are written in a compressed format, with\n"
+              << "coordinates quantized to --quantization_bits (default 16, 0 for exact).\n";
+    return 1;
   }
-  
 
-  PMP::repair_polygon_soup(points2, polygons2, CGAL::parameters::geom_traits(Array_traits()));
-  
-  std::cout << "After reparation, the soup has " << points2.size() << " vertices and " << polygons2.size() << " faces" << std::endl;
-  
+  const char* input_file  = argv[1];
+  const char* output_file = argv[2];
+
+  std::cout << "Reading: " << input_file << std::endl;
   Mesh mesh;
-  PMP::orient_polygon_soup(points2, polygons2);
-  PMP::polygon_soup_to_polygon_mesh(points2, polygons2, mesh);
-  std::cout << "Mesh has " << num_vertices(mesh) << " vertices and " << num_faces(mesh) << " faces" << std::endl;
-
-  std::cout << "Writing: " << FLAGS_output_mesh << std::endl;
-  std::ofstream out(FLAGS_output_mesh);
-  out.precision(17);
-  CGAL::write_PLY(out, mesh);
-  
+  bool success = fast ? fast_repair(input_file, num_threads, mesh, stats) :
+    cgal_repair(input_file, mesh, stats);
+  if (!success) {
+    std::cerr << "Cannot open file: " << input_file << std::endl;
+    return 1;
+  }
+  std::cout << "Mesh has " << num_vertices(mesh) << " vertices and " << num_faces(mesh)
+            << " faces" << std::endl;
+  stats.set_count("output_faces", mesh.number_of_faces());
+
+  std::cout << "Writing: " << output_file << std::endl;
+  stats.start_phase("write");
+  if (!cgal_tools::write_mesh(output_file, mesh, binary_output, quantization_bits)) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
+  }
+
+  stats.emit();
   return 0;
 }
-
@@ -0,0 +1,278 @@
+// An on-disk cache of tool results. A result is found by a key made
+// from the tool name, its parameters, and a hash of the bytes of the
+// input file, so re-running a tool on the same input with the same
+// arguments copies the stored output instead of doing the work, without
+// building a mesh. Entries are evicted least recently used first when
+// the cache grows past its size cap. This has no CGAL dependency.
+//
+// Each entry is two files in the cache directory: <key>.out, a copy of
+// the output, and <key>.meta, the seconds it took to make. Both are
+// written under a temporary name and renamed into place, and a hit
+// updates the modification time of the output, which is what eviction
+// goes by. Several processes can share the directory.
+//
+// The hash is not cryptographic. Inputs that are not crafted to
+// collide have a chance of about 2^-128 of sharing a key.
+
+#ifndef CGAL_TOOLS_RESULT_CACHE_H
+#define CGAL_TOOLS_RESULT_CACHE_H
+
+#include "compressed_mesh.h"
+#include "parallel_for.h"
+#include "ply_io.h"
+#include "tool_options.h"
+#include "tool_stats.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cgal_tools {
+
+struct Hash128 {
+  std::uint64_t lo, hi;
+  Hash128(): lo(0), hi(0) {}
+};
+
+inline std::uint64_t mix64(std::uint64_t z) {
+  // The splitmix64 finalizer
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+inline std::uint64_t rotl64(std::uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// Hash the bytes with two independent lanes of multiply and rotate
+inline Hash128 hash_bytes(const char* data, std::size_t size, std::uint64_t seed) {
+  std::uint64_t a = seed ^ 0x9e3779b97f4a7c15ull, b = seed ^ 0xc2b2ae3d27d4eb4full;
+  std::size_t it = 0;
+  for (; it + 8 <= size; it += 8) {
+    std::uint64_t w;
+    std::memcpy(&w, data + it, 8);
+    a = rotl64(a ^ (w * 0x87c37b91114253d5ull), 31) * 0x4cf5ad432745937full;
+    b = rotl64(b + (w * 0x52dce729da3ed7b5ull), 27) * 0x9e3779b97f4a7c15ull;
+  }
+  std::uint64_t tail = 0;
+  std::memcpy(&tail, data + it, size - it);
+  a = rotl64(a ^ (tail * 0x87c37b91114253d5ull), 31) * 0x4cf5ad432745937full;
+  b = rotl64(b + (tail * 0x52dce729da3ed7b5ull), 27) * 0x9e3779b97f4a7c15ull;
+
+  Hash128 h;
+  h.lo = mix64(a ^ size);
+  h.hi = mix64(b ^ h.lo);
+  return h;
+}
+
+// Hash large data in fixed blocks on several threads, then hash the
+// block hashes. The blocks do not depend on the number of threads, so
+// neither does the hash.
+inline Hash128 hash_bytes_parallel(const char* data, std::size_t size, int num_threads) {
+  const std::size_t block = 1 << 22;
+  const std::size_t num_blocks = (size + block - 1) / block;
+  std::vector<Hash128> hashes(num_blocks);
+  parallel_for(0, num_blocks, num_threads, [&](std::size_t it) {
+      std::size_t begin = it * block;
+      hashes[it] = hash_bytes(data + begin, std::min(block, size - begin), it);
+    });
+  return hash_bytes(reinterpret_cast<const char*>(hashes.data()),
+                    hashes.size() * sizeof(Hash128), size);
+}
+
+inline std::string to_hex(Hash128 const& h) {
+  char text[33];
+  snprintf(text, sizeof(text), "%016llx%016llx", (unsigned long long)h.hi,
+           (unsigned long long)h.lo);
+  return text;
+}
+
+class Result_cache {
+public:
+  // No directory means no caching
+  Result_cache(): m_max_mb(10240) {}
+
+  void set_directory(std::string const& dir) { m_dir = dir; }
+  void set_max_mb(double max_mb) { m_max_mb = max_mb; }
+  bool enabled() const { return !m_dir.empty(); }
+
+  // The key of a run of the tool with the given parameters, which must
+  // include all that affects the output, on the given input. The format
+  // of the output, which goes by the extension of the output file, is
+  // part of the key. Return an empty key if the input cannot be read.
+  std::string key(std::string const& tool, std::string const& params,
+                  std::string const& input_file, std::string const& output_file) const {
+    Mapped_file mapped;
+    if (!mapped.open(input_file))
+      return "";
+    Hash128 data = hash_bytes_parallel(mapped.data(), mapped.size(), 0);
+    const char* format = has_compressed_mesh_extension(output_file) ? "cmesh" : "ply";
+    std::string text = tool + '\n' + params + '\n' + format + '\n' + to_hex(data);
+    return tool + "_" + to_hex(hash_bytes(text.data(), text.size(), 0));
+  }
+
+  // If there is an entry, copy it to the output file, mark it as just
+  // used, and set the seconds it took to make
+  bool fetch(std::string const& key, std::string const& output_file, double & seconds) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path entry = path(key, ".out");
+    std::ifstream meta(path(key, ".meta").c_str());
+    if (!(meta >> seconds) || !fs::exists(entry, ec))
+      return false;
+    fs::copy_file(entry, output_file, fs::copy_options::overwrite_existing, ec);
+    if (ec)
+      return false;
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+    return true;
+  }
+
+  // Store a copy of the output file, made in the given number of
+  // seconds, then evict entries until the cache fits its cap
+  bool store(std::string const& key, std::string const& output_file, double seconds) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::create_directories(m_dir, ec);
+    std::ostringstream suffix;
+    suffix << ".tmp" << getpid() << "_" << std::this_thread::get_id();
+    fs::path out_tmp = path(key, ".out" + suffix.str());
+    fs::path meta_tmp = path(key, ".meta" + suffix.str());
+    fs::copy_file(output_file, out_tmp, fs::copy_options::overwrite_existing, ec);
+    if (!ec) {
+      std::ofstream meta(meta_tmp.c_str());
+      meta.precision(17);
+      meta << seconds << "\n";
+      meta.close();
+      if (!meta)
+        ec = std::make_error_code(std::errc::io_error);
+    }
+    // The output goes in place first, so that an entry with a .meta
+    // file is complete
+    if (!ec)
+      fs::rename(out_tmp, path(key, ".out"), ec);
+    if (!ec)
+      fs::rename(meta_tmp, path(key, ".meta"), ec);
+    if (ec) {
+      fs::remove(out_tmp, ec);
+      fs::remove(meta_tmp, ec);
+      return false;
+    }
+    evict();
+    return true;
+  }
+
+  // Remove the least recently used entries until the outputs take no
+  // more than the cap
+  void evict() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    std::vector<std::pair<fs::file_time_type, fs::path> > entries;
+    std::uintmax_t total = 0;
+    for (fs::directory_iterator it(m_dir, ec), end; !ec && it != end; it.increment(ec)) {
+      if (it->path().extension() != ".out")
+        continue;
+      std::uintmax_t size = fs::file_size(it->path(), ec);
+      fs::file_time_type time = fs::last_write_time(it->path(), ec);
+      if (ec) {
+        // Removed by another process meanwhile
+        ec.clear();
+        continue;
+      }
+      total += size;
+      entries.push_back(std::make_pair(time, it->path()));
+    }
+    const std::uintmax_t cap = std::uintmax_t(std::max(0.0, m_max_mb) * 1024 * 1024);
+    std::sort(entries.begin(), entries.end());
+    for (std::size_t it = 0; it < entries.size() && total > cap; it++) {
+      std::uintmax_t size = fs::file_size(entries[it].second, ec);
+      if (ec) {
+        ec.clear();
+        continue;
+      }
+      fs::path meta = entries[it].second;
+      meta.replace_extension(".meta");
+      fs::remove(meta, ec);
+      fs::remove(entries[it].second, ec);
+      total -= size;
+    }
+  }
+
+private:
+  std::filesystem::path path(std::string const& key, std::string const& extension) const {
+    return std::filesystem::path(m_dir) / (key + extension);
+  }
+
+  std::string m_dir;
+  double m_max_mb;
+};
+
+// Remove --cache_dir dir and --cache_max_mb N from the arguments
+inline void extract_cache_options(int & argc, char** argv, Result_cache & cache) {
+  std::string dir;
+  if (extract_option(argc, argv, "cache_dir", dir))
+    cache.set_directory(dir);
+  double max_mb = 0;
+  if (extract_option(argc, argv, "cache_max_mb", max_mb))
+    cache.set_max_mb(max_mb);
+}
+
+// Usage text for the above options
+inline const char* cache_usage() {
+  return "[--cache_dir dir [--cache_max_mb N]]";
+}
+
+// Run a tool through the cache. If the cache has the output of the tool
+// with these parameters on this input, copy it to the output file.
+// Otherwise call run, and if it succeeds store its output. The outcome
+// is counted in the stats. Return the exit code.
+inline int run_with_cache(Result_cache & cache, std::string const& tool,
+                          std::string const& params, std::string const& input_file,
+                          std::string const& output_file, Tool_stats & stats,
+                          std::function<int()> run) {
+  if (!cache.enabled())
+    return run();
+
+  double start = wall_time();
+  stats.start_phase("cache_lookup");
+  std::string key = cache.key(tool, params, input_file, output_file);
+  double seconds = 0;
+  if (!key.empty() && cache.fetch(key, output_file, seconds)) {
+    stats.end_phase();
+    double saved = std::max(0.0, seconds - (wall_time() - start));
+    std::cout << "Copied the cached result to " << output_file << ", saving about "
+              << saved << " s." << std::endl;
+    stats.set_count("cache_hits", 1);
+    stats.set_count("cache_misses", 0);
+    stats.set_count("cache_seconds_saved", saved);
+    stats.emit();
+    return 0;
+  }
+  stats.end_phase();
+  stats.set_count("cache_hits", 0);
+  stats.set_count("cache_misses", 1);
+  stats.set_count("cache_seconds_saved", 0);
+
+  start = wall_time();
+  int ret = run();
+  if (ret == 0 && !key.empty() && !cache.store(key, output_file, wall_time() - start))
+    std::cerr << "Could not store the result in the cache." << std::endl;
+  return ret;
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_RESULT_CACHE_H
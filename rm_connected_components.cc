@@ -19,149 +19,136 @@
 // This code uses CGAL that is licensed under the GPL. This implements
 // a standalone tool, not connect to the rest of Astrobee.
 
-#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
-#include <CGAL/Surface_mesh.h>
-#include <CGAL/Polygon_mesh_processing/connected_components.h>
-#include <boost/function_output_iterator.hpp>
-#include <boost/property_map/property_map.hpp>
-#include <CGAL/IO/PLY.h>
-#include <CGAL/Polygon_mesh_processing/IO/polygon_mesh_io.h>
+#include "cgal_tools.h"
+#include "mesh_io.h"
+#include "mesh_reorder.h"
+#include "mesh_types.h"
+#include "result_cache.h"
+#include "tool_options.h"
+#include "tool_stats.h"
 
 #include <iostream>
 #include <fstream>
-#include <map>
-
-typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel;
-typedef Kernel::Point_3                                     Point;
-typedef Kernel::Compare_dihedral_angle_3                    Compare_dihedral_angle_3;
-typedef CGAL::Surface_mesh<Point>                           Mesh;
-
-namespace PMP = CGAL::Polygon_mesh_processing;
-
-template <typename G>
-struct Constraint : public boost::put_get_helper<bool,Constraint<G> > {
-  typedef typename boost::graph_traits<G>::edge_descriptor edge_descriptor;
-  typedef boost::readable_property_map_tag      category;
-  typedef bool                                  value_type;
-  typedef bool                                  reference;
-  typedef edge_descriptor                       key_type;
-  Constraint()
-    :g_(NULL)
-  {}
-  Constraint(G& g, double bound)
-    : g_(&g), bound_(bound)
-  {}
-  bool operator[](edge_descriptor e) const
-  {
-    const G& g = *g_;
-    return compare_(g.point(source(e, g)),
-                    g.point(target(e, g)),
-                    g.point(target(next(halfedge(e, g), g), g)),
-                    g.point(target(next(opposite(halfedge(e, g), g), g), g)),
-                   bound_) == CGAL::SMALLER;
+#include <sstream>
+
+typedef cgal_tools::Double_mesh Mesh;
+
+// Read, process and write the mesh, stored with the points of Mesh
+template <class Mesh>
+int process_mesh(cgal_tools::Rm_connected_components_params const& params,
+                 const char* input_file, const char* output_file, bool binary_output,
+                 int quantization_bits, bool reorder, bool keep_reorder,
+                 cgal_tools::Tool_stats & stats) {
+
+  stats.start_phase("read");
+  Mesh mesh;
+  if(!cgal_tools::read_mesh(input_file, mesh)) {
+    std::cerr << "Invalid input." << std::endl;
+    return 1;
+  }
+
+  if (reorder) {
+    stats.start_phase("reorder");
+    if (!cgal_tools::hilbert_reorder_mesh(mesh, !keep_reorder))
+      std::cout << "Could not reorder the mesh, keeping its order.\n";
+  }
+
+  std::size_t num_input_faces = mesh.number_of_faces();
+  stats.set_count("input_faces", num_input_faces);
+  stats.start_phase("rm_connected_components");
+  std::size_t num_kept = 0;
+  std::size_t num = cgal_tools::rm_connected_components(mesh, params, &num_kept);
+  stats.end_phase();
+  std::cout << "The mesh has " << num << " connected components.\n";
+
+  // Without this the mesh will be invalid
+  stats.start_phase("collect_garbage");
+  mesh.collect_garbage();
+  stats.end_phase();
+
+  stats.set_count("components", num);
+  stats.set_count("components_removed", num - num_kept);
+  stats.set_count("faces_removed", num_input_faces - mesh.number_of_faces());
+  stats.set_count("output_faces", mesh.number_of_faces());
+
+  if (reorder && !keep_reorder) {
+    stats.start_phase("restore_order");
+    if (!cgal_tools::restore_mesh_order(mesh))
+      std::cout << "Could not restore the input order, writing the spatial order.\n";
   }
-  const G* g_;
-  Compare_dihedral_angle_3 compare_;
-  double bound_;
-};
-template <typename PM>
-struct Put_true {
-  Put_true(const PM pm)
-    :pm(pm)
-  {}
-  template <typename T>
-  void operator()(const T& t)
-  {
-    put(pm, t, true);
+
+  std::cout << "Writing output mesh: " << output_file << std::endl;
+  stats.start_phase("write");
+  if (!cgal_tools::write_mesh(output_file, mesh, binary_output, quantization_bits)) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
   }
-  PM pm;
-};
+  stats.end_phase();
+  std::cout << "Peak memory: " << stats.max_phase_rss_mb() << " MB\n";
+
+  stats.emit();
+  return 0;
+}
 
 int main(int argc, char* argv[]) {
 
-  if (argc < 5) {
+  cgal_tools::Rm_connected_components_params params;
+  cgal_tools::Tool_stats stats("rm_connected_components");
+  cgal_tools::extract_stats_options(argc, argv, stats);
+  cgal_tools::Result_cache cache;
+  cgal_tools::extract_cache_options(argc, argv, cache);
+  bool binary_output = cgal_tools::extract_flag(argc, argv, "binary");
+  bool float32 = cgal_tools::extract_flag(argc, argv, "float32");
+  bool keep_reorder = cgal_tools::extract_flag(argc, argv, "keep_reorder");
+  bool reorder = cgal_tools::extract_flag(argc, argv, "reorder") || keep_reorder;
+  cgal_tools::extract_option(argc, argv, "num_threads", params.num_threads);
+  int quantization_bits = 16;
+  cgal_tools::extract_option(argc, argv, "quantization_bits", quantization_bits);
+  
+  if (argc < 5 || !cgal_tools::check_no_unknown_options(argc, argv)) {
     std::cout << "Usage: " << argv[0]
-              << "  num_min_faces_in_component num_components_to_keep input.ply output.ply\n";
+              << " [--binary] [--quantization_bits B] [--float32]"
+              << " [--reorder | --keep_reorder] [--num_threads N] "
+              << cgal_tools::stats_usage() << " " << cgal_tools::cache_usage()
+              << " num_min_faces_in_component num_components_to_keep"
+              << " input.ply output.ply\n"
+              << "With --reorder, the vertices and faces are renumbered along a space-filling\n"
+              << "curve before processing, which makes memory access faster, and put back\n"
+              << "in the input order before writing. With --keep_reorder the new order is\n"
+              << "kept in the output.\n"
+              << "Output files named .cmesh are written in a compressed format, with\n"
+              << "coordinates quantized to --quantization_bits (default 16, 0 for exact).\n";
 
     return 1;
   }
   
-  int num_min_faces_in_component = atoi(argv[1]);
-  int num_components_to_keep     = atoi(argv[2]);
-  const char* input_file         = argv[3];
-  const char* output_file        = argv[4];
+  params.num_min_faces_in_component = atoi(argv[1]);
+  params.num_components_to_keep     = atoi(argv[2]);
+  const char* input_file            = argv[3];
+  const char* output_file           = argv[4];
 
   std::cout << "Reading mesh:               " << input_file << std::endl;
-  std::cout << "Num min faces in component: " << num_min_faces_in_component << "\n";
-  std::cout << "Num components to keep:     " << num_components_to_keep << "\n";
+  std::cout << "Num min faces in component: " << params.num_min_faces_in_component << "\n";
+  std::cout << "Num components to keep:     " << params.num_components_to_keep << "\n";
   
   if (std::string(input_file) == "" || std::string(output_file) == "") {
     std::cout << "The input and/or output mesh was not specified." << std::endl;
     return 1;
   }
   
-  Mesh mesh;
-  if(!PMP::IO::read_polygon_mesh(input_file, mesh)) {
-    std::cerr << "Invalid input." << std::endl;
-    return 1;
-  }
-  
-  typedef boost::graph_traits<Mesh>::face_descriptor face_descriptor;
-  const double bound = std::cos(0.75 * CGAL_PI);
-  std::vector<face_descriptor> cc;
-  face_descriptor fd = *faces(mesh).first;
-  PMP::connected_component(fd,
-      mesh,
-      std::back_inserter(cc));
-
-  // Instead of writing the faces into a container, you can set a face property to true
-  typedef Mesh::Property_map<face_descriptor, bool> F_select_map;
-  F_select_map fselect_map =
-    mesh.add_property_map<face_descriptor, bool>("f:select", false).first;
-  PMP::connected_component(fd,
-      mesh,
-      boost::make_function_output_iterator(Put_true<F_select_map>(fselect_map)));
-  
-  Mesh::Property_map<face_descriptor, std::size_t> fccmap =
-    mesh.add_property_map<face_descriptor, std::size_t>("f:CC").first;
-  std::size_t num = PMP::connected_components(mesh,
-      fccmap,
-      PMP::parameters::edge_is_constrained_map(Constraint<Mesh>(mesh, bound)));
-  std::cout << "The mesh has " << num << " connected components.\n";
-  
-  typedef std::map<std::size_t/*index of CC*/, unsigned int/*nb*/> Components_size;
-  Components_size nb_per_cc;
-  for(face_descriptor f : faces(mesh)){
-    nb_per_cc[ fccmap[f] ]++;
-  }
-  
-  //for(const Components_size::value_type& cc : nb_per_cc){
-  //   std::cout << "\t CC #" << cc.first
-  //            << " is made of " << cc.second << " faces" << std::endl;
-  // }
-  
-  // Keep only components with at least this many faces
-  if (num_min_faces_in_component > 0) {
-    PMP::keep_large_connected_components
-      (mesh, num_min_faces_in_component,
-       PMP::parameters::edge_is_constrained_map(Constraint<Mesh>(mesh, bound)));
-    
-    // Without this the mesh will be invalid
-    mesh.collect_garbage();
-  }
-  
-  if (num_components_to_keep > 0) {
-    PMP::keep_largest_connected_components
-      (mesh, num_components_to_keep,
-       PMP::parameters::edge_is_constrained_map(Constraint<Mesh>(mesh, bound)));
+  // The components kept do not depend on the number of threads
+  std::ostringstream cache_params;
+  cache_params << params.num_min_faces_in_component << " " << params.num_components_to_keep
+               << " " << binary_output << " " << quantization_bits << " " << float32 << " "
+               << reorder << " " << keep_reorder;
 
-    // Without this the mesh will be invalid
-    mesh.collect_garbage();
-  }
-  
-  std::cout << "Writing output mesh: " << output_file << std::endl;
-  CGAL::IO::write_PLY(output_file, mesh,
-                      CGAL::parameters::stream_precision(17).use_binary_mode(false));
-  
-  return 0;
+  return cgal_tools::run_with_cache(cache, "rm_connected_components", cache_params.str(),
+                                    input_file, output_file, stats, [&]() {
+      if (float32)
+        return process_mesh<cgal_tools::Float_mesh>(params, input_file, output_file,
+                                                    binary_output, quantization_bits,
+                                                    reorder, keep_reorder, stats);
+      return process_mesh<Mesh>(params, input_file, output_file, binary_output,
+                                quantization_bits, reorder, keep_reorder, stats);
+    });
 }
@@ -0,0 +1,217 @@
+// Removal of small connected components, shared by the
+// rm_connected_components tool and the pipeline.
+
+#ifndef CGAL_TOOLS_RM_CONNECTED_COMPONENTS_H
+#define CGAL_TOOLS_RM_CONNECTED_COMPONENTS_H
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Polygon_mesh_processing/connected_components.h>
+#include <boost/property_map/property_map.hpp>
+
+#include "mesh_types.h"
+#include "parallel_for.h"
+#include "tool_params.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace cgal_tools {
+
+template <typename G>
+struct Constraint : public boost::put_get_helper<bool,Constraint<G> > {
+  typedef typename boost::graph_traits<G>::edge_descriptor edge_descriptor;
+  typedef CGAL::Exact_predicates_inexact_constructions_kernel::Compare_dihedral_angle_3
+  Compare_dihedral_angle_3;
+  typedef boost::readable_property_map_tag      category;
+  typedef bool                                  value_type;
+  typedef bool                                  reference;
+  typedef edge_descriptor                       key_type;
+  Constraint()
+    :g_(NULL)
+  {}
+  Constraint(G& g, double bound)
+    : g_(&g), bound_(bound)
+  {}
+  // The dihedral angle is compared in double precision, also for
+  // meshes storing single precision points
+  bool operator[](edge_descriptor e) const
+  {
+    typedef CGAL::Exact_predicates_inexact_constructions_kernel::Point_3 Point_3;
+    const G& g = *g_;
+    return compare_(convert_point<Point_3>(g.point(source(e, g))),
+                    convert_point<Point_3>(g.point(target(e, g))),
+                    convert_point<Point_3>(g.point(target(next(halfedge(e, g), g), g))),
+                    convert_point<Point_3>(g.point(target(next(opposite(halfedge(e, g), g), g), g))),
+                   bound_) == CGAL::SMALLER;
+  }
+  const G* g_;
+  Compare_dihedral_angle_3 compare_;
+  double bound_;
+};
+// Which edges separate components, computed once for all edges in
+// parallel. Bit e % 64 of word e / 64 is set for edge e.
+template <class Mesh>
+void compute_constrained_edges(Mesh & mesh, double bound, int num_threads,
+                               std::vector<std::uint64_t> & bits) {
+  typedef typename Mesh::Edge_index Edge_index;
+
+  const std::size_t num_edges = mesh.num_edges();
+  bits.assign((num_edges + 63) / 64, 0);
+  Constraint<Mesh> constraint(mesh, bound);
+
+  // Each word is written by one thread only
+  parallel_for(0, bits.size(), num_threads, [&](std::size_t word) {
+      std::uint64_t value = 0;
+      std::size_t end = std::min(num_edges, 64 * word + 64);
+      for (std::size_t it = 64 * word; it < end; it++) {
+        Edge_index e(it);
+        if (mesh.is_removed(e) || mesh.is_border(e))
+          continue;
+        if (constraint[e])
+          value |= std::uint64_t(1) << (it % 64);
+      }
+      bits[word] = value;
+    }, 256);
+}
+
+// Label the faces by connected component, with components not
+// crossing the constrained edges. Faces are merged with a lock-free
+// union-find in parallel, and components are then numbered in the
+// order of their first face, so the labels do not depend on the
+// number of threads. Removed faces get no label. Return the number of
+// components.
+template <class Mesh>
+std::size_t label_connected_components(Mesh const& mesh,
+                                       std::vector<std::uint64_t> const& constrained,
+                                       int num_threads,
+                                       std::vector<std::size_t> & labels,
+                                       std::vector<std::size_t> & sizes) {
+
+  typedef typename Mesh::Halfedge_index Halfedge_index;
+  typedef typename Mesh::Face_index     Face_index;
+
+  const std::size_t num_faces = mesh.num_faces();
+  std::vector<std::atomic<std::uint32_t> > parent(num_faces);
+  for (std::size_t it = 0; it < num_faces; it++)
+    parent[it].store(it, std::memory_order_relaxed);
+
+  // Find the root, halving the path on the way
+  auto find = [&](std::uint32_t x) {
+    while (true) {
+      std::uint32_t p = parent[x].load(std::memory_order_relaxed);
+      if (p == x)
+        return x;
+      std::uint32_t gp = parent[p].load(std::memory_order_relaxed);
+      if (p != gp)
+        parent[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+      x = gp;
+    }
+  };
+
+  // Always link the larger root under the smaller one, so no cycles form
+  auto unite = [&](std::uint32_t a, std::uint32_t b) {
+    while (true) {
+      a = find(a);
+      b = find(b);
+      if (a == b)
+        return;
+      if (a < b)
+        std::swap(a, b);
+      std::uint32_t expected = a;
+      if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+        return;
+    }
+  };
+
+  parallel_for(0, num_faces, num_threads, [&](std::size_t it) {
+      Face_index f(it);
+      if (mesh.is_removed(f))
+        return;
+      for (Halfedge_index h : CGAL::halfedges_around_face(mesh.halfedge(f), mesh)) {
+        Face_index g = mesh.face(mesh.opposite(h));
+        if (g == Mesh::null_face() || std::size_t(g) > it)
+          continue;
+        std::size_t e = mesh.edge(h);
+        if (constrained[e / 64] & (std::uint64_t(1) << (e % 64)))
+          continue;
+        unite(it, g);
+      }
+    }, 4096);
+
+  const std::size_t no_label = std::size_t(-1);
+  labels.assign(num_faces, no_label);
+  sizes.clear();
+  for (std::size_t it = 0; it < num_faces; it++) {
+    if (mesh.is_removed(Face_index(it)))
+      continue;
+    std::size_t root = find(it);
+    if (labels[root] == no_label) {
+      labels[root] = sizes.size();
+      sizes.push_back(0);
+    }
+    labels[it] = labels[root];
+    sizes[labels[it]]++;
+  }
+
+  return sizes.size();
+}
+
+// Remove the small connected components and keep only the largest
+// ones, as requested. The components are found once, and both filters
+// are applied to that labeling with a single removal pass. Return the
+// number of components before removal, and if asked set the number of
+// those kept. The mesh has garbage afterwards.
+template <class Mesh>
+std::size_t rm_connected_components(Mesh & mesh, Rm_connected_components_params const& params,
+                                    std::size_t * num_kept = NULL) {
+
+  typedef typename boost::graph_traits<Mesh>::face_descriptor face_descriptor;
+  namespace PMP = CGAL::Polygon_mesh_processing;
+
+  const double bound = std::cos(0.75 * CGAL_PI);
+  std::vector<std::uint64_t> constrained;
+  compute_constrained_edges(mesh, bound, params.num_threads, constrained);
+
+  std::vector<std::size_t> labels, sizes;
+  std::size_t num = label_connected_components(mesh, constrained, params.num_threads,
+                                               labels, sizes);
+
+  // Keep only components with at least this many faces, and of those
+  // only the largest ones, ties going to the earlier component
+  std::vector<std::size_t> keep;
+  for (std::size_t cc = 0; cc < num; cc++) {
+    if (params.num_min_faces_in_component <= 0 ||
+        sizes[cc] >= std::size_t(params.num_min_faces_in_component))
+      keep.push_back(cc);
+  }
+  if (params.num_components_to_keep > 0 &&
+      keep.size() > std::size_t(params.num_components_to_keep)) {
+    std::stable_sort(keep.begin(), keep.end(), [&](std::size_t a, std::size_t b) {
+        return sizes[a] > sizes[b];
+      });
+    keep.resize(params.num_components_to_keep);
+    std::sort(keep.begin(), keep.end());
+  }
+
+  // Remove all the other components at once
+  if (keep.size() < num) {
+    typename Mesh::template Property_map<face_descriptor, std::size_t> fccmap =
+      mesh.template add_property_map<face_descriptor, std::size_t>("f:CC").first;
+    for (face_descriptor f : faces(mesh))
+      fccmap[f] = labels[f];
+    std::vector<std::size_t>().swap(labels);
+    PMP::keep_connected_components(mesh, keep, fccmap);
+    mesh.remove_property_map(fccmap);
+  }
+
+  if (num_kept != NULL)
+    *num_kept = keep.size();
+  return num;
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_RM_CONNECTED_COMPONENTS_H
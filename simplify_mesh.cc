@@ -1,40 +1,142 @@
-#include <CGAL/Simple_cartesian.h>
-#include <CGAL/Surface_mesh.h>
-#include <CGAL/Surface_mesh_simplification/edge_collapse.h>
-#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Count_ratio_stop_predicate.h>
-#include <CGAL/Polygon_mesh_processing/IO/polygon_mesh_io.h>
-#include <CGAL/IO/PLY.h>
-
-#include <chrono>
+#include <CGAL/boost/graph/helpers.h>
+#include <CGAL/Polygon_mesh_processing/distance.h>
+
+#include "cgal_tools.h"
+#include "mesh_io.h"
+#include "mesh_reorder.h"
+#include "mesh_types.h"
+#include "parallel_for.h"
+#include "result_cache.h"
+#include "tool_options.h"
+#include "tool_stats.h"
+
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
-typedef CGAL::Simple_cartesian<double>               Kernel;
-typedef Kernel::Point_3                              Point_3;
-typedef CGAL::Surface_mesh<Point_3>                  Mesh;
+typedef cgal_tools::Double_mesh Mesh;
 
-namespace SMS = CGAL::Surface_mesh_simplification;
 namespace PMP = CGAL::Polygon_mesh_processing;
 
-int main(int argc, char** argv) {
+// Simplify copies of the mesh serially and in parallel with 1, 2, 4,
+// ... threads, and compare timings, face counts, and the distance of
+// each parallel result to the serial one
+template <class Mesh>
+void scaling_test(Mesh const& input, cgal_tools::Simplify_params params, int max_threads) {
 
-  if (argc < 4) {
-    std::cout << "Usage: " << argv[0]
-              << " edge_keep_ratio input.ply output.ply\n";
+  Mesh serial = input;
+  double start = cgal_tools::wall_time();
+  cgal_tools::simplify_mesh_serial(serial, params);
+  double serial_time = cgal_tools::wall_time() - start;
+  serial.collect_garbage();
+
+  printf("%8s %10s %8s %10s %14s\n", "threads", "time (s)", "speedup", "faces",
+         "Hausdorff dist");
+  printf("%8s %10.3f %8.2f %10zu %14g\n", "serial", serial_time, 1.0,
+         std::size_t(serial.number_of_faces()), 0.0);
+
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    Mesh mesh = input;
+    params.num_threads = num_threads;
+    start = cgal_tools::wall_time();
+    cgal_tools::simplify_mesh_partitioned(mesh, params);
+    double elapsed = cgal_tools::wall_time() - start;
+    mesh.collect_garbage();
+
+    double dist = PMP::approximate_symmetric_Hausdorff_distance<CGAL::Sequential_tag>
+      (mesh, serial);
+    printf("%8d %10.3f %8.2f %10zu %14g\n", num_threads, elapsed,
+           serial_time / std::max(elapsed, 1e-9), std::size_t(mesh.number_of_faces()), dist);
+  }
+}
+
+// The name of level of detail number level
+std::string lod_file_name(std::string const& output_file, std::size_t level) {
+  std::string stem = output_file, ext;
+  std::size_t dot = stem.rfind('.');
+  if (dot != std::string::npos && stem.find('/', dot) == std::string::npos) {
+    ext  = stem.substr(dot);
+    stem = stem.substr(0, dot);
+  }
+  std::ostringstream os;
+  os << stem << "_lod" << level << ext;
+  return os.str();
+}
+
+// Simplify once and write a level of detail for each ratio. Each level
+// is written on its own thread while the simplification goes on.
+template <class Mesh>
+int simplify_lods(std::string const& input_file, std::string const& output_file,
+                  std::vector<double> ratios, bool binary_output, int quantization_bits,
+                  cgal_tools::Tool_stats & stats) {
+
+  std::sort(ratios.begin(), ratios.end(), std::greater<double>());
+  std::cout << "Reading mesh:       " << input_file << "\n";
+  stats.start_phase("read");
+  Mesh mesh;
+  if(!cgal_tools::read_mesh(input_file, mesh)) {
+    std::cerr << "Invalid input." << std::endl;
     return 1;
   }
+  if (!CGAL::is_triangle_mesh(mesh)){
+    std::cerr << "Input geometry is not triangulated." << std::endl;
+    return EXIT_FAILURE;
+  }
+  stats.set_count("input_faces", mesh.number_of_faces());
 
-  //Simply the mesh keeping only this fraction of the original edges.
-  double edge_keep_ratio  = atof(argv[1]);
-  
-  const char* input_file  = argv[2];
-  const char* output_file = argv[3];
+  stats.start_phase("simplify");
+  std::vector<std::thread> writers;
+  std::vector<char> success(ratios.size(), 0);
+  int r = cgal_tools::simplify_mesh_lods
+    (mesh, ratios, [&](std::size_t level, Mesh & lod) {
+      std::string file = lod_file_name(output_file, level);
+      std::cout << "Writing level " << level << " (edge keep ratio " << ratios[level]
+                << ", " << lod.number_of_faces() << " faces): " << file << std::endl;
+      auto copy = std::make_shared<Mesh>(std::move(lod));
+      writers.push_back(std::thread([&success, copy, file, level, binary_output,
+                                     quantization_bits]() {
+            success[level] = cgal_tools::write_mesh(file, *copy, binary_output,
+                                                    quantization_bits);
+          }));
+    });
+  stats.start_phase("write");
+  for (std::thread & writer : writers)
+    writer.join();
+  stats.end_phase();
+  stats.set_count("edges_collapsed", r);
+  stats.set_count("levels", ratios.size());
 
-  std::cout << "Edge keep ratio: " << edge_keep_ratio << "\n";
+  for (std::size_t level = 0; level < ratios.size(); level++) {
+    if (!success[level]) {
+      std::cerr << "Failed writing: " << lod_file_name(output_file, level) << std::endl;
+      return 1;
+    }
+  }
+
+  stats.emit();
+  return EXIT_SUCCESS;
+}
+
+// Read, simplify and write the mesh, stored with the points of Mesh
+template <class Mesh>
+int process_mesh(cgal_tools::Simplify_params const& params, bool run_scaling_test,
+                 std::string const& progressive_file, const char* input_file,
+                 const char* output_file, bool binary_output, int quantization_bits,
+                 bool reorder, bool keep_reorder, cgal_tools::Tool_stats & stats) {
+
+  std::cout << "Edge keep ratio: " << params.edge_keep_ratio << "\n";
   std::cout << "Reading mesh:       " << input_file << "\n";
 
+  stats.start_phase("read");
   Mesh mesh;
-  if(!PMP::IO::read_polygon_mesh(input_file, mesh)) {
+  if(!cgal_tools::read_mesh(input_file, mesh)) {
     std::cerr << "Invalid input." << std::endl;
     return 1;
   }
@@ -43,25 +145,219 @@ int main(int argc, char** argv) {
     std::cerr << "Input geometry is not triangulated." << std::endl;
     return EXIT_FAILURE;
   }
+
+  if (reorder) {
+    stats.start_phase("reorder");
+    if (!cgal_tools::hilbert_reorder_mesh(mesh, !keep_reorder))
+      std::cout << "Could not reorder the mesh, keeping its order.\n";
+  }
+
+  stats.set_count("input_faces", mesh.number_of_faces());
+  if (run_scaling_test) {
+    int max_threads = params.num_threads > 0 ? params.num_threads :
+      std::min(64, cgal_tools::resolve_num_threads(0));
+    stats.start_phase("scaling_test");
+    scaling_test(mesh, params, max_threads);
+  }
   
-  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
-  // In this example, the simplification stops when the number of undirected edges
-  // drops below 10% of the initial count
-  SMS::Count_ratio_stop_predicate<Mesh> stop(edge_keep_ratio);
-  int r = SMS::edge_collapse(mesh, stop);
-  std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+  stats.start_phase("simplify");
+  int r = 0;
+  std::size_t initial_edges = mesh.number_of_edges();
+  cgal_tools::Simplify_status status;
+  cgal_tools::Progressive_mesh_base base;
+  std::vector<cgal_tools::Vertex_split> collapses;
+  cgal_tools::Simplify_deviation_report deviation;
+  if (params.max_deviation > 0)
+    r = cgal_tools::simplify_mesh_within_deviation(mesh, params, &deviation);
+  else if (progressive_file.empty())
+    r = cgal_tools::simplify_mesh(mesh, params, &status);
+  else
+    r = cgal_tools::simplify_mesh_progressive(mesh, params, base, collapses, &status);
+  stats.end_phase();
+  double simplify_time = stats.last_phase().wall_seconds;
+  double reached_ratio = double(mesh.number_of_edges()) / std::max<std::size_t>(1, initial_edges);
+
+  if (status.reason == cgal_tools::Simplify_status::OUT_OF_TIME)
+    std::cout << "Stopped after " << params.max_seconds << " s";
+  else if (status.reason == cgal_tools::Simplify_status::ERROR_BOUND)
+    std::cout << "Stopped at error " << params.max_error;
+  if (status.reason != cgal_tools::Simplify_status::NONE)
+    std::cout << ", reaching edge keep ratio " << reached_ratio << " of "
+              << params.edge_keep_ratio << ".\n";
+  stats.set_count("stop_reason", status.reason);
+  stats.set_count("reached_ratio", reached_ratio);
+
+  if (params.max_deviation > 0) {
+    printf("%10s %10s %14s\n", "ratio", "faces", "Hausdorff dist");
+    for (cgal_tools::Deviation_level const& level : deviation.levels)
+      printf("%10.5f %10zu %14g\n", level.ratio, level.num_faces, level.deviation);
+    std::cout << "Reached edge keep ratio " << deviation.ratio << " at a distance of "
+              << deviation.deviation << " to the input, within " << params.max_deviation
+              << ", in " << deviation.num_simplifications << " simplifications.\n";
+    stats.set_count("hausdorff_distance", deviation.deviation);
+    stats.set_count("deviation_levels", deviation.levels.size());
+    stats.set_count("simplifications", deviation.num_simplifications);
+  }
+
+  if (!progressive_file.empty()) {
+    std::cout << "Writing progressive mesh: " << progressive_file << std::endl;
+    stats.start_phase("write_progressive_mesh");
+    if (!cgal_tools::write_progressive_mesh(progressive_file, base, collapses)) {
+      std::cerr << "Failed writing: " << progressive_file << std::endl;
+      return 1;
+    }
+    stats.end_phase();
+    stats.set_count("vertex_splits", collapses.size());
+  }
 
   std::cout << "Edges removed: " << r << ".\n"
-            << "Edges left: " << mesh.number_of_edges() << ".\n";
-  //d::cout << "Time elapsed: "
-  //        << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
-  //        << "ms" << std::endl;
+            << "Edges left: " << mesh.number_of_edges() << ".\n"
+            << "Time elapsed: " << simplify_time << " s\n";
 
   // Without this the mesh will be invalid
+  stats.start_phase("collect_garbage");
   mesh.collect_garbage();
+  stats.end_phase();
+  stats.set_count("edges_collapsed", r);
+  stats.set_count("edges_left", mesh.number_of_edges());
+  stats.set_count("output_faces", mesh.number_of_faces());
+
+  if (reorder && !keep_reorder) {
+    stats.start_phase("restore_order");
+    if (!cgal_tools::restore_mesh_order(mesh))
+      std::cout << "Could not restore the input order, writing the spatial order.\n";
+  }
 
   std::cout << "Writing output mesh: " << output_file << std::endl;
-  CGAL::IO::write_PLY(output_file, mesh,
-                      CGAL::parameters::stream_precision(17).use_binary_mode(false));
+  stats.start_phase("write");
+  if (!cgal_tools::write_mesh(output_file, mesh, binary_output, quantization_bits)) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
+  }
+
+  stats.end_phase();
+  std::cout << "Peak memory: " << stats.max_phase_rss_mb() << " MB\n";
+
+  stats.emit();
   return EXIT_SUCCESS;
 }
+
+int main(int argc, char** argv) {
+
+  cgal_tools::Simplify_params params;
+  cgal_tools::Tool_stats stats("simplify_mesh");
+  cgal_tools::extract_stats_options(argc, argv, stats);
+  cgal_tools::Result_cache cache;
+  cgal_tools::extract_cache_options(argc, argv, cache);
+  bool binary_output = cgal_tools::extract_flag(argc, argv, "binary");
+  bool run_scaling_test = cgal_tools::extract_flag(argc, argv, "scaling_test");
+  bool float32 = cgal_tools::extract_flag(argc, argv, "float32");
+  bool keep_reorder = cgal_tools::extract_flag(argc, argv, "keep_reorder");
+  bool reorder = cgal_tools::extract_flag(argc, argv, "reorder") || keep_reorder;
+  cgal_tools::extract_option(argc, argv, "num_threads", params.num_threads);
+  int quantization_bits = 16;
+  cgal_tools::extract_option(argc, argv, "quantization_bits", quantization_bits);
+  cgal_tools::extract_option(argc, argv, "num_parts", params.num_parts);
+  cgal_tools::extract_option(argc, argv, "max_seconds", params.max_seconds);
+  cgal_tools::extract_option(argc, argv, "max_error", params.max_error);
+  cgal_tools::extract_option(argc, argv, "max_deviation", params.max_deviation);
+  std::string progressive_file;
+  cgal_tools::extract_option(argc, argv, "progressive_mesh", progressive_file);
+
+  if (argc < 4 || !cgal_tools::check_no_unknown_options(argc, argv)) {
+    std::cout << "Usage: " << argv[0]
+              << " [--binary] [--quantization_bits B] [--float32] [--num_threads N]"
+              << " [--num_parts P] [--scaling_test]"
+              << " [--progressive_mesh file.pm] [--max_seconds S] [--max_error E]"
+              << " [--max_deviation D]"
+              << " [--reorder | --keep_reorder] "
+              << cgal_tools::stats_usage() << " " << cgal_tools::cache_usage()
+              << " edge_keep_ratio input.ply output.ply\n"
+              << "Several comma-separated ratios, such as 0.5,0.2,0.05, produce levels of\n"
+              << "detail from one simplification, written to output_lod0.ply for the\n"
+              << "largest ratio, output_lod1.ply for the next, and so on. With\n"
+              << "--progressive_mesh, each collapse is recorded, and the result plus the\n"
+              << "vertex splits undoing the collapses are written to the given file.\n"
+              << "With --max_seconds, stop after about S seconds of simplification and\n"
+              << "write what was reached, which is a valid mesh. With --max_error, stop\n"
+              << "before a collapse would move the surface by more than about E.\n"
+              << "With --max_deviation, keep the fewest edges, down to the given ratio, for\n"
+              << "which the Hausdorff distance to the input, measured on samples, is at\n"
+              << "most D.\n"
+              << "With --reorder, the vertices and faces are renumbered along a space-filling\n"
+              << "curve before processing, which makes memory access faster, and put back\n"
+              << "in the input order before writing. With --keep_reorder the new order is\n"
+              << "kept in the output. With --num_threads the input order cannot be\n"
+              << "restored, so the output keeps the new order. Neither can be used with\n"
+              << "--progressive_mesh, whose ids are those of the input.\n"
+              << "Output files named .cmesh are written in a compressed format, with\n"
+              << "coordinates quantized to --quantization_bits (default 16, 0 for exact).\n";
+    return 1;
+  }
+
+  //Simply the mesh keeping only this fraction of the original edges.
+  std::vector<double> lod_ratios;
+  {
+    std::istringstream is(argv[1]);
+    std::string ratio;
+    while (std::getline(is, ratio, ','))
+      lod_ratios.push_back(atof(ratio.c_str()));
+  }
+  params.edge_keep_ratio = lod_ratios.empty() ? 0 : lod_ratios[0];
+  
+  const char* input_file  = argv[2];
+  const char* output_file = argv[3];
+
+  if (!progressive_file.empty() &&
+      (params.num_threads > 0 || lod_ratios.size() > 1 || reorder)) {
+    std::cerr << "--progressive_mesh cannot be used with --num_threads, --reorder,"
+              << " --keep_reorder or several ratios." << std::endl;
+    return 1;
+  }
+  if (params.max_deviation > 0 &&
+      (params.num_threads > 0 || run_scaling_test || params.max_seconds > 0 ||
+       params.max_error > 0 || !progressive_file.empty() || lod_ratios.size() > 1)) {
+    std::cerr << "--max_deviation cannot be used with --num_threads, --scaling_test,"
+              << " --max_seconds, --max_error, --progressive_mesh or several ratios."
+              << std::endl;
+    return 1;
+  }
+  if (lod_ratios.size() > 1) {
+    if (params.num_threads > 0 || run_scaling_test || params.max_seconds > 0 ||
+        params.max_error > 0 || reorder) {
+      std::cerr << "Several ratios cannot be used with --num_threads, --scaling_test,"
+                << " --max_seconds, --max_error or --reorder."
+                << std::endl;
+      return 1;
+    }
+    if (float32)
+      return simplify_lods<cgal_tools::Float_mesh>(input_file, output_file, lod_ratios,
+                                                   binary_output, quantization_bits, stats);
+    return simplify_lods<Mesh>(input_file, output_file, lod_ratios, binary_output,
+                               quantization_bits, stats);
+  }
+
+  // A run with a time budget may not give the same result twice, the
+  // scaling test is run for its timings, and a progressive mesh is a
+  // second output
+  if (params.max_seconds > 0 || run_scaling_test || !progressive_file.empty())
+    cache.set_directory("");
+  std::ostringstream cache_params;
+  cache_params.precision(17);
+  cache_params << params.edge_keep_ratio << " " << params.num_threads << " "
+               << params.num_parts << " " << params.max_error << " " << params.max_deviation
+               << " " << binary_output << " " << quantization_bits << " " << float32 << " "
+               << reorder << " " << keep_reorder;
+
+  return cgal_tools::run_with_cache(cache, "simplify_mesh", cache_params.str(), input_file,
+                                    output_file, stats, [&]() {
+      if (float32)
+        return process_mesh<cgal_tools::Float_mesh>(params, run_scaling_test, progressive_file,
+                                                    input_file, output_file, binary_output,
+                                                    quantization_bits, reorder, keep_reorder,
+                                                    stats);
+      return process_mesh<Mesh>(params, run_scaling_test, progressive_file, input_file,
+                                output_file, binary_output, quantization_bits, reorder,
+                                keep_reorder, stats);
+    });
+}
@@ -0,0 +1,469 @@
+// Edge-collapse simplification, shared by the simplify_mesh tool and
+// the pipeline.
+
+#ifndef CGAL_TOOLS_SIMPLIFY_MESH_H
+#define CGAL_TOOLS_SIMPLIFY_MESH_H
+
+#include <CGAL/Surface_mesh_simplification/edge_collapse.h>
+#include <CGAL/Surface_mesh_simplification/Edge_collapse_visitor_base.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Count_ratio_stop_predicate.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Constrained_placement.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/LindstromTurk_cost.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/LindstromTurk_placement.h>
+
+#include "mesh_deviation.h"
+#include "parallel_for.h"
+#include "progressive_mesh.h"
+#include "submesh.h"
+#include "tool_params.h"
+#include "tool_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+namespace cgal_tools {
+
+// Stop when the edge count drops below the given fraction of the
+// initial count, as Count_ratio_stop_predicate does, or below the given
+// count if that is positive. Also stop when past the deadline, or when
+// the cheapest collapse left has too large an error.
+template <class Mesh>
+class Budget_stop_predicate {
+public:
+  Budget_stop_predicate(double ratio, std::size_t target_edges, double deadline,
+                        double max_error, Simplify_status * status):
+    m_ratio(ratio), m_target_edges(target_edges), m_deadline(deadline),
+    m_max_error(max_error), m_status(status) {}
+
+  template <class FT, class Profile>
+  bool operator()(FT const& current_cost, Profile const&, std::size_t initial_edge_count,
+                  std::size_t current_edge_count) const {
+    if (m_target_edges > 0) {
+      if (current_edge_count < m_target_edges)
+        return true;
+    } else if (double(current_edge_count) / double(initial_edge_count) < m_ratio) {
+      return true;
+    }
+    if (past_deadline(m_deadline))
+      return stop_for(Simplify_status::OUT_OF_TIME);
+    if (m_max_error > 0 && std::sqrt(std::max(0.0, CGAL::to_double(current_cost))) > m_max_error)
+      return stop_for(Simplify_status::ERROR_BOUND);
+    return false;
+  }
+
+private:
+  bool stop_for(Simplify_status::Reason reason) const {
+    if (m_status != NULL)
+      m_status->set(reason);
+    return true;
+  }
+
+  double m_ratio;
+  std::size_t m_target_edges;
+  double m_deadline, m_max_error;
+  Simplify_status * m_status;
+};
+
+// Simplify the mesh keeping only the given fraction of the original
+// edges, on one thread. Return the number of edges removed. The mesh
+// has garbage afterwards. If asked, say why it stopped early.
+template <class Mesh>
+int simplify_mesh_serial(Mesh & mesh, Simplify_params const& params,
+                         Simplify_status * status = NULL) {
+  namespace SMS = CGAL::Surface_mesh_simplification;
+
+  // The simplification stops when the number of undirected edges
+  // drops below the given fraction of the initial count
+  Budget_stop_predicate<Mesh> stop(params.edge_keep_ratio, 0,
+                                   deadline_after(params.max_seconds), params.max_error,
+                                   status);
+  return SMS::edge_collapse(mesh, stop);
+}
+
+// As simplify_mesh(), but never collapse the edges for which the
+// given property map is true, and never move their vertices. To keep
+// a vertex where it is and in the mesh, mark all its edges.
+template <class Mesh, class EdgeConstrainedMap>
+int simplify_mesh(Mesh & mesh, Simplify_params const& params, EdgeConstrainedMap ecmap,
+                  Simplify_status * status = NULL) {
+  namespace SMS = CGAL::Surface_mesh_simplification;
+
+  Budget_stop_predicate<Mesh> stop(params.edge_keep_ratio, 0,
+                                   deadline_after(params.max_seconds), params.max_error,
+                                   status);
+  SMS::Constrained_placement<SMS::LindstromTurk_placement<Mesh>, EdgeConstrainedMap>
+    placement(ecmap);
+  return SMS::edge_collapse(mesh, stop,
+                            CGAL::parameters::edge_is_constrained_map(ecmap)
+                            .get_cost(SMS::LindstromTurk_cost<Mesh>())
+                            .get_placement(placement));
+}
+
+// Split the mesh into spatial patches and simplify them in parallel
+// down to the given ratio, keeping fixed the vertices on the patch
+// boundaries. Then put the patches back together and simplify the
+// result, boundaries included, to the overall target. Return the
+// number of edges removed.
+template <class Mesh>
+int simplify_mesh_partitioned(Mesh & mesh, Simplify_params const& params,
+                              Simplify_status * status = NULL) {
+
+  typedef typename Mesh::Vertex_index   Vertex_index;
+  typedef typename Mesh::Halfedge_index Halfedge_index;
+  typedef typename Mesh::Edge_index     Edge_index;
+  typedef typename Mesh::Face_index     Face_index;
+  namespace SMS = CGAL::Surface_mesh_simplification;
+
+  const std::size_t initial_edges = mesh.number_of_edges();
+  const std::size_t num_vertices = mesh.num_vertices();
+  const double deadline = deadline_after(params.max_seconds);
+
+  std::vector<std::vector<Face_index> > parts;
+  partition_faces(mesh, params.num_parts, parts);
+
+  std::vector<Mesh> submeshes(parts.size());
+  std::vector<std::vector<Vertex_index> > local_to_global(parts.size());
+  std::vector<unsigned char> extracted(parts.size(), 0);
+  Mesh const& const_mesh = mesh;
+  parallel_for(0, parts.size(), params.num_threads, [&](std::size_t it) {
+      Mesh & part = submeshes[it];
+      extracted[it] = extract_submesh(const_mesh, parts[it], part, local_to_global[it]);
+      std::vector<Face_index>().swap(parts[it]);
+      if (!extracted[it])
+        return;
+
+      // Lock all edges around boundary vertices
+      typename Mesh::template Property_map<Edge_index, bool> constrained =
+        part.template add_property_map<Edge_index, bool>("e:locked", false).first;
+      for (Vertex_index v : part.vertices()) {
+        if (!part.is_border(v))
+          continue;
+        for (Halfedge_index h : CGAL::halfedges_around_target(part.halfedge(v), part))
+          constrained[part.edge(h)] = true;
+      }
+
+      // Share what is left of the time budget
+      Simplify_params part_params = params;
+      if (deadline > 0)
+        part_params.max_seconds = std::max(deadline - wall_time(), 1e-9);
+      simplify_mesh(part, part_params, constrained, status);
+      part.remove_property_map(constrained);
+    });
+
+  for (std::size_t it = 0; it < extracted.size(); it++) {
+    if (!extracted[it]) {
+      // Some patch is not a valid mesh on its own
+      return simplify_mesh_serial<Mesh>(mesh, params, status);
+    }
+  }
+
+  if (!merge_submeshes(submeshes, local_to_global, num_vertices, mesh))
+    std::cerr << "Some faces were lost when merging the simplified patches." << std::endl;
+  std::vector<Mesh>().swap(submeshes);
+
+  // Finish along the patch boundaries
+  Budget_stop_predicate<Mesh> stop(0, std::max<std::size_t>(1, params.edge_keep_ratio * initial_edges),
+                                   deadline, params.max_error, status);
+  SMS::edge_collapse(mesh, stop);
+
+  return initial_edges - mesh.number_of_edges();
+}
+
+// The state of the levels of detail during a simplification. It is
+// kept outside the visitor, which CGAL copies.
+template <class Mesh>
+struct Lod_state {
+  Mesh const* mesh;
+  double initial_edges;
+  std::vector<double> ratios;    // decreasing
+  std::size_t next;              // the next level to reach
+  bool done;                     // if the callback asked to stop
+  std::function<bool(std::size_t, Mesh &)> snapshot;
+
+  // Hand a compacted copy of the mesh to the callback for each level
+  // the edge count has dropped below
+  void update() {
+    // The same test as Count_ratio_stop_predicate
+    while (!done && next < ratios.size() &&
+           double(mesh->number_of_edges()) / initial_edges < ratios[next])
+      take_snapshot();
+  }
+
+  void take_snapshot() {
+    Mesh copy = *mesh;
+    copy.collect_garbage();
+    done = !snapshot(next, copy);
+    next++;
+  }
+};
+
+// Stop at the smallest ratio, as Count_ratio_stop_predicate does, or
+// when the callback asked to
+template <class Mesh>
+class Lod_stop_predicate {
+public:
+  explicit Lod_stop_predicate(Lod_state<Mesh> const* state): m_state(state) {}
+
+  template <class FT, class Profile>
+  bool operator()(FT const&, Profile const&, std::size_t initial_edge_count,
+                  std::size_t current_edge_count) const {
+    return m_state->done ||
+      double(current_edge_count) / double(initial_edge_count) < m_state->ratios.back();
+  }
+
+private:
+  Lod_state<Mesh> const* m_state;
+};
+
+template <class Mesh>
+struct Lod_visitor : CGAL::Surface_mesh_simplification::Edge_collapse_visitor_base<Mesh> {
+  Lod_state<Mesh> * state;
+  explicit Lod_visitor(Lod_state<Mesh> * state): state(state) {}
+
+  template <class Profile, class Vertex>
+  void OnCollapsed(Profile const&, Vertex const&) { state->update(); }
+};
+
+// Simplify the mesh once, down to the smallest of the given edge keep
+// ratios. Each time the edge count drops below one of the ratios, call
+// snapshot(level, mesh) with a compacted copy of the mesh, the levels
+// being numbered from the largest ratio down. A level is the same mesh
+// simplify_mesh_serial() gives for its ratio, as the collapses are
+// done in the same order and stopped at the same point. Levels not
+// reached, as when no edge can be collapsed any more, get the final
+// mesh. If the callback returns false, stop there. Return the number
+// of edges removed. The mesh has garbage afterwards.
+template <class Mesh>
+int simplify_mesh_lods_until(Mesh & mesh, std::vector<double> ratios,
+                             std::function<bool(std::size_t, Mesh &)> snapshot) {
+  namespace SMS = CGAL::Surface_mesh_simplification;
+
+  std::sort(ratios.begin(), ratios.end(), std::greater<double>());
+  Lod_state<Mesh> state;
+  state.mesh          = &mesh;
+  state.initial_edges = mesh.number_of_edges();
+  state.ratios        = ratios;
+  state.next          = 0;
+  state.done          = false;
+  state.snapshot      = snapshot;
+
+  int removed = 0;
+  if (!ratios.empty()) {
+    Lod_stop_predicate<Mesh> stop(&state);
+    removed = SMS::edge_collapse(mesh, stop,
+                                 CGAL::parameters::visitor(Lod_visitor<Mesh>(&state)));
+  }
+
+  while (!state.done && state.next < ratios.size())
+    state.take_snapshot();
+
+  return removed;
+}
+
+// The same, calling snapshot for every level
+template <class Mesh>
+int simplify_mesh_lods(Mesh & mesh, std::vector<double> ratios,
+                       std::function<void(std::size_t, Mesh &)> snapshot) {
+  return simplify_mesh_lods_until<Mesh>(mesh, ratios, [&](std::size_t level, Mesh & lod) {
+      snapshot(level, lod);
+      return true;
+    });
+}
+
+// The number of levels between two ratios measured while searching
+// for the smallest mesh within a deviation bound. The first pass halves
+// the ratio from one level to the next, the second narrows down the
+// interval where the bound was crossed.
+const int DEVIATION_SEARCH_LEVELS = 8;
+
+// Simplify copies of the mesh through decreasing ratios, measuring the
+// distance of each level to the input, and keep the smallest level
+// within params.max_deviation, no smaller than params.edge_keep_ratio.
+// A first simplification goes down by halves until the bound is
+// crossed, and a second through finer steps between the last level
+// within it and the first beyond. Each level is the mesh
+// simplify_mesh_serial() gives for its ratio, so the bound holds for
+// the result, as far as the samples tell, though it may not for some
+// larger ratios. Return the number of edges removed. The mesh has no
+// garbage afterwards.
+template <class Mesh>
+int simplify_mesh_within_deviation(Mesh & mesh, Simplify_params const& params,
+                                   Simplify_deviation_report * report = NULL) {
+
+  Simplify_deviation_report local_report;
+  Simplify_deviation_report & r = report != NULL ? *report : local_report;
+  r = Simplify_deviation_report();
+
+  mesh.collect_garbage();
+  const std::size_t initial_edges = mesh.number_of_edges();
+  const double min_ratio = std::max(0.0, std::min(1.0, params.edge_keep_ratio));
+  Deviation_meter meter(mesh, 0);
+  Mesh const original = mesh;
+
+  double pass_ratio = 1, fail_ratio = -1;
+  auto search = [&](std::vector<double> const& ratios) {
+    if (ratios.empty())
+      return;
+    Mesh work = original;
+    r.num_simplifications++;
+    simplify_mesh_lods_until<Mesh>(work, ratios, [&](std::size_t level, Mesh & lod) {
+        Deviation_level measured;
+        measured.ratio     = double(lod.number_of_edges()) /
+                             std::max<std::size_t>(1, initial_edges);
+        measured.num_faces = lod.number_of_faces();
+        measured.deviation = meter.distance(lod);
+        r.levels.push_back(measured);
+        if (measured.deviation > params.max_deviation) {
+          fail_ratio = ratios[level];
+          return false;
+        }
+        pass_ratio  = ratios[level];
+        r.ratio     = measured.ratio;
+        r.deviation = measured.deviation;
+        mesh = std::move(lod);
+        return true;
+      });
+  };
+
+  std::vector<double> ratios;
+  for (double ratio = 0.5; ratio > min_ratio; ratio /= 2)
+    ratios.push_back(ratio);
+  ratios.push_back(min_ratio);
+  search(ratios);
+
+  if (fail_ratio >= 0) {
+    ratios.clear();
+    for (int it = 1; it < DEVIATION_SEARCH_LEVELS; it++) {
+      double ratio = fail_ratio > 0 ?
+        pass_ratio * std::pow(fail_ratio / pass_ratio, double(it) / DEVIATION_SEARCH_LEVELS) :
+        pass_ratio * (DEVIATION_SEARCH_LEVELS - it) / DEVIATION_SEARCH_LEVELS;
+      ratios.push_back(ratio);
+    }
+    search(ratios);
+  }
+
+  return initial_edges - mesh.number_of_edges();
+}
+
+template <class Mesh>
+int simplify_mesh(Mesh & mesh, Simplify_params const& params,
+                  Simplify_status * status = NULL) {
+  if (params.max_deviation > 0)
+    return simplify_mesh_within_deviation<Mesh>(mesh, params);
+  if (params.num_threads > 0)
+    return simplify_mesh_partitioned<Mesh>(mesh, params, status);
+  return simplify_mesh_serial<Mesh>(mesh, params, status);
+}
+
+// The collapses done so far. Before each collapse the vertex split
+// undoing it is prepared for either end of the edge being removed, and
+// once CGAL reports which end was kept, the matching one is recorded.
+template <class Mesh>
+struct Collapse_recorder {
+  Mesh const* mesh;
+  std::vector<Vertex_split> collapses;
+  Vertex_split pending[2];     // for the first and the second end removed
+};
+
+template <class Mesh>
+struct Collapse_record_visitor
+  : CGAL::Surface_mesh_simplification::Edge_collapse_visitor_base<Mesh> {
+
+  typedef typename Mesh::Vertex_index   Vertex_index;
+  typedef typename Mesh::Halfedge_index Halfedge_index;
+  typedef typename Mesh::Face_index     Face_index;
+
+  Collapse_recorder<Mesh> * recorder;
+  explicit Collapse_record_visitor(Collapse_recorder<Mesh> * recorder): recorder(recorder) {}
+
+  template <class Profile, class Placement>
+  void OnCollapsing(Profile const& profile, Placement const&) {
+    Mesh const& mesh = *recorder->mesh;
+    Face_index f0 = mesh.face(profile.v0_v1()), f1 = mesh.face(profile.v1_v0());
+
+    for (int side = 0; side < 2; side++) {
+      Vertex_index u = (side == 0) ? profile.v0() : profile.v1();
+      Vertex_index v = (side == 0) ? profile.v1() : profile.v0();
+      Vertex_split & s = recorder->pending[side];
+      s.u = u;
+      s.v = v;
+      for (int c = 0; c < 3; c++) {
+        s.pu[c] = CGAL::to_double(mesh.point(u)[c]);
+        s.pv[c] = CGAL::to_double(mesh.point(v)[c]);
+      }
+
+      s.removed_face_ids.clear();
+      s.removed_faces.clear();
+      for (Face_index f : {f0, f1}) {
+        if (f == Mesh::null_face())
+          continue;
+        std::array<std::uint32_t, 3> face;
+        int c = 0;
+        for (Vertex_index w : CGAL::vertices_around_face(mesh.halfedge(f), mesh))
+          if (c < 3) face[c++] = w;
+        s.removed_face_ids.push_back(f);
+        s.removed_faces.push_back(face);
+      }
+
+      s.rewritten_faces.clear();
+      for (Face_index f : CGAL::faces_around_target(mesh.halfedge(u), mesh)) {
+        if (f != Mesh::null_face() && f != f0 && f != f1)
+          s.rewritten_faces.push_back(f);
+      }
+    }
+  }
+
+  template <class Profile, class Vertex>
+  void OnCollapsed(Profile const& profile, Vertex const& kept) {
+    int side = (kept == profile.v1()) ? 0 : 1;
+    recorder->collapses.push_back(recorder->pending[side]);
+  }
+};
+
+// As simplify_mesh_serial(), also recording each collapse, and the
+// resulting mesh in the ids of the input mesh, as a progressive mesh.
+// The mesh must have no garbage to start with.
+template <class Mesh>
+int simplify_mesh_progressive(Mesh & mesh, Simplify_params const& params,
+                              Progressive_mesh_base & base,
+                              std::vector<Vertex_split> & collapses,
+                              Simplify_status * status = NULL) {
+  namespace SMS = CGAL::Surface_mesh_simplification;
+
+  Collapse_recorder<Mesh> recorder;
+  recorder.mesh = &mesh;
+  Budget_stop_predicate<Mesh> stop(params.edge_keep_ratio, 0,
+                                   deadline_after(params.max_seconds), params.max_error,
+                                   status);
+  int removed = SMS::edge_collapse(mesh, stop, CGAL::parameters::visitor
+                                   (Collapse_record_visitor<Mesh>(&recorder)));
+  collapses.swap(recorder.collapses);
+
+  base = Progressive_mesh_base();
+  base.num_vertices = mesh.num_vertices();
+  base.num_faces    = mesh.num_faces();
+  for (typename Mesh::Vertex_index v : mesh.vertices()) {
+    typename Mesh::Point const& p = mesh.point(v);
+    base.vertex_ids.push_back(v);
+    base.points.push_back({{CGAL::to_double(p.x()), CGAL::to_double(p.y()),
+                            CGAL::to_double(p.z())}});
+  }
+  for (typename Mesh::Face_index f : mesh.faces()) {
+    std::array<std::uint32_t, 3> face;
+    int c = 0;
+    for (typename Mesh::Vertex_index w : CGAL::vertices_around_face(mesh.halfedge(f), mesh))
+      if (c < 3) face[c++] = w;
+    base.face_ids.push_back(f);
+    base.faces.push_back(face);
+  }
+
+  return removed;
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_SIMPLIFY_MESH_H
@@ -1,63 +1,180 @@
-#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
-#include <CGAL/Surface_mesh.h>
-
-#include <CGAL/Polygon_mesh_processing/smooth_shape.h>
-#include <CGAL/Polygon_mesh_processing/IO/polygon_mesh_io.h>
+#include "cgal_tools.h"
+#include "mesh_io.h"
+#include "mesh_reorder.h"
+#include "mesh_roi.h"
+#include "mesh_types.h"
+#include "result_cache.h"
+#include "tool_options.h"
+#include "tool_stats.h"
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <vector>
 
-typedef CGAL::Exact_predicates_inexact_constructions_kernel   K;
-typedef CGAL::Surface_mesh<K::Point_3>                        Mesh;
+typedef cgal_tools::Double_mesh Mesh;
 
-namespace PMP = CGAL::Polygon_mesh_processing;
+// Read, smoothe and write the mesh, stored with the points of Mesh
+template <class Mesh>
+int process_mesh(cgal_tools::Smoothe_params const& params, const char* input_file,
+                 const char* output_file, bool binary_output, int quantization_bits,
+                 bool reorder, bool keep_reorder, cgal_tools::Tool_stats & stats) {
 
-int main(int argc, char* argv[]) {
+  stats.start_phase("read");
+  Mesh mesh;
+  if(!cgal_tools::read_mesh(input_file, mesh))
+  {
+    std::cerr << "Invalid input." << std::endl;
+    return 1;
+  }
 
-  if (argc < 6) {
-    std::cout << "Usage: " << argv[0]
-              << " num_iterations smoothing_time smoothe_boundary input.ply output.ply\n";
+  if (!cgal_tools::roi_faces_in_mesh(mesh, params.roi)) {
+    std::cerr << "Some faces of the region of interest are not in the mesh." << std::endl;
     return 1;
   }
-  
-  int num_iterations      = atoi(argv[1]);
-  double smoothing_time   = atof(argv[2]);
-  int smoothe_boundary    = atoi(argv[3]);
-  const char* input_file  = argv[4];
-  const char* output_file = argv[5];
 
-  std::cout << "Reading mesh:         " << input_file << std::endl;
-  std::cout << "Number of iterations: " << num_iterations << "\n";
-  std::cout << "Smoothing time:       " << smoothing_time << "\n";
-  std::cout << "Smoothe boundary:     " << smoothe_boundary << "\n";
+  if (reorder) {
+    stats.start_phase("reorder");
+    if (!cgal_tools::hilbert_reorder_mesh(mesh, !keep_reorder))
+      std::cout << "Could not reorder the mesh, keeping its order.\n";
+  }
 
-  Mesh mesh;
-  if(!PMP::IO::read_polygon_mesh(input_file, mesh))
-  {
-    std::cerr << "Invalid input." << std::endl;
+  stats.set_count("input_faces", mesh.number_of_faces());
+  stats.start_phase("smoothe");
+  std::vector<double> iteration_times;
+  std::ptrdiff_t num_constrained = cgal_tools::smoothe_mesh(mesh, params, &iteration_times);
+  stats.end_phase();
+  if (num_constrained < 0) {
+    std::cerr << "The region of interest has no faces, or is not a valid mesh on its own."
+              << std::endl;
     return 1;
   }
+  stats.set_count("iterations", params.num_iterations);
+  stats.set_count("constrained_vertices", num_constrained);
+  if (params.roi.empty())
+    std::cout << "Constrained: " << num_constrained << " border vertices." << std::endl;
+  else
+    std::cout << "Constrained: " << num_constrained
+              << " vertices on the border of the region." << std::endl;
+
+  double total_time = 0;
+  for (double t: iteration_times)
+    total_time += t;
+  if (!iteration_times.empty())
+    std::cout << "Time per iteration:   " << total_time / iteration_times.size()
+              << " seconds (total " << total_time << ")." << std::endl;
 
-  std::set<Mesh::Vertex_index> constrained_vertices;
-  if (!smoothe_boundary) {
-    for(Mesh::Vertex_index v : vertices(mesh)) {
-        if(is_border(v, mesh))
-          constrained_vertices.insert(v);
-      }
+  if (reorder && !keep_reorder) {
+    stats.start_phase("restore_order");
+    if (!cgal_tools::restore_mesh_order(mesh))
+      std::cout << "Could not restore the input order, writing the spatial order.\n";
   }
-  
-  std::cout << "Constraining: " << constrained_vertices.size() << " border vertices." << std::endl;
-  
-  CGAL::Boolean_property_map<std::set<Mesh::Vertex_index> > vcmap(constrained_vertices);
-  
-  //std::cout << "Smoothing shape... (" << num_iterations << " iterations)" << std::endl;
-  PMP::smooth_shape(mesh, smoothing_time, PMP::parameters::number_of_iterations(num_iterations)
-                                                .vertex_is_constrained_map(vcmap));
 
   std::cout << "Writing output mesh: " << output_file << std::endl;
-  CGAL::IO::write_PLY(output_file, mesh,
-                      CGAL::parameters::stream_precision(17).use_binary_mode(false));
+  stats.start_phase("write");
+  if (!cgal_tools::write_mesh(output_file, mesh, binary_output, quantization_bits)) {
+    std::cerr << "Failed writing: " << output_file << std::endl;
+    return 1;
+  }
+
+  stats.end_phase();
+  std::cout << "Peak memory: " << stats.max_phase_rss_mb() << " MB\n";
 
+  stats.emit();
   return 0;
 }
 
+int main(int argc, char* argv[]) {
+
+  cgal_tools::Smoothe_params params;
+  cgal_tools::Tool_stats stats("smoothe_mesh");
+  cgal_tools::extract_stats_options(argc, argv, stats);
+  cgal_tools::Result_cache cache;
+  cgal_tools::extract_cache_options(argc, argv, cache);
+  bool binary_output = cgal_tools::extract_flag(argc, argv, "binary");
+  bool float32 = cgal_tools::extract_flag(argc, argv, "float32");
+  bool keep_reorder = cgal_tools::extract_flag(argc, argv, "keep_reorder");
+  bool reorder = cgal_tools::extract_flag(argc, argv, "reorder") || keep_reorder;
+  cgal_tools::extract_option(argc, argv, "method", params.method);
+  cgal_tools::extract_option(argc, argv, "lambda", params.lambda);
+  cgal_tools::extract_option(argc, argv, "mu", params.mu);
+  cgal_tools::extract_option(argc, argv, "num_threads", params.num_threads);
+  int quantization_bits = 16;
+  cgal_tools::extract_option(argc, argv, "quantization_bits", quantization_bits);
+  if (!cgal_tools::extract_roi_options(argc, argv, params.roi))
+    return 1;
+  // The face indices are those of the input
+  if (reorder && !params.roi.faces.empty()) {
+    std::cerr << "--roi_faces cannot be used with --reorder or --keep_reorder." << std::endl;
+    return 1;
+  }
+
+  bool valid_method = (params.method == "implicit" || params.method == "laplacian" ||
+                       params.method == "taubin");
+  if (argc < 6 || !valid_method || !cgal_tools::check_no_unknown_options(argc, argv)) {
+    std::cout << "Usage: " << argv[0]
+              << " [--binary] [--quantization_bits B] [--float32]"
+              << " [--reorder | --keep_reorder]"
+              << " [--method implicit|laplacian|taubin] [--lambda L]"
+              << " [--mu M]"
+              << " [--num_threads N] " << cgal_tools::roi_usage() << " "
+              << cgal_tools::stats_usage() << " "
+              << cgal_tools::cache_usage()
+              << " num_iterations smoothing_time smoothe_boundary input.ply output.ply\n"
+              << "The implicit method (the default) is mean curvature flow. It smoothes\n"
+              << "strongly in few iterations and is stable for large smoothing times, but\n"
+              << "each iteration solves a sparse linear system, which is slow and needs\n"
+              << "much memory for large meshes. The laplacian and taubin methods move each\n"
+              << "vertex towards the average of its neighbours by lambda (default 0.5). They\n"
+              << "are fast and use all cores, so suit light denoising of large meshes, but\n"
+              << "need many iterations for strong smoothing. Laplacian smoothing shrinks the\n"
+              << "mesh, taubin follows each step with a step by mu (default -0.53) to undo\n"
+              << "the shrinking. The smoothing time is used only by the implicit method.\n"
+              << "With --roi_box or --roi_faces, only a region of interest is smoothed: the\n"
+              << "faces with a vertex in the box, and the faces listed by their index in the\n"
+              << "input in a file, with --roi_rings rings of faces around them (default 2).\n"
+              << "The vertices the region shares with the rest of the mesh stay put, and the\n"
+              << "time depends on the size of the region.\n"
+              << "With --reorder, the vertices and faces are renumbered along a space-filling\n"
+              << "curve before processing, which makes memory access faster, and put back\n"
+              << "in the input order before writing. With --keep_reorder the new order is\n"
+              << "kept in the output.\n"
+              << "Output files named .cmesh are written in a compressed format, with\n"
+              << "coordinates quantized to --quantization_bits (default 16, 0 for exact).\n";
+    return 1;
+  }
+  
+  params.num_iterations   = atoi(argv[1]);
+  params.smoothing_time   = atof(argv[2]);
+  params.smoothe_boundary = atoi(argv[3]);
+  const char* input_file  = argv[4];
+  const char* output_file = argv[5];
+
+  std::cout << "Reading mesh:         " << input_file << std::endl;
+  std::cout << "Number of iterations: " << params.num_iterations << "\n";
+  std::cout << "Method:               " << params.method << "\n";
+  if (params.method == "implicit")
+    std::cout << "Smoothing time:       " << params.smoothing_time << "\n";
+  else
+    std::cout << "Lambda, mu:           " << params.lambda << ", "
+              << (params.method == "taubin" ? params.mu : 0.0) << "\n";
+  std::cout << "Smoothe boundary:     " << params.smoothe_boundary << "\n";
+
+  std::ostringstream cache_params;
+  cache_params.precision(17);
+  cache_params << params.num_iterations << " " << params.smoothing_time << " "
+               << params.smoothe_boundary << " " << params.method << " " << params.lambda
+               << " " << params.mu << " " << binary_output << " " << quantization_bits << " "
+               << float32 << " " << reorder << " " << keep_reorder << " "
+               << cgal_tools::roi_description(params.roi);
+
+  return cgal_tools::run_with_cache(cache, "smoothe_mesh", cache_params.str(), input_file,
+                                    output_file, stats, [&]() {
+      if (float32)
+        return process_mesh<cgal_tools::Float_mesh>(params, input_file, output_file,
+                                                    binary_output, quantization_bits,
+                                                    reorder, keep_reorder, stats);
+      return process_mesh<Mesh>(params, input_file, output_file, binary_output,
+                                quantization_bits, reorder, keep_reorder, stats);
+    });
+}
@@ -0,0 +1,280 @@
+// Smoothing, shared by the smoothe_mesh tool and the pipeline. The
+// implicit mode is mean curvature flow, which solves a sparse linear
+// system per iteration. The explicit modes move each vertex towards
+// the average of its neighbours, which is much cheaper per iteration
+// but needs more iterations for the same amount of smoothing.
+
+#ifndef CGAL_TOOLS_SMOOTHE_MESH_H
+#define CGAL_TOOLS_SMOOTHE_MESH_H
+
+#include <CGAL/Polygon_mesh_processing/smooth_shape.h>
+#include <CGAL/boost/graph/copy_face_graph.h>
+#include <CGAL/boost/graph/iterator.h>
+
+#include "mesh_roi.h"
+#include "mesh_types.h"
+#include "parallel_for.h"
+#include "submesh.h"
+#include "tool_params.h"
+#include "tool_stats.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cgal_tools {
+
+// The neighbours of each vertex in compressed sparse row form. The
+// neighbours of vertex v are neighbors[offsets[v]] up to
+// neighbors[offsets[v + 1]].
+struct Vertex_adjacency {
+  std::vector<std::size_t>   offsets;
+  std::vector<std::uint32_t> neighbors;
+};
+
+template <class Mesh>
+void build_vertex_adjacency(Mesh const& mesh, int num_threads, Vertex_adjacency & adj) {
+
+  typedef typename Mesh::Vertex_index   Vertex_index;
+  typedef typename Mesh::Halfedge_index Halfedge_index;
+
+  const std::size_t n = mesh.num_vertices();
+  adj.offsets.assign(n + 1, 0);
+  parallel_for(0, n, num_threads, [&](std::size_t it) {
+      Vertex_index v(it);
+      if (mesh.is_removed(v) || mesh.is_isolated(v))
+        return;
+      adj.offsets[it + 1] = mesh.degree(v);
+    }, 4096);
+  for (std::size_t it = 0; it < n; it++)
+    adj.offsets[it + 1] += adj.offsets[it];
+
+  adj.neighbors.resize(adj.offsets[n]);
+  parallel_for(0, n, num_threads, [&](std::size_t it) {
+      Vertex_index v(it);
+      if (adj.offsets[it] == adj.offsets[it + 1])
+        return;
+      std::size_t pos = adj.offsets[it];
+      for (Halfedge_index h : CGAL::halfedges_around_target(mesh.halfedge(v), mesh))
+        adj.neighbors[pos++] = mesh.source(h);
+    }, 4096);
+}
+
+// Laplacian or Taubin smoothing, with uniform weights. The positions
+// are held in separate x, y, z arrays, and each step computes all new
+// positions from the old ones, so vertices can be updated in any
+// order and on any number of threads with the same result. Taubin
+// smoothing alternates a step of size lambda with one of negative size
+// mu, which removes noise without the shrinking of plain Laplacian
+// smoothing. Append the time taken by each iteration.
+template <class Mesh, class VertexConstrainedMap>
+void smoothe_mesh_explicit(Mesh & mesh, Smoothe_params const& params,
+                           VertexConstrainedMap vcmap, std::vector<double> & iteration_times) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Point        Point;
+
+  const std::size_t n = mesh.num_vertices();
+  Vertex_adjacency adj;
+  build_vertex_adjacency(mesh, params.num_threads, adj);
+
+  // One bit per vertex, set for those that stay put
+  std::vector<std::uint64_t> fixed((n + 63) / 64, 0);
+  for (std::size_t it = 0; it < n; it++) {
+    Vertex_index v(it);
+    if (adj.offsets[it] == adj.offsets[it + 1] || get(vcmap, v))
+      fixed[it / 64] |= std::uint64_t(1) << (it % 64);
+  }
+
+  std::vector<double> x(n, 0), y(n, 0), z(n, 0);
+  for (Vertex_index v : mesh.vertices()) {
+    Point const& p = mesh.point(v);
+    x[v] = CGAL::to_double(p.x());
+    y[v] = CGAL::to_double(p.y());
+    z[v] = CGAL::to_double(p.z());
+  }
+  std::vector<double> nx(x), ny(y), nz(z);
+
+  auto step = [&](double factor) {
+    parallel_for(0, n, params.num_threads, [&](std::size_t it) {
+        if (fixed[it / 64] & (std::uint64_t(1) << (it % 64)))
+          return;
+        double sx = 0, sy = 0, sz = 0;
+        const std::size_t begin = adj.offsets[it], end = adj.offsets[it + 1];
+        for (std::size_t k = begin; k < end; k++) {
+          std::uint32_t u = adj.neighbors[k];
+          sx += x[u];
+          sy += y[u];
+          sz += z[u];
+        }
+        const double w = factor / double(end - begin);
+        nx[it] = x[it] + w * sx - factor * x[it];
+        ny[it] = y[it] + w * sy - factor * y[it];
+        nz[it] = z[it] + w * sz - factor * z[it];
+      }, 4096);
+    x.swap(nx);
+    y.swap(ny);
+    z.swap(nz);
+  };
+
+  const bool taubin = (params.method == "taubin");
+  for (int iter = 0; iter < params.num_iterations; iter++) {
+    double start = wall_time();
+    step(params.lambda);
+    if (taubin)
+      step(params.mu);
+    iteration_times.push_back(wall_time() - start);
+  }
+
+  for (Vertex_index v : mesh.vertices())
+    mesh.point(v) = Point(x[v], y[v], z[v]);
+}
+
+// Mean curvature flow
+template <class Mesh, class VertexConstrainedMap>
+void smoothe_mesh_implicit(Mesh & mesh, Smoothe_params const& params,
+                           VertexConstrainedMap vcmap, std::false_type) {
+  namespace PMP = CGAL::Polygon_mesh_processing;
+  PMP::smooth_shape(mesh, params.smoothing_time,
+                    PMP::parameters::number_of_iterations(params.num_iterations)
+                    .vertex_is_constrained_map(vcmap));
+}
+
+// The same, on a double precision copy of a mesh storing single
+// precision points, as the linear solve needs the precision
+template <class Mesh, class VertexConstrainedMap>
+void smoothe_mesh_implicit(Mesh & mesh, Smoothe_params const& params,
+                           VertexConstrainedMap vcmap, std::true_type) {
+  namespace PMP = CGAL::Polygon_mesh_processing;
+  typedef typename Mesh::Vertex_index             Vertex_index;
+  typedef typename Promoted_mesh<Mesh>::type      Double_mesh;
+
+  Double_mesh copy;
+  std::vector<std::pair<Vertex_index, Vertex_index> > to_copy;
+  CGAL::copy_face_graph(mesh, copy, CGAL::parameters::vertex_to_vertex_output_iterator
+                        (std::back_inserter(to_copy)));
+  typename Double_mesh::template Property_map<Vertex_index, bool> copy_vcmap =
+    copy.template add_property_map<Vertex_index, bool>("v:constrained", false).first;
+  for (std::pair<Vertex_index, Vertex_index> const& v : to_copy)
+    copy_vcmap[v.second] = get(vcmap, v.first);
+
+  PMP::smooth_shape(copy, params.smoothing_time,
+                    PMP::parameters::number_of_iterations(params.num_iterations)
+                    .vertex_is_constrained_map(copy_vcmap));
+
+  for (std::pair<Vertex_index, Vertex_index> const& v : to_copy)
+    mesh.point(v.first) = convert_point<typename Mesh::Point>(copy.point(v.second));
+}
+
+// Smoothe the mesh with the chosen method, keeping fixed the vertices
+// for which the given property map is true. If asked, append the time
+// taken by each iteration. The implicit method does all iterations in
+// one call, so for it the average time is given for each.
+template <class Mesh, class VertexConstrainedMap>
+void smoothe_mesh(Mesh & mesh, Smoothe_params const& params, VertexConstrainedMap vcmap,
+                  std::vector<double> * iteration_times = NULL) {
+  std::vector<double> times;
+  if (params.method == "laplacian" || params.method == "taubin") {
+    smoothe_mesh_explicit(mesh, params, vcmap, times);
+  } else {
+    double start = wall_time();
+    smoothe_mesh_implicit(mesh, params, vcmap,
+                          std::integral_constant<bool, Is_float_mesh<Mesh>::value>());
+    double elapsed = wall_time() - start;
+    times.assign(params.num_iterations, elapsed / std::max(params.num_iterations, 1));
+  }
+
+  if (iteration_times != NULL)
+    iteration_times->insert(iteration_times->end(), times.begin(), times.end());
+}
+
+// The number of faces incident to the vertex
+template <class Mesh>
+std::size_t num_faces_around(Mesh const& mesh, typename Mesh::Vertex_index v) {
+  std::size_t num_faces = 0;
+  for (typename Mesh::Face_index f : CGAL::faces_around_target(mesh.halfedge(v), mesh))
+    num_faces += (f != Mesh::null_face());
+  return num_faces;
+}
+
+// Smoothe a copy of the faces of the region of interest, keeping fixed
+// the vertices it shares with the rest of the mesh, and write back the
+// points. Return the number of vertices that were kept fixed, or -1,
+// leaving the mesh as it is, if the region has no faces or is not a
+// valid mesh on its own.
+template <class Mesh>
+std::ptrdiff_t smoothe_mesh_roi(Mesh & mesh, Smoothe_params const& params,
+                                std::vector<double> * iteration_times) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+
+  std::vector<Face_index> faces;
+  select_roi_faces(mesh, params.roi, faces);
+  Mesh part;
+  std::vector<Vertex_index> local_to_global;
+  if (faces.empty() || !extract_submesh(mesh, faces, part, local_to_global))
+    return -1;
+  std::vector<Face_index>().swap(faces);
+
+  // A border vertex of the copy with fewer faces than in the mesh has
+  // some outside the region
+  typename Mesh::template Property_map<Vertex_index, bool> vcmap =
+    part.template add_property_map<Vertex_index, bool>("v:constrained", false).first;
+  std::ptrdiff_t num_constrained = 0;
+  for (Vertex_index v : part.vertices()) {
+    if (!part.is_border(v))
+      continue;
+    bool fixed = !params.smoothe_boundary ||
+      num_faces_around(part, v) < num_faces_around(mesh, local_to_global[v]);
+    if (fixed) {
+      vcmap[v] = true;
+      num_constrained++;
+    }
+  }
+
+  smoothe_mesh(part, params, vcmap, iteration_times);
+  for (Vertex_index v : part.vertices())
+    mesh.point(local_to_global[v]) = part.point(v);
+  return num_constrained;
+}
+
+// Smoothe the mesh, or its region of interest if there is one. Return
+// the number of border vertices that were kept fixed, which for a
+// region includes those along its border, or -1 if the region cannot
+// be smoothed.
+template <class Mesh>
+std::ptrdiff_t smoothe_mesh(Mesh & mesh, Smoothe_params const& params,
+                            std::vector<double> * iteration_times = NULL) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+
+  if (!params.roi.empty())
+    return smoothe_mesh_roi(mesh, params, iteration_times);
+
+  // A property of the mesh, stored with one bit per vertex
+  typename Mesh::template Property_map<Vertex_index, bool> vcmap =
+    mesh.template add_property_map<Vertex_index, bool>("v:constrained", false).first;
+  std::ptrdiff_t num_constrained = 0;
+  if (!params.smoothe_boundary) {
+    for(Vertex_index v : vertices(mesh)) {
+        if(is_border(v, mesh)) {
+          vcmap[v] = true;
+          num_constrained++;
+        }
+      }
+  }
+  
+  smoothe_mesh(mesh, params, vcmap, iteration_times);
+  mesh.remove_property_map(vcmap);
+
+  return num_constrained;
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_SMOOTHE_MESH_H
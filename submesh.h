@@ -0,0 +1,223 @@
+// Copies of parts of a mesh, so that an operation can run on a small
+// piece of a large mesh, possibly on several pieces at once.
+
+#ifndef CGAL_TOOLS_SUBMESH_H
+#define CGAL_TOOLS_SUBMESH_H
+
+#include <CGAL/boost/graph/iterator.h>
+
+#include "mesh_types.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace cgal_tools {
+
+// Append to the output the faces within num_rings rings of the given
+// vertices. The first ring is the faces incident to these vertices.
+// Faces are listed in the order they are reached, so the result does
+// not depend on anything but the input. Safe to call from several
+// threads on the same mesh.
+template <class Mesh>
+void collect_face_rings(Mesh const& mesh,
+                        std::vector<typename Mesh::Vertex_index> const& seeds,
+                        int num_rings,
+                        std::vector<typename Mesh::Face_index> & out_faces) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+
+  std::unordered_set<Vertex_index> seen_vertices(seeds.begin(), seeds.end());
+  std::unordered_set<Face_index> seen_faces;
+  std::vector<Vertex_index> front = seeds, next_front;
+
+  for (int ring = 0; ring < num_rings && !front.empty(); ring++) {
+    next_front.clear();
+    for (Vertex_index v : front) {
+      if (mesh.is_isolated(v))
+        continue;
+      for (Face_index f : CGAL::faces_around_target(mesh.halfedge(v), mesh)) {
+        if (f == Mesh::null_face() || !seen_faces.insert(f).second)
+          continue;
+        out_faces.push_back(f);
+        for (Vertex_index u : CGAL::vertices_around_face(mesh.halfedge(f), mesh)) {
+          if (seen_vertices.insert(u).second)
+            next_front.push_back(u);
+        }
+      }
+    }
+    front.swap(next_front);
+  }
+}
+
+// Copy the given faces into a new mesh, which may store its points
+// with another precision. On output local_to_global[i] is the vertex
+// of the input mesh that vertex i of the submesh came from. Return
+// false if the faces do not form a valid surface mesh on their own.
+template <class Mesh, class Submesh>
+bool extract_submesh(Mesh const& mesh,
+                     std::vector<typename Mesh::Face_index> const& faces,
+                     Submesh & submesh,
+                     std::vector<typename Mesh::Vertex_index> & local_to_global) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+
+  submesh.clear();
+  local_to_global.clear();
+  std::unordered_map<Vertex_index, Vertex_index> global_to_local;
+
+  std::vector<Vertex_index> face_vertices;
+  for (Face_index f : faces) {
+    face_vertices.clear();
+    for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh)) {
+      auto inserted = global_to_local.insert(std::make_pair(v, Vertex_index()));
+      if (inserted.second) {
+        inserted.first->second =
+          submesh.add_vertex(convert_point<typename Submesh::Point>(mesh.point(v)));
+        local_to_global.push_back(v);
+      }
+      face_vertices.push_back(inserted.first->second);
+    }
+    if (submesh.add_face(face_vertices) == Submesh::null_face())
+      return false;
+  }
+
+  return true;
+}
+
+// Split the faces into num_parts groups of nearby faces of about the
+// same size, by recursively halving the set of face centroids along
+// its longest axis. The result depends only on the mesh and the number
+// of parts. Each group is sorted by face index.
+template <class Mesh>
+void partition_faces(Mesh const& mesh, int num_parts,
+                     std::vector<std::vector<typename Mesh::Face_index> > & parts) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+
+  struct Centroid {
+    double xyz[3];
+    Face_index f;
+  };
+  std::vector<Centroid> centroids;
+  centroids.reserve(mesh.number_of_faces());
+  for (Face_index f : mesh.faces()) {
+    Centroid c = {{0, 0, 0}, f};
+    int n = 0;
+    for (Vertex_index v : CGAL::vertices_around_face(mesh.halfedge(f), mesh)) {
+      for (int k = 0; k < 3; k++)
+        c.xyz[k] += CGAL::to_double(mesh.point(v)[k]);
+      n++;
+    }
+    for (int k = 0; k < 3; k++)
+      c.xyz[k] /= std::max(n, 1);
+    centroids.push_back(c);
+  }
+
+  parts.clear();
+  num_parts = std::max(1, num_parts);
+
+  // Split centroids[begin, end) into k parts. The recursion depth is
+  // only the log of the number of parts.
+  struct Splitter {
+    std::vector<Centroid> & centroids;
+    std::vector<std::vector<Face_index> > & parts;
+    void split(std::size_t begin, std::size_t end, int k) {
+      if (k <= 1 || end - begin <= 1) {
+        parts.push_back(std::vector<Face_index>());
+        for (std::size_t it = begin; it < end; it++)
+          parts.back().push_back(centroids[it].f);
+        std::sort(parts.back().begin(), parts.back().end());
+        return;
+      }
+
+      double lo[3], hi[3];
+      for (int c = 0; c < 3; c++)
+        lo[c] = hi[c] = centroids[begin].xyz[c];
+      for (std::size_t it = begin; it < end; it++) {
+        for (int c = 0; c < 3; c++) {
+          lo[c] = std::min(lo[c], centroids[it].xyz[c]);
+          hi[c] = std::max(hi[c], centroids[it].xyz[c]);
+        }
+      }
+      int axis = 0;
+      for (int c = 1; c < 3; c++)
+        if (hi[c] - lo[c] > hi[axis] - lo[axis]) axis = c;
+
+      int k1 = k / 2;
+      std::size_t mid = begin + (end - begin) * k1 / k;
+      std::nth_element(centroids.begin() + begin, centroids.begin() + mid,
+                       centroids.begin() + end,
+                       [axis](Centroid const& a, Centroid const& b) {
+                         if (a.xyz[axis] != b.xyz[axis])
+                           return a.xyz[axis] < b.xyz[axis];
+                         return a.f < b.f;
+                       });
+      split(begin, mid, k1);
+      split(mid, end, k - k1);
+    }
+  };
+  Splitter splitter = {centroids, parts};
+  splitter.split(0, centroids.size(), num_parts);
+}
+
+// Put back together submeshes made with extract_submesh() and then
+// modified, writing the result to out. Vertices of different submeshes
+// that came from the same vertex of the original mesh become one, at
+// the position it has in the first of them. Vertices created in a
+// submesh, which are past the end of its local_to_global map or map to
+// the null vertex, are all kept apart. If asked, set the vertex of the
+// result each vertex of the original mesh became, or the null vertex
+// if none did. Return false if some face could not be added.
+template <class Mesh>
+bool merge_submeshes(std::vector<Mesh> const& parts,
+                     std::vector<std::vector<typename Mesh::Vertex_index> > const& local_to_global,
+                     std::size_t num_global_vertices,
+                     Mesh & out,
+                     std::vector<typename Mesh::Vertex_index> * global_to_out_map = NULL) {
+
+  typedef typename Mesh::Vertex_index Vertex_index;
+  typedef typename Mesh::Face_index   Face_index;
+
+  out.clear();
+  std::vector<Vertex_index> global_to_out(num_global_vertices, Mesh::null_vertex());
+  std::vector<Vertex_index> local_to_out, face_vertices;
+  bool success = true;
+
+  for (std::size_t p = 0; p < parts.size(); p++) {
+    Mesh const& part = parts[p];
+    std::vector<Vertex_index> const& l2g = local_to_global[p];
+
+    local_to_out.assign(part.num_vertices(), Mesh::null_vertex());
+    for (Vertex_index v : part.vertices()) {
+      if (std::size_t(v) >= l2g.size() || l2g[v] == Mesh::null_vertex()) {
+        local_to_out[v] = out.add_vertex(part.point(v));
+        continue;
+      }
+      Vertex_index & g = global_to_out[l2g[v]];
+      if (g == Mesh::null_vertex())
+        g = out.add_vertex(part.point(v));
+      local_to_out[v] = g;
+    }
+
+    for (Face_index f : part.faces()) {
+      face_vertices.clear();
+      for (Vertex_index v : CGAL::vertices_around_face(part.halfedge(f), part))
+        face_vertices.push_back(local_to_out[v]);
+      if (out.add_face(face_vertices) == Mesh::null_face())
+        success = false;
+    }
+  }
+
+  if (global_to_out_map != NULL)
+    global_to_out_map->swap(global_to_out);
+  return success;
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_SUBMESH_H
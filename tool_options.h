@@ -0,0 +1,87 @@
+// Optional command-line switches of the form --name or --name value,
+// which can appear anywhere among the positional arguments of a tool.
+// Each switch is removed from the argument list once found, so the
+// positional arguments can then be parsed as before.
+
+#ifndef CGAL_TOOLS_TOOL_OPTIONS_H
+#define CGAL_TOOLS_TOOL_OPTIONS_H
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace cgal_tools {
+
+// Remove from argv the entries in [pos, pos + count)
+inline void remove_args(int & argc, char** argv, int pos, int count) {
+  for (int it = pos; it + count < argc; it++)
+    argv[it] = argv[it + count];
+  argc -= count;
+}
+
+// Return true and remove the flag --name if present
+inline bool extract_flag(int & argc, char** argv, std::string const& name) {
+  bool found = false;
+  for (int it = 1; it < argc; it++) {
+    if (argv[it] == "--" + name) {
+      remove_args(argc, argv, it, 1);
+      found = true;
+      it--;
+    }
+  }
+  return found;
+}
+
+// Return true and remove --name value if present. If given more than
+// once, the last value wins.
+inline bool extract_option(int & argc, char** argv, std::string const& name,
+                           std::string & value) {
+  bool found = false;
+  for (int it = 1; it < argc; it++) {
+    if (argv[it] != "--" + name)
+      continue;
+    if (it + 1 >= argc) {
+      std::cerr << "Missing value for option --" << name << "." << std::endl;
+      exit(1);
+    }
+    value = argv[it + 1];
+    remove_args(argc, argv, it, 2);
+    found = true;
+    it--;
+  }
+  return found;
+}
+
+inline bool extract_option(int & argc, char** argv, std::string const& name,
+                           double & value) {
+  std::string str;
+  if (!extract_option(argc, argv, name, str))
+    return false;
+  value = atof(str.c_str());
+  return true;
+}
+
+inline bool extract_option(int & argc, char** argv, std::string const& name,
+                           int & value) {
+  std::string str;
+  if (!extract_option(argc, argv, name, str))
+    return false;
+  value = atoi(str.c_str());
+  return true;
+}
+
+// Options that were not extracted are most likely typos
+inline bool check_no_unknown_options(int argc, char** argv) {
+  for (int it = 1; it < argc; it++) {
+    std::string arg = argv[it];
+    if (arg.size() > 2 && arg.substr(0, 2) == "--") {
+      std::cerr << "Unknown option: " << arg << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_TOOL_OPTIONS_H
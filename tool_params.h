@@ -0,0 +1,176 @@
+// The parameters and reports of the mesh operations. They are kept
+// apart from the operations, so that the library header cgal_tools.h
+// does not pull in the CGAL algorithms. This has no CGAL dependency.
+
+#ifndef CGAL_TOOLS_TOOL_PARAMS_H
+#define CGAL_TOOLS_TOOL_PARAMS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cgal_tools {
+
+// The part of a mesh an operation works on, the rest being left as it
+// is: the faces with a vertex in the box, if there is one, and the
+// faces listed by their index in the input, together with the faces
+// within num_rings rings of them. No box and no faces means the whole
+// mesh.
+struct Mesh_roi {
+  bool has_box;
+  std::array<double, 6> box;          // min x, y, z, then max x, y, z
+  std::vector<std::size_t> faces;
+  int num_rings;
+  Mesh_roi(): has_box(false), box(), num_rings(2) {}
+  bool empty() const { return !has_box && faces.empty(); }
+};
+
+struct Fill_holes_params {
+  double max_hole_diam;
+  int    max_num_hole_edges;
+  // If positive, compute the patches on this many threads, each from a
+  // copy of the hole neighbourhood
+  int    num_threads;
+  // If positive, fill the smallest holes first, and stop starting new
+  // ones after this many seconds
+  double max_seconds;
+  // Holes with at most this many edges, and no larger than the given
+  // diameter if that is positive, are only triangulated, or only
+  // triangulated and refined. The others are also faired. A tier with
+  // no edges is not used.
+  int    triangulate_max_edges;
+  double triangulate_max_diam;
+  int    refine_max_edges;
+  double refine_max_diam;
+  // If not empty, only the holes along the border of the region
+  Mesh_roi roi;
+  Fill_holes_params(): max_hole_diam(0), max_num_hole_edges(0), num_threads(0),
+                       max_seconds(0), triangulate_max_edges(0), triangulate_max_diam(0),
+                       refine_max_edges(0), refine_max_diam(0) {}
+};
+
+// How much work is put into filling a hole, from the cheapest
+enum Hole_tier { HOLE_TRIANGULATE = 0, HOLE_REFINE, HOLE_FAIR, NUM_HOLE_TIERS };
+
+inline const char* hole_tier_name(int tier) {
+  static const char* names[NUM_HOLE_TIERS] = { "triangulate", "refine", "fair" };
+  return names[tier];
+}
+
+struct Hole_tier_stats {
+  int    num_holes;
+  int    num_filled;
+  double seconds;       // summed over threads
+  Hole_tier_stats(): num_holes(0), num_filled(0), seconds(0) {}
+};
+
+// How far the hole filling got
+struct Fill_holes_report {
+  int num_found;        // holes small enough to fill
+  int num_attempted;    // the number returned by fill_holes()
+  int num_filled;       // those filled without error
+  bool out_of_time;     // if the time budget ran out first
+  std::array<Hole_tier_stats, NUM_HOLE_TIERS> tiers;
+  Fill_holes_report(): num_found(0), num_attempted(0), num_filled(0), out_of_time(false) {}
+};
+
+struct Smoothe_params {
+  int    num_iterations;
+  double smoothing_time;   // for the implicit method
+  bool   smoothe_boundary;
+  std::string method;      // implicit, laplacian, or taubin
+  double lambda, mu;       // step sizes for the explicit methods
+  int    num_threads;      // for the explicit methods, zero means all cores
+  // If not empty, only the vertices inside the region move
+  Mesh_roi roi;
+  Smoothe_params(): num_iterations(1), smoothing_time(0.00005), smoothe_boundary(true),
+                    method("implicit"), lambda(0.5), mu(-0.53), num_threads(0) {}
+};
+
+struct Rm_connected_components_params {
+  int num_min_faces_in_component;
+  int num_components_to_keep;
+  // Zero means all cores. The result does not depend on it.
+  int num_threads;
+  Rm_connected_components_params():
+    num_min_faces_in_component(0), num_components_to_keep(0), num_threads(0) {}
+};
+
+struct Simplify_params {
+  double edge_keep_ratio;
+  // If positive, simplify patches of the mesh on this many threads
+  int    num_threads;
+  // The number of patches. The result depends on it, but not on the
+  // number of threads.
+  int    num_parts;
+  // If positive, stop after this many seconds
+  double max_seconds;
+  // If positive, stop before the first collapse whose error is larger,
+  // the error being the square root of the Lindstrom-Turk cost, which
+  // is roughly a distance
+  double max_error;
+  // If positive, simplify as far as the result stays within this
+  // distance of the input, but not below the edge keep ratio. The
+  // distance is the Hausdorff distance, measured on samples of both
+  // meshes. This is done serially.
+  double max_deviation;
+  Simplify_params(): edge_keep_ratio(1.0), num_threads(0), num_parts(64),
+                     max_seconds(0), max_error(0), max_deviation(0) {}
+};
+
+// A level measured while searching for the smallest mesh within a
+// deviation bound
+struct Deviation_level {
+  double      ratio;      // of edges kept
+  std::size_t num_faces;
+  double      deviation;
+};
+
+// How the search for the smallest mesh within a deviation bound went
+struct Simplify_deviation_report {
+  double ratio;           // of edges kept in the result
+  double deviation;       // of the result from the input
+  int    num_simplifications;
+  std::vector<Deviation_level> levels;   // in the order measured
+  Simplify_deviation_report(): ratio(1), deviation(0), num_simplifications(0) {}
+};
+
+// Why a simplification stopped before reaching its target, if it did
+struct Simplify_status {
+  enum Reason { NONE = 0, OUT_OF_TIME, ERROR_BOUND };
+  std::atomic<int> reason;
+  Simplify_status(): reason(NONE) {}
+  void set(Reason r) {
+    int expected = NONE;
+    reason.compare_exchange_strong(expected, r);
+  }
+};
+
+struct Isotropic_remesh_params {
+  double target_edge_length;
+  int    num_iterations;
+  // If positive, remesh patches of the mesh on this many threads
+  int    num_threads;
+  // The number of patches. The result depends on it, but not on the
+  // number of threads.
+  int    num_parts;
+  Isotropic_remesh_params(): target_edge_length(0), num_iterations(3), num_threads(0),
+                             num_parts(64) {}
+};
+
+// Where the time of a remeshing went
+struct Isotropic_remesh_report {
+  std::size_t num_parts;       // patches remeshed in parallel, zero if serial
+  std::size_t num_seam_faces;  // faces around the patch borders remeshed last
+  double split_seconds;        // splitting long edges before partitioning
+  double parts_seconds;
+  double seam_seconds;
+  Isotropic_remesh_report(): num_parts(0), num_seam_faces(0), split_seconds(0),
+                             parts_seconds(0), seam_seconds(0) {}
+};
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_TOOL_PARAMS_H
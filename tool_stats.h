@@ -0,0 +1,218 @@
+// Timing and memory measurements of the phases of a tool. Each phase,
+// such as reading the mesh or filling holes, records its wall time,
+// CPU time, and peak memory. Together with counts such as the number of
+// holes filled, these can be written as one line of JSON, to find out
+// where the time went in a slow run.
+
+#ifndef CGAL_TOOLS_TOOL_STATS_H
+#define CGAL_TOOLS_TOOL_STATS_H
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tool_options.h"
+
+namespace cgal_tools {
+
+// Seconds since some fixed moment, for measuring elapsed time
+inline double wall_time() {
+  return std::chrono::duration<double>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The moment, as given by wall_time(), when a budget of the given
+// number of seconds starting now runs out, or a negative value if
+// there is no budget
+inline double deadline_after(double max_seconds) {
+  return max_seconds > 0 ? wall_time() + max_seconds : -1;
+}
+
+inline bool past_deadline(double deadline) {
+  return deadline > 0 && wall_time() > deadline;
+}
+
+// CPU seconds used by all threads of the process so far
+inline double cpu_time() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+    1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+// The peak resident set size of the process, in MB. On Linux this is
+// the high water mark since the last call to reset_peak_rss().
+inline double peak_rss_mb() {
+  std::ifstream status("/proc/self/status");
+  std::string key;
+  while (status >> key) {
+    if (key == "VmHWM:") {
+      double kb = 0;
+      status >> kb;
+      return kb / 1024.0;
+    }
+    std::getline(status, key);
+  }
+
+  // Elsewhere fall back to the peak over the life of the process
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+// Make the peak RSS start again from the current RSS, so that the
+// peak of each phase can be measured. Has no effect if not supported.
+inline void reset_peak_rss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (clear_refs)
+    clear_refs << "5";
+}
+
+struct Phase_stats {
+  std::string name;
+  double wall_seconds, cpu_seconds, peak_rss_mb;
+  Phase_stats(): wall_seconds(0), cpu_seconds(0), peak_rss_mb(0) {}
+};
+
+// The phases and counts of one run of a tool. A phase lasts from
+// start_phase() until the next phase starts or end_phase() is called.
+class Tool_stats {
+public:
+  explicit Tool_stats(std::string const& tool): tool_(tool), start_(wall_time()),
+                                                measure_memory_(true), active_(false),
+                                                phase_start_(0), phase_cpu_start_(0) {}
+
+  // The peak memory is that of the whole process, and measuring it
+  // resets it, so stats of work running alongside other work must not
+  // measure it. Their phases then have a peak memory of zero.
+  void set_measure_memory(bool measure) { measure_memory_ = measure; }
+
+  void start_phase(std::string const& name) {
+    end_phase();
+    if (measure_memory_)
+      reset_peak_rss();
+    current_.name = name;
+    active_ = true;
+    phase_cpu_start_ = cpu_time();
+    phase_start_ = wall_time();
+  }
+
+  void end_phase() {
+    if (!active_)
+      return;
+    current_.wall_seconds = wall_time() - phase_start_;
+    current_.cpu_seconds  = cpu_time() - phase_cpu_start_;
+    current_.peak_rss_mb  = measure_memory_ ? peak_rss_mb() : 0;
+    phases_.push_back(current_);
+    active_ = false;
+  }
+
+  // Set a count, replacing any earlier value with the same name
+  void set_count(std::string const& name, double value) {
+    for (auto & count : counts_) {
+      if (count.first == name) {
+        count.second = value;
+        return;
+      }
+    }
+    counts_.push_back(std::make_pair(name, value));
+  }
+
+  std::vector<Phase_stats> const& phases() const { return phases_; }
+
+  // The most recently ended phase
+  Phase_stats const& last_phase() const { return phases_.back(); }
+
+  // Where to write the JSON line: empty for nowhere, "-" for stderr
+  void set_destination(std::string const& destination) { destination_ = destination; }
+
+  // The largest peak memory of the phases so far
+  double max_phase_rss_mb() const {
+    double peak = 0;
+    for (Phase_stats const& phase : phases_)
+      peak = std::max(peak, phase.peak_rss_mb);
+    return peak;
+  }
+
+  std::string json() const {
+    double peak = max_phase_rss_mb();
+
+    std::ostringstream os;
+    os.precision(6);
+    os << "{\"tool\":\"" << tool_ << "\",\"wall_seconds\":" << wall_time() - start_
+       << ",\"cpu_seconds\":" << cpu_time() << ",\"peak_rss_mb\":" << peak << ",\"phases\":[";
+    for (std::size_t it = 0; it < phases_.size(); it++) {
+      Phase_stats const& phase = phases_[it];
+      os << (it > 0 ? "," : "") << "{\"name\":\"" << phase.name << "\",\"wall_seconds\":"
+         << phase.wall_seconds << ",\"cpu_seconds\":" << phase.cpu_seconds
+         << ",\"peak_rss_mb\":" << phase.peak_rss_mb << "}";
+    }
+    os << "],\"counts\":{";
+    os.precision(15);
+    for (std::size_t it = 0; it < counts_.size(); it++)
+      os << (it > 0 ? "," : "") << "\"" << counts_[it].first << "\":" << counts_[it].second;
+    os << "}}";
+    return os.str();
+  }
+
+  // Write the JSON line to the destination, if any, appending to a
+  // file so that several runs can share it. Return false on failure.
+  bool emit() {
+    end_phase();
+    if (destination_.empty())
+      return true;
+    if (destination_ == "-") {
+      std::cerr << json() << std::endl;
+      return true;
+    }
+    std::ofstream out(destination_.c_str(), std::ios::app);
+    out << json() << "\n";
+    if (!out) {
+      std::cerr << "Failed writing: " << destination_ << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+private:
+  std::string tool_;
+  double start_;
+  bool measure_memory_;
+  bool active_;
+  double phase_start_, phase_cpu_start_;
+  Phase_stats current_;
+  std::vector<Phase_stats> phases_;
+  std::vector<std::pair<std::string, double> > counts_;
+  std::string destination_;
+};
+
+// Handle the options --stats, which writes the JSON line to stderr,
+// and --stats_file file, which appends it to the given file
+inline void extract_stats_options(int & argc, char** argv, Tool_stats & stats) {
+  if (extract_flag(argc, argv, "stats"))
+    stats.set_destination("-");
+  std::string stats_file;
+  if (extract_option(argc, argv, "stats_file", stats_file))
+    stats.set_destination(stats_file);
+}
+
+// Usage text for the above options
+inline const char* stats_usage() {
+  return "[--stats | --stats_file file]";
+}
+
+} // end namespace cgal_tools
+
+#endif // CGAL_TOOLS_TOOL_STATS_H